@@ -0,0 +1 @@
+..\..\..\src\run_inet %*
@@ -13,25 +13,149 @@
 // See the GNU Lesser General Public License for more details.
 //
 
+#include <algorithm>
+
 #include "ByteArray.h"
 
 
-void ByteArray::setDataFromBuffer(const void *ptr, unsigned int length)
+ByteArray::Buffer *ByteArray::createBuffer(unsigned int capacity)
+{
+    Buffer *buffer = new Buffer();
+    buffer->refCount = 0;
+    buffer->capacity = capacity;
+    buffer->used = 0;
+    buffer->bytes = capacity ? new char[capacity] : NULL;
+    return buffer;
+}
+
+void ByteArray::setBuffer(Buffer *newBuffer, unsigned int offset, unsigned int length)
+{
+    // the new buffer may be the current one, so it is referenced first
+    if (newBuffer)
+        newBuffer->refCount++;
+    releaseBuffer();
+    buffer = newBuffer;
+    dataOffset = offset;
+    dataLength = length;
+}
+
+void ByteArray::releaseBuffer()
+{
+    if (buffer && --buffer->refCount == 0)
+    {
+        delete [] buffer->bytes;
+        delete buffer;
+    }
+    buffer = NULL;
+    dataOffset = dataLength = 0;
+}
+
+void ByteArray::makeBufferUnique()
+{
+    if (buffer && buffer->refCount > 1)
+    {
+        Buffer *newBuffer = createBuffer(dataLength);
+        memcpy(newBuffer->bytes, getDataPointer(), dataLength);
+        newBuffer->used = dataLength;
+        setBuffer(newBuffer, 0, dataLength);
+    }
+}
+
+void ByteArray::copy(const ByteArray& other)
+{
+    setBuffer(other.buffer, other.dataOffset, other.dataLength);
+}
+
+ByteArray& ByteArray::operator=(const ByteArray& other)
+{
+    if (this == &other)
+        return *this;
+    ByteArray_Base::operator=(other);
+    copy(other);
+    return *this;
+}
+
+void ByteArray::setDataArraySize(unsigned int size)
 {
-    if (length != data_arraysize)
+    // keeps the existing bytes and zero-fills the rest, like the generated code
+    Buffer *newBuffer = size ? createBuffer(size) : NULL;
+    if (newBuffer)
     {
-        delete [] data_var;
-        data_var = length ? new char[length] : NULL;
-        data_arraysize = length;
+        unsigned int keep = std::min(size, dataLength);
+        if (keep)
+            memcpy(newBuffer->bytes, getDataPointer(), keep);
+        memset(newBuffer->bytes + keep, 0, size - keep);
+        newBuffer->used = size;
     }
+    setBuffer(newBuffer, 0, size);
+}
+
+char ByteArray::getData(unsigned int k) const
+{
+    if (k >= dataLength)
+        throw cRuntimeError("Array of size %d indexed by %d", dataLength, k);
+    return buffer->bytes[dataOffset + k];
+}
+
+void ByteArray::setData(unsigned int k, char data)
+{
+    if (k >= dataLength)
+        throw cRuntimeError("Array of size %d indexed by %d", dataLength, k);
+    makeBufferUnique();
+    buffer->bytes[dataOffset + k] = data;
+}
+
+void ByteArray::parsimPack(cCommBuffer *b)
+{
+    ByteArray_Base::parsimPack(b);
+    b->pack(dataLength);
+    if (dataLength)
+        b->pack(getDataPointer(), dataLength);
+}
+
+void ByteArray::parsimUnpack(cCommBuffer *b)
+{
+    ByteArray_Base::parsimUnpack(b);
+    unsigned int length;
+    b->unpack(length);
+    char *ptr = length ? new char[length] : NULL;
     if (length)
-        memcpy(data_var, ptr, length);
+        b->unpack(ptr, length);
+    assignBuffer(ptr, length);
+}
+
+void ByteArray::setDataFromBuffer(const void *ptr, unsigned int length)
+{
+    if (0 == length)
+    {
+        releaseBuffer();
+        return;
+    }
+
+    if (buffer && buffer->refCount == 1 && buffer->capacity >= length)
+    {
+        // reuse own buffer; ptr may point into it
+        memmove(buffer->bytes, ptr, length);
+        buffer->used = length;
+        dataOffset = 0;
+        dataLength = length;
+    }
+    else
+    {
+        Buffer *newBuffer = createBuffer(length);
+        memcpy(newBuffer->bytes, ptr, length);
+        newBuffer->used = length;
+        setBuffer(newBuffer, 0, length);
+    }
 }
 
 void ByteArray::setDataFromByteArray(const ByteArray& other, unsigned int srcOffs, unsigned int length)
 {
-    ASSERT(srcOffs+length <= other.data_arraysize);
-    setDataFromBuffer(other.data_var+srcOffs, length);
+    ASSERT(srcOffs+length <= other.dataLength);
+    if (0 == length)
+        releaseBuffer();
+    else
+        setBuffer(other.buffer, other.dataOffset + srcOffs, length);
 }
 
 void ByteArray::addDataFromBuffer(const void *ptr, unsigned int length)
@@ -39,49 +163,81 @@ void ByteArray::addDataFromBuffer(const void *ptr, unsigned int length)
     if (0 == length)
         return;
 
-    unsigned int nlength = data_arraysize + length;
-    char *ndata_var = new char[nlength];
-    if (data_arraysize)
-        memcpy(ndata_var, data_var, data_arraysize);
-    memcpy(ndata_var + data_arraysize, ptr, length);
-    delete [] data_var;
-    data_var = ndata_var;
-    data_arraysize = nlength;
+    if (buffer && dataOffset + dataLength == buffer->used && buffer->used + length <= buffer->capacity)
+    {
+        // no other view contains the bytes after ours: append in place
+        memcpy(buffer->bytes + buffer->used, ptr, length);
+        buffer->used += length;
+        dataLength += length;
+        return;
+    }
+
+    // reserve space for further appends
+    unsigned int nlength = dataLength + length;
+    Buffer *newBuffer = createBuffer(std::max(nlength, 2 * dataLength));
+    if (dataLength)
+        memcpy(newBuffer->bytes, getDataPointer(), dataLength);
+    memcpy(newBuffer->bytes + dataLength, ptr, length);
+    newBuffer->used = nlength;
+    setBuffer(newBuffer, 0, nlength);
+}
+
+void ByteArray::addDataFromByteArray(const ByteArray& other, unsigned int srcOffs, unsigned int length)
+{
+    ASSERT(srcOffs+length <= other.dataLength);
+
+    if (0 == length)
+        return;
+
+    if (0 == dataLength)
+        setDataFromByteArray(other, srcOffs, length);
+    else if (buffer == other.buffer && dataOffset + dataLength == other.dataOffset + srcOffs)
+        dataLength += length;
+    else
+        addDataFromBuffer(other.getDataPointer() + srcOffs, length);
 }
 
 unsigned int ByteArray::copyDataToBuffer(void *ptr, unsigned int length, unsigned int srcOffs) const
 {
-    if (srcOffs >= data_arraysize)
+    if (srcOffs >= dataLength)
         return 0;
 
-    if (srcOffs + length > data_arraysize)
-        length = data_arraysize - srcOffs;
-    memcpy(ptr, data_var+srcOffs, length);
+    if (srcOffs + length > dataLength)
+        length = dataLength - srcOffs;
+    memcpy(ptr, getDataPointer() + srcOffs, length);
     return length;
 }
 
 void ByteArray::assignBuffer(void *ptr, unsigned int length)
 {
-    delete [] data_var;
-    data_var = (char *)ptr;
-    data_arraysize = length;
+    Buffer *newBuffer = NULL;
+    if (length)
+    {
+        newBuffer = new Buffer();
+        newBuffer->refCount = 0;
+        newBuffer->capacity = length;
+        newBuffer->used = length;
+        newBuffer->bytes = (char *)ptr;
+    }
+    else
+        delete [] (char *)ptr;
+    setBuffer(newBuffer, 0, length);
 }
 
 void ByteArray::truncateData(unsigned int truncleft, unsigned int truncright)
 {
-    ASSERT(data_arraysize >= (truncleft + truncright));
+    ASSERT(dataLength >= (truncleft + truncright));
 
     if ((truncleft || truncright))
     {
-        unsigned int nlength = data_arraysize - (truncleft + truncright);
-        char *ndata_var = NULL;
-        if (nlength)
+        if (dataLength == truncleft + truncright)
         {
-            ndata_var = new char[nlength];
-            memcpy(ndata_var, data_var+truncleft, nlength);
+            releaseBuffer();
+            return;
         }
-        delete [] data_var;
-        data_var = ndata_var;
-        data_arraysize = nlength;
+        dataOffset += truncleft;
+        dataLength -= truncleft + truncright;
+        if (buffer->refCount == 1)
+            buffer->used = dataOffset + dataLength;
     }
 }
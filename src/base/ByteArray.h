@@ -20,30 +20,79 @@
 
 /**
  * Class that carries raw bytes.
+ *
+ * The bytes are stored in a reference counted buffer that is shared by the
+ * copies of a ByteArray and by the ByteArrays sliced from it with
+ * setDataFromByteArray() or truncateData(); every ByteArray is a view
+ * (offset and length) into its buffer. Copying, slicing and truncating
+ * therefore don't copy bytes. A shared buffer is copied before it is
+ * modified (copy on write). Appending to the view that ends at the last
+ * used byte of a buffer writes into the spare capacity of the buffer.
+ *
+ * The array of the generated base class is not used, the accessors of the
+ * data field are overridden instead.
  */
 class ByteArray : public ByteArray_Base
 {
+  protected:
+    struct Buffer
+    {
+        unsigned int refCount;   // number of ByteArrays using the buffer
+        unsigned int capacity;   // size of the allocated storage
+        unsigned int used;       // bytes [0..used) may belong to views, the rest is free for appending
+        char *bytes;
+    };
+
+    Buffer *buffer;            // NULL if empty
+    unsigned int dataOffset;   // first byte of the view in buffer->bytes
+    unsigned int dataLength;   // length of the view
+
+  private:
+    void copy(const ByteArray& other);
+
+  protected:
+    static Buffer *createBuffer(unsigned int capacity);
+    void setBuffer(Buffer *newBuffer, unsigned int offset, unsigned int length);
+    void releaseBuffer();
+    void makeBufferUnique();
+    const char *getDataPointer() const { return buffer ? buffer->bytes + dataOffset : NULL; }
+
   public:
     /**
      * Constructor
      */
-    ByteArray() : ByteArray_Base() {}
+    ByteArray() : ByteArray_Base() { buffer = NULL; dataOffset = dataLength = 0; }
+
+    /**
+     * Copy constructor, shares the bytes of other
+     */
+    ByteArray(const ByteArray& other) : ByteArray_Base(other) { buffer = NULL; copy(other); }
 
     /**
-     * Copy constructor
+     * operator =, shares the bytes of other
      */
-    ByteArray(const ByteArray& other) : ByteArray_Base(other) { }
+    ByteArray& operator=(const ByteArray& other);
 
     /**
-     * operator =
+     * Destructor
      */
-    ByteArray& operator=(const ByteArray& other) {ByteArray_Base::operator=(other); return *this;}
+    virtual ~ByteArray() { releaseBuffer(); }
 
     /**
      * Creates and returns an exact copy of this object.
      */
     virtual ByteArray *dup() const {return new ByteArray(*this);}
 
+    /** @name Accessors of the data field, overridden from ByteArray_Base */
+    //@{
+    virtual void setDataArraySize(unsigned int size);
+    virtual unsigned int getDataArraySize() const { return dataLength; }
+    virtual char getData(unsigned int k) const;
+    virtual void setData(unsigned int k, char data);
+    virtual void parsimPack(cCommBuffer *b);
+    virtual void parsimUnpack(cCommBuffer *b);
+    //@}
+
     /**
      * Copy data from buffer
      * @param ptr: pointer to buffer
@@ -52,7 +101,7 @@ class ByteArray : public ByteArray_Base
     virtual void setDataFromBuffer(const void *ptr, unsigned int length);
 
     /**
-     * Copy data from other ByteArray
+     * Set data to a part of other ByteArray; the bytes are shared, not copied
      * @param other: reference to other ByteArray
      * @param offset: skipped first bytes from other
      * @param length: length of data
@@ -66,6 +115,16 @@ class ByteArray : public ByteArray_Base
      */
     virtual void addDataFromBuffer(const void *ptr, unsigned int length);
 
+    /**
+     * Add a part of other ByteArray to the end of existing content; the bytes
+     * are shared if this ByteArray is empty or if the part directly follows
+     * the existing content in the same buffer
+     * @param other: reference to other ByteArray
+     * @param offset: skipped first bytes from other
+     * @param length: length of data
+     */
+    virtual void addDataFromByteArray(const ByteArray& other, unsigned int offset, unsigned int length);
+
     /**
      * Copy data content to buffer
      * @param ptr: pointer to output buffer
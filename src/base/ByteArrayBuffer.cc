@@ -70,6 +70,40 @@ unsigned int ByteArrayBuffer::getBytesToBuffer(void* bufferP, unsigned int buffe
     return copiedBytes;
 }
 
+unsigned int ByteArrayBuffer::getBytesToByteArray(ByteArray& byteArrayP, unsigned int lengthP, unsigned int srcOffsP) const
+{
+    DataList::const_iterator i = dataListM.begin();
+
+    while (i != dataListM.end() && srcOffsP >= i->getDataArraySize())
+    {
+        srcOffsP -= i->getDataArraySize();
+        ++i;
+    }
+
+    if (i == dataListM.end() || lengthP == 0)
+    {
+        byteArrayP.setDataFromBuffer(NULL, 0);
+        return 0;
+    }
+
+    if (srcOffsP + lengthP <= i->getDataArraySize())
+    {
+        byteArrayP.setDataFromByteArray(*i, srcOffsP, lengthP);
+        return lengthP;
+    }
+
+    // spans more ByteArrays
+    char *buffer = new char[lengthP];
+    unsigned int copiedBytes = 0;
+    for (; copiedBytes < lengthP && i != dataListM.end(); ++i)
+    {
+        copiedBytes += i->copyDataToBuffer(buffer + copiedBytes, lengthP - copiedBytes, srcOffsP);
+        srcOffsP = 0;
+    }
+    byteArrayP.assignBuffer(buffer, copiedBytes);
+    return copiedBytes;
+}
+
 unsigned int ByteArrayBuffer::popBytesToBuffer(void* bufferP, unsigned int bufferLengthP)
 {
     return drop(getBytesToBuffer(bufferP, bufferLengthP));
@@ -61,6 +61,16 @@ class ByteArrayBuffer : public cObject
      */
     virtual unsigned int getBytesToBuffer(void* bufferP, unsigned int bufferLengthP, unsigned int srcOffsP = 0) const;
 
+    /**
+     * Set a ByteArray to the stored bytes [srcOffsP..srcOffsP+lengthP). The bytes
+     * are shared with the buffer if they are in one stored ByteArray, otherwise copied.
+     * @param byteArrayP: output ByteArray
+     * @param lengthP: count of bytes
+     * @param srcOffsP: source offset
+     * @return count of bytes set
+     */
+    virtual unsigned int getBytesToByteArray(ByteArray& byteArrayP, unsigned int lengthP, unsigned int srcOffsP = 0) const;
+
     /**
      * Move bytes to an external buffer
      * @param bufferP: pointer to output buffer
@@ -0,0 +1,144 @@
+//
+// Copyright (C) 2015 OpenSim Ltd.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_HASHINDEX_H
+#define __INET_HASHINDEX_H
+
+#include <vector>
+
+#include "INETDefs.h"
+
+/**
+ * Spreads consecutive integers (port numbers, labels) over the buckets of a HashIndex.
+ */
+inline unsigned int hashInt(unsigned int value)
+{
+    unsigned int hash = value * 0x9e3779b1u;
+    return hash ^ (hash >> 16);
+}
+
+/**
+ * Mixes a value into a hash.
+ */
+inline unsigned int hashCombine(unsigned int hash, unsigned int value)
+{
+    return hash ^ (hashInt(value) + 0x9e3779b9u + (hash << 6) + (hash >> 2));
+}
+
+/**
+ * Hashes a socket pair; Address must have a getHash() method (see IPvXAddress).
+ */
+template <typename Address>
+inline unsigned int hashSocketPair(const Address& localAddr, const Address& remoteAddr, int localPort, int remotePort)
+{
+    unsigned int hash = hashCombine(localAddr.getHash(), remoteAddr.getHash());
+    return hashCombine(hash, ((unsigned int)remotePort << 16) ^ (unsigned int)localPort);
+}
+
+/**
+ * Hash table index of objects owned by some other container, e.g. the
+ * connections of a transport protocol. The values (typically pointers or
+ * iterators) are stored with their hash; the key itself is not, so lookups
+ * iterate the bucket of the hash and compare the key of the candidates:
+ *
+ * <pre>
+ *   const HashIndex<Conn *>::Bucket& bucket = index.getBucket(hash);
+ *   for (HashIndex<Conn *>::Bucket::const_iterator it = bucket.begin(); it != bucket.end(); ++it)
+ *       if (it->hash == hash && it->value->key == key)
+ *           return it->value;
+ * </pre>
+ *
+ * Collisions are chained. The number of buckets is a power of 2, and it is
+ * doubled when the number of values would exceed it. A bucket lists its values
+ * in the order they were inserted, and rehashing keeps this order, so lookups
+ * can prefer the first (or last) inserted of several matching values.
+ *
+ * T must be copyable and have operator==.
+ */
+template <typename T>
+class HashIndex
+{
+  public:
+    struct Entry
+    {
+        unsigned int hash;
+        T value;
+    };
+    typedef std::vector<Entry> Bucket;
+
+  protected:
+    std::vector<Bucket> buckets;    // number of buckets is a power of 2
+    int count;
+
+  public:
+    HashIndex() : buckets(16), count(0) {}
+
+    int size() const { return count; }
+    void clear() { std::vector<Bucket>(16).swap(buckets); count = 0; }
+
+    /**
+     * Returns the bucket of the given hash. It also contains values of other
+     * hashes, and values of the same hash but different keys.
+     */
+    const Bucket& getBucket(unsigned int hash) const { return buckets[hash & (buckets.size() - 1)]; }
+
+    /**
+     * Adds the value to the end of the bucket of the given hash.
+     */
+    void insert(unsigned int hash, const T& value)
+    {
+        if (count >= (int)buckets.size())
+            rehash(2 * buckets.size());
+        Entry entry;
+        entry.hash = hash;
+        entry.value = value;
+        buckets[hash & (buckets.size() - 1)].push_back(entry);
+        count++;
+    }
+
+    /**
+     * Removes the value inserted with the given hash, keeping the order of the
+     * other values. Returns false if the value is not found.
+     */
+    bool remove(unsigned int hash, const T& value)
+    {
+        Bucket& bucket = buckets[hash & (buckets.size() - 1)];
+        for (typename Bucket::iterator it = bucket.begin(); it != bucket.end(); ++it)
+        {
+            if (it->hash == hash && it->value == value)
+            {
+                bucket.erase(it);
+                count--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+  protected:
+    // every old bucket is split into two new ones, preserving the order of its values
+    void rehash(size_t numBuckets)
+    {
+        std::vector<Bucket> oldBuckets(numBuckets);
+        oldBuckets.swap(buckets);
+        for (typename std::vector<Bucket>::const_iterator b = oldBuckets.begin(); b != oldBuckets.end(); ++b)
+            for (typename Bucket::const_iterator it = b->begin(); it != b->end(); ++it)
+                buckets[it->hash & (numBuckets - 1)].push_back(*it);
+    }
+};
+
+#endif
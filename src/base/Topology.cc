@@ -20,6 +20,8 @@
 #include <stdarg.h>
 #include <deque>
 #include <list>
+#include <queue>
+#include <functional>
 #include <algorithm>
 #include <sstream>
 #include "Topology.h"
@@ -421,14 +423,21 @@ void Topology::calculateWeightedSingleShortestPathsTo(Node *_target)
 
     target->dist = 0;
 
-    std::list<Node*> q;
+    // binary heap with lazy deletion: outdated entries of nodes whose distance
+    // decreased since are skipped when popped. Nodes of equal distance are
+    // processed in insertion order, like with an ordered list.
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry> > q;
+    long sequenceNumber = 0;
 
-    q.push_back(target);
+    q.push(QueueEntry(0, sequenceNumber++, target));
 
     while (!q.empty())
     {
-        Node *dest = q.front();
-        q.pop_front();
+        QueueEntry entry = q.top();
+        q.pop();
+        Node *dest = entry.node;
+        if (entry.dist != dest->dist)
+            continue;  // outdated entry
 
         ASSERT(dest->getWeight() >= 0.0);
 
@@ -450,17 +459,9 @@ void Topology::calculateWeightedSingleShortestPathsTo(Node *_target)
                 newdist += dest->getWeight();  // dest is not the target, uses weight of dest node as price of routing (infinity means dest node doesn't route between interfaces)
             if (newdist != INFINITY && src->dist > newdist)  // it's a valid shorter path from src to target node
             {
-                if (src->dist != INFINITY)
-                    q.remove(src);   // src is in the queue
                 src->dist = newdist;
                 src->outPath = dest->inLinks[i];
-
-                // insert src node to ordered list
-                std::list<Node*>::iterator it;
-                for (it = q.begin(); it != q.end(); ++it)
-                    if ((*it)->dist > newdist)
-                        break;
-                q.insert(it, src);
+                q.push(QueueEntry(newdist, sequenceNumber++, src));
             }
         }
     }
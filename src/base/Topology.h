@@ -568,6 +568,16 @@ class INET_API Topology : public cOwnedObject
     //@}
 
   protected:
+    // entry of the priority queue used in calculateWeightedSingleShortestPathsTo()
+    struct QueueEntry
+    {
+        double dist;
+        long sequenceNumber;
+        Node *node;
+        QueueEntry(double dist, long sequenceNumber, Node *node) : dist(dist), sequenceNumber(sequenceNumber), node(node) {}
+        bool operator>(const QueueEntry& other) const {return dist > other.dist || (dist == other.dist && sequenceNumber > other.sequenceNumber);}
+    };
+
     /**
      * Node factory.
      */
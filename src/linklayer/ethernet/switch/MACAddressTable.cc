@@ -14,24 +14,28 @@
 // along with this program.  If not, see http://www.gnu.org/licenses/.
 // 
 
-#include <map>
+#include <algorithm>
 #include "MACAddressTable.h"
 
 #define MAX_LINE 100
+#define MIN_SLOTS 64
 
 Define_Module(MACAddressTable);
 
 std::ostream& operator<<(std::ostream& os, const MACAddressTable::AddressEntry& entry)
 {
-    os << "{VID=" << entry.vid << ", port=" << entry.portno << ", insertionTime=" << entry.insertionTime << "}";
+    if (entry.portno == -1)
+        os << "(unused)";
+    else
+        os << entry.address << " {VID=" << entry.vid << ", port=" << entry.portno << ", insertionTime=" << entry.insertionTime << "}";
     return os;
 }
 
 MACAddressTable::MACAddressTable()
 {
-    addressTable = new AddressTable();
-    // Set addressTable for VLAN ID 0
-    vlanAddressTable[0] = addressTable;
+    numEntries = 0;
+    agingListHead = agingListTail = -1;
+    slots.assign(MIN_SLOTS, -1);
 }
 
 void MACAddressTable::initialize()
@@ -44,8 +48,8 @@ void MACAddressTable::initialize()
     if (addressTableFile && *addressTableFile)
         readAddressTable(addressTableFile);
 
-    AddressTable& addressTable = *this->addressTable; // magic to hide the '*' from the name of the watch below
-    WATCH_MAP(addressTable);
+    WATCH(numEntries);
+    WATCH_VECTOR(entries);
 }
 
 /**
@@ -79,22 +83,140 @@ void MACAddressTable::handleMessage(cMessage *)
     throw cRuntimeError("This module doesn't process messages");
 }
 
+unsigned int MACAddressTable::hashOf(const MACAddress& address, unsigned int vid)
+{
+    // 64-bit mix function (MurmurHash3 finalizer) over the 48-bit address and the 12-bit VLAN ID
+    uint64 key = address.getInt() ^ ((uint64)vid << 48);
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return (unsigned int)key;
+}
+
 /*
- * getTableForVid
- * Returns a MAC Address Table for a specified VLAN ID
- * or NULL pointer if it is not found
+ * Returns the slot of the entry with the given key, or the empty slot
+ * where it would be inserted.
  */
+int MACAddressTable::findSlot(const MACAddress& address, unsigned int vid) const
+{
+    int mask = slots.size() - 1;
+    for (int i = hashOf(address, vid) & mask; ; i = (i + 1) & mask)
+    {
+        int index = slots[i];
+        if (index == -1 || (entries[index].vid == vid && entries[index].address == address))
+            return i;
+    }
+}
+
+int MACAddressTable::findEntry(const MACAddress& address, unsigned int vid) const
+{
+    return slots[findSlot(address, vid)];
+}
+
+int MACAddressTable::addEntry(const MACAddress& address, unsigned int vid, int portno, simtime_t insertionTime)
+{
+    // keep the load factor below 1/2
+    if (2 * (numEntries + 1) > (int)slots.size())
+        resizeSlots(2 * slots.size());
+
+    int index;
+    if (freeEntries.empty())
+    {
+        index = entries.size();
+        entries.push_back(AddressEntry());
+    }
+    else
+    {
+        index = freeEntries.back();
+        freeEntries.pop_back();
+    }
+    AddressEntry& entry = entries[index];
+    entry = AddressEntry(vid, portno, insertionTime);
+    entry.address = address;
+    slots[findSlot(address, vid)] = index;
+    linkEntry(index);
+    numEntries++;
+    return index;
+}
+
+void MACAddressTable::removeEntry(int index)
+{
+    AddressEntry& entry = entries[index];
+
+    // backward shift deletion: move later entries of the probe sequence into the hole
+    int mask = slots.size() - 1;
+    int hole = findSlot(entry.address, entry.vid);
+    ASSERT(slots[hole] == index);
+    for (int i = (hole + 1) & mask; slots[i] != -1; i = (i + 1) & mask)
+    {
+        int home = hashOf(entries[slots[i]].address, entries[slots[i]].vid) & mask;
+        // move unless home lies cyclically in (hole, i]
+        bool homeInRange = hole <= i ? (hole < home && home <= i) : (hole < home || home <= i);
+        if (!homeInRange)
+        {
+            slots[hole] = slots[i];
+            hole = i;
+        }
+    }
+    slots[hole] = -1;
+
+    unlinkEntry(index);
+    entry = AddressEntry();
+    freeEntries.push_back(index);
+    numEntries--;
+}
+
+void MACAddressTable::refreshEntry(int index, simtime_t insertionTime)
+{
+    unlinkEntry(index);
+    entries[index].insertionTime = insertionTime;
+    linkEntry(index);
+}
+
+/*
+ * Inserts the entry into the aging list according to its insertion time.
+ * Usually it is the most recent one, so this is constant time.
+ */
+void MACAddressTable::linkEntry(int index)
+{
+    AddressEntry& entry = entries[index];
+    int prev = agingListTail;
+    while (prev != -1 && entries[prev].insertionTime > entry.insertionTime)
+        prev = entries[prev].prev;
+    int next = prev == -1 ? agingListHead : entries[prev].next;
+    entry.prev = prev;
+    entry.next = next;
+    if (prev == -1)
+        agingListHead = index;
+    else
+        entries[prev].next = index;
+    if (next == -1)
+        agingListTail = index;
+    else
+        entries[next].prev = index;
+}
 
-MACAddressTable::AddressTable * MACAddressTable::getTableForVid(unsigned int vid)
+void MACAddressTable::unlinkEntry(int index)
 {
-    if (vid == 0)
-        return addressTable;
-
-    MACAddressTable::VlanAddressTable::iterator iter;
-    iter = vlanAddressTable.find(vid);
-    if (iter != vlanAddressTable.end())
-        return iter->second;
-    return NULL;
+    AddressEntry& entry = entries[index];
+    if (entry.prev == -1)
+        agingListHead = entry.next;
+    else
+        entries[entry.prev].next = entry.next;
+    if (entry.next == -1)
+        agingListTail = entry.prev;
+    else
+        entries[entry.next].prev = entry.prev;
+    entry.prev = entry.next = -1;
+}
+
+void MACAddressTable::resizeSlots(int numSlots)
+{
+    slots.assign(numSlots, -1);
+    for (int index = agingListHead; index != -1; index = entries[index].next)
+        slots[findSlot(entries[index].address, entries[index].vid)] = index;
 }
 
 /*
@@ -107,26 +229,22 @@ int MACAddressTable::getPortForAddress(MACAddress& address, unsigned int vid)
 {
     Enter_Method("MACAddressTable::getPortForAddress()");
 
-    AddressTable * table = getTableForVid(vid);
-    // VLAN ID vid does not exist
-    if (table == NULL)
-        return -1;
-
-    AddressTable::iterator iter = table->find(address);
+    int index = findEntry(address, vid);
 
-    if (iter == table->end())
+    if (index == -1)
     {
         // not found
         return -1;
     }
-    if (iter->second.insertionTime + agingTime <= simTime())
+    AddressEntry& entry = entries[index];
+    if (entry.insertionTime + agingTime <= simTime())
     {
         // don't use (and throw out) aged entries
-        EV<< "Ignoring and deleting aged entry: "<< iter->first << " --> port" << iter->second.portno << "\n";
-        table->erase(iter);
+        EV<< "Ignoring and deleting aged entry: "<< entry.address << " --> port" << entry.portno << "\n";
+        removeEntry(index);
         return -1;
     }
-    return iter->second.portno;
+    return entry.portno;
 }
 
 /*
@@ -140,40 +258,23 @@ bool MACAddressTable::updateTableWithAddress(int portno, MACAddress& address, un
     if (address.isBroadcast())
         return false;
 
-    AddressTable::iterator iter;
-    AddressTable * table = getTableForVid(vid);
-
-    if (table == NULL)
-    {
-        // MAC Address Table does not exist for VLAN ID vid, so we create it
-        table = new AddressTable();
-
-        // set 'the addressTable' to VLAN ID 0
-        if (vid == 0)
-            addressTable = table;
+    int index = findEntry(address, vid);
 
-        vlanAddressTable[vid] = table;
-        iter = table->end();
-    }
-    else
-        iter = table->find(address);
-
-    if (iter == table->end())
+    if (index == -1)
     {
         removeAgedEntriesIfNeeded();
 
         // Add entry to table
         EV<< "Adding entry to Address Table: "<< address << " --> port" << portno << "\n";
-        (*table)[address] = AddressEntry(vid,portno,simTime());
+        addEntry(address, vid, portno, simTime());
         return false;
     }
     else
     {
         // Update existing entry
         EV << "Updating entry in Address Table: "<< address << " --> port" << portno << "\n";
-        AddressEntry& entry = iter->second;
-        entry.insertionTime = simTime();
-        entry.portno = portno;
+        entries[index].portno = portno;
+        refreshEntry(index, simTime());
     }
     return true;
 }
@@ -185,83 +286,76 @@ bool MACAddressTable::updateTableWithAddress(int portno, MACAddress& address, un
 void MACAddressTable::flush(int portno)
 {
     Enter_Method("MACAddressTable::flush():  Clearing gate %d cache", portno);
-    for (VlanAddressTable::iterator i = vlanAddressTable.begin(); i != vlanAddressTable.end(); i++)
+    for (int index = agingListHead; index != -1;)
     {
-        AddressTable * table = i->second;
-        for (AddressTable::iterator j = table->begin(); j != table->end();)
-        {
-            AddressTable::iterator cur = j++;
-            if (cur->second.portno == portno)
-                table->erase(cur);
-        }
-
+        int cur = index;
+        index = entries[index].next;
+        if (entries[cur].portno == portno)
+            removeEntry(cur);
     }
 }
+
+static bool compareByVidAndAddress(const std::pair<unsigned int, MACAddress>& a, const std::pair<unsigned int, MACAddress>& b)
+{
+    return a.first != b.first ? a.first < b.first : a.second.compareTo(b.second) < 0;
+}
+
 /*
  * Prints verbose information
  */
 
 void MACAddressTable::printState()
 {
+    // print in VLAN ID, MAC address order
+    std::vector<std::pair<unsigned int, MACAddress> > keys;
+    for (int index = agingListHead; index != -1; index = entries[index].next)
+        keys.push_back(std::make_pair(entries[index].vid, entries[index].address));
+    std::sort(keys.begin(), keys.end(), compareByVidAndAddress);
+
     EV<< endl << "MAC Address Table" << endl;
     EV << "VLAN ID    MAC    Port    Inserted" << endl;
-    for (VlanAddressTable::iterator i = vlanAddressTable.begin(); i != vlanAddressTable.end(); i++)
+    for (int i = 0; i < (int)keys.size(); i++)
     {
-        AddressTable * table = i->second;
-        for (AddressTable::iterator j = table->begin(); j != table->end(); j++)
-        EV << j->second.vid << "   " << j->first << "   " << j->second.portno << "   " << j->second.insertionTime << endl;
+        const AddressEntry& entry = entries[findEntry(keys[i].second, keys[i].first)];
+        EV << entry.vid << "   " << entry.address << "   " << entry.portno << "   " << entry.insertionTime << endl;
     }
-
 }
 
 void MACAddressTable::copyTable(int portA, int portB)
 {
-    for (VlanAddressTable::iterator i = vlanAddressTable.begin(); i != vlanAddressTable.end(); i++)
-    {
-        AddressTable * table = i->second;
-        for (AddressTable::iterator j = table->begin(); j != table->end(); j++)
-            if (j->second.portno == portA)
-                j->second.portno = portB;
-    }
+    for (int index = agingListHead; index != -1; index = entries[index].next)
+        if (entries[index].portno == portA)
+            entries[index].portno = portB;
 }
 
-void MACAddressTable::removeAgedEntriesFromVlan(unsigned int vid)
+/*
+ * Removes the expired entries; they form a prefix of the aging list.
+ */
+void MACAddressTable::removeAgedEntries(bool allVlans, unsigned int vid)
 {
-    AddressTable * table = getTableForVid(vid);
-    if (table == NULL)
-        return;
-    // TODO: this part could be factored out
-    for (AddressTable::iterator iter = table->begin(); iter != table->end();)
+    simtime_t now = simTime();
+    for (int index = agingListHead; index != -1 && entries[index].insertionTime + agingTime <= now;)
     {
-        AddressTable::iterator cur = iter++; // iter will get invalidated after erase()
-        AddressEntry& entry = cur->second;
-        if (entry.insertionTime + agingTime <= simTime())
+        int cur = index;
+        index = entries[index].next;
+        AddressEntry& entry = entries[cur];
+        if (allVlans || entry.vid == vid)
         {
             EV<< "Removing aged entry from Address Table: " <<
-            cur->first << " --> port" << cur->second.portno << "\n";
-            table->erase(cur);
+            entry.address << " --> port" << entry.portno << "\n";
+            removeEntry(cur);
         }
     }
 }
 
+void MACAddressTable::removeAgedEntriesFromVlan(unsigned int vid)
+{
+    removeAgedEntries(false, vid);
+}
+
 void MACAddressTable::removeAgedEntriesFromAllVlans()
 {
-    for (VlanAddressTable::iterator i = vlanAddressTable.begin(); i != vlanAddressTable.end(); i++)
-    {
-        AddressTable * table = i->second;
-        // TODO: this part could be factored out
-        for (AddressTable::iterator j = table->begin(); j != table->end();)
-        {
-            AddressTable::iterator cur = j++; // iter will get invalidated after erase()
-            AddressEntry& entry = cur->second;
-            if (entry.insertionTime + agingTime <= simTime())
-            {
-                EV<< "Removing aged entry from Address Table: " <<
-                cur->first << " --> port" << cur->second.portno << "\n";
-                table->erase(cur);
-            }
-        }
-    }
+    removeAgedEntries(true, 0);
 }
 
 void MACAddressTable::removeAgedEntriesIfNeeded()
@@ -316,17 +410,17 @@ void MACAddressTable::readAddressTable(const char* fileName)
             error("line %d invalid in address table file `%s'", lineno, fileName);
 
         // Create an entry with address and portno and insert into table
-        AddressEntry entry(atoi(vlanID), atoi(portno), 0);
-        AddressTable * table = getTableForVid(entry.vid);
-
-        if(table == NULL)
+        unsigned int vid = atoi(vlanID);
+        MACAddress address(hexaddress);
+        int index = findEntry(address, vid);
+        if (index == -1)
+            addEntry(address, vid, atoi(portno), 0);
+        else
         {
-            table = new AddressTable();
-            vlanAddressTable[entry.vid] = table;
+            entries[index].portno = atoi(portno);
+            refreshEntry(index, 0);
         }
 
-        (*table)[MACAddress(hexaddress)] = entry;
-
         // Garbage collection before next iteration
         delete [] line;
     }
@@ -335,17 +429,15 @@ void MACAddressTable::readAddressTable(const char* fileName)
 
 void MACAddressTable::clearTable()
 {
-    for (VlanAddressTable::iterator iter = vlanAddressTable.begin(); iter != vlanAddressTable.end(); iter++)
-        delete iter->second;
-
-    vlanAddressTable.clear();
-    addressTable = NULL;
+    entries.clear();
+    freeEntries.clear();
+    slots.assign(MIN_SLOTS, -1);
+    numEntries = 0;
+    agingListHead = agingListTail = -1;
 }
 
 MACAddressTable::~MACAddressTable()
 {
-    for (VlanAddressTable::iterator iter = vlanAddressTable.begin(); iter != vlanAddressTable.end(); iter++)
-        delete iter->second;
 }
 void MACAddressTable::setAgingTime(simtime_t agingTime)
 {
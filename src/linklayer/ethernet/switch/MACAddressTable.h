@@ -17,6 +17,8 @@
 #ifndef __INET_MACADDRESSTABLE_H_
 #define __INET_MACADDRESSTABLE_H_
 
+#include <vector>
+
 #include "MACAddress.h"
 #include "IMACAddressTable.h"
 
@@ -29,37 +31,46 @@ class MACAddressTable : public cSimpleModule, public IMACAddressTable
         struct AddressEntry
         {
                 unsigned int vid;           // VLAN ID
-                int portno;                 // Input port
+                int portno;                 // Input port, -1 for unused entries
                 simtime_t insertionTime;    // Arrival time of Lookup Address Table entry
-                AddressEntry() : vid(0) { }
+                MACAddress address;
+                int prev;                   // aging list: entries in increasing insertionTime order
+                int next;
+                AddressEntry() : vid(0), portno(-1), prev(-1), next(-1) { }
                 AddressEntry(unsigned int vid, int portno, simtime_t insertionTime) :
-                        vid(vid), portno(portno), insertionTime(insertionTime) { }
+                        vid(vid), portno(portno), insertionTime(insertionTime), prev(-1), next(-1) { }
         };
         friend std::ostream& operator<<(std::ostream& os, const AddressEntry& entry);
 
-        struct MAC_compare
-        {
-            bool operator()(const MACAddress& u1, const MACAddress& u2) const {return u1.compareTo(u2) < 0;}
-        };
-
-
-        typedef std::map<MACAddress, AddressEntry, MAC_compare> AddressTable;
-        typedef std::map<unsigned int, AddressTable*> VlanAddressTable;
-
+        // Entries of all VLANs live in one pool, indexed by an open addressing hash table
+        // (linear probing) keyed on (VLAN ID, MAC address). As entries are always stamped
+        // with the current time, a list in insertion/refresh order is also ordered by
+        // expiry, so aging only visits the entries that actually expire.
         simtime_t agingTime;                // Max idle time for address table entries
         simtime_t lastPurge;                // Time of the last call of removeAgedEntriesFromAllVlans()
-        AddressTable * addressTable;        // VLAN-unaware address lookup (vid = 0)
-        VlanAddressTable vlanAddressTable;  // VLAN-aware address lookup
+        std::vector<AddressEntry> entries;  // entry pool
+        std::vector<int> freeEntries;       // indices of unused entries in the pool
+        std::vector<int> slots;             // hash table of entry indices, -1 for empty slots; size is a power of 2
+        int numEntries;
+        int agingListHead;                  // least recently refreshed entry
+        int agingListTail;                  // most recently refreshed entry
 
     protected:
 
         virtual void initialize();
         virtual void handleMessage(cMessage *msg);
 
-        /**
-         * @brief Returns a MAC Address Table for a specified VLAN ID
-         */
-        AddressTable * getTableForVid(unsigned int vid);
+        // hash table and aging list operations
+        static unsigned int hashOf(const MACAddress& address, unsigned int vid);
+        int findSlot(const MACAddress& address, unsigned int vid) const;
+        int findEntry(const MACAddress& address, unsigned int vid) const;
+        int addEntry(const MACAddress& address, unsigned int vid, int portno, simtime_t insertionTime);
+        void removeEntry(int index);
+        void refreshEntry(int index, simtime_t insertionTime);
+        void linkEntry(int index);
+        void unlinkEntry(int index);
+        void resizeSlots(int numSlots);
+        void removeAgedEntries(bool allVlans, unsigned int vid);
 
     public:
 
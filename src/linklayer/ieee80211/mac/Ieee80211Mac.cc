@@ -61,6 +61,7 @@ Ieee80211Mac::Ieee80211Mac()
 {
     endSIFS = NULL;
     endDIFS = NULL;
+    virtualEdcaTimers = false;
     endTimeout = NULL;
     endReserve = NULL;
     mediumStateChange = NULL;
@@ -226,7 +227,6 @@ void Ieee80211Mac::initialize(int stage)
         duplicateDetect = par("duplicateDetectionFilter");
         purgeOldTuples = par("purgeOldTuples");
         duplicateTimeOut = par("duplicateTimeOut");
-        lastTimeDelete = 0;
 
         if (bitrate == -1)
         {
@@ -293,6 +293,23 @@ void Ieee80211Mac::initialize(int stage)
             setEndAIFS(i, new cMessage("AIFS", i));
             setEndBackoff(i, new cMessage("Backoff", i));
         }
+        virtualEdcaTimers = par("virtualEdcaTimers");
+        edcaTimerSequence = 0;
+        if (virtualEdcaTimers)
+        {
+            EdcaTimer timer;
+            timer.scheduled = false;
+            timer.sequenceNumber = -1;
+            timer.msg = endDIFS;
+            edcaTimers.push_back(timer);
+            for (int i=0; i<numCategories(); i++)
+            {
+                timer.msg = endAIFS(i);
+                edcaTimers.push_back(timer);
+                timer.msg = endBackoff(i);
+                edcaTimers.push_back(timer);
+            }
+        }
         endTXOP = new cMessage("TXOP");
         endTimeout = new cMessage("Timeout");
         endReserve = new cMessage("Reserve");
@@ -543,6 +560,9 @@ void Ieee80211Mac::initializeQueueModule()
  */
 void Ieee80211Mac::handleSelfMsg(cMessage *msg)
 {
+    if (virtualEdcaTimers)
+        handleEdcaTimer(msg);
+
     if (msg==throughputTimer)
     {
         throughputLastPeriod = recBytesOverPeriod/SIMTIME_DBL(throughputTimePeriod);
@@ -574,14 +594,14 @@ void Ieee80211Mac::handleSelfMsg(cMessage *msg)
         EV <<" kind is " << kind << ",name is " << msg->getName() <<endl;
         for (unsigned int i = numCategories()-1; (int)i > kind; i--)  //mozna prochaze jen 3..kind XXX
         {
-            if (((endBackoff(i)->isScheduled() && endBackoff(i)->getArrivalTime() == simTime())
-                    || (endAIFS(i)->isScheduled() && !backoff(i) && endAIFS(i)->getArrivalTime() == simTime()))
+            if (((isEdcaTimerScheduled(endBackoff(i)) && getEdcaTimerArrivalTime(endBackoff(i)) == simTime())
+                    || (isEdcaTimerScheduled(endAIFS(i)) && !backoff(i) && getEdcaTimerArrivalTime(endAIFS(i)) == simTime()))
                     && !transmissionQueue(i)->empty())
             {
                 EV << "Internal collision AC" << kind << " with AC" << i << endl;
                 numInternalCollision++;
                 EV << "Cancel backoff event and schedule new one for AC" << kind << endl;
-                cancelEvent(endBackoff(kind));
+                cancelEdcaTimer(endBackoff(kind));
                 if (retryCounter() == transmissionLimit - 1)
                 {
                     EV << "give up transmission for AC" << currentAC << endl;
@@ -870,23 +890,23 @@ void Ieee80211Mac::handleWithFSM(cMessage *msg)
     // skip those cases where there's nothing to do, so the switch looks simpler
     if (isUpperMsg(msg) && fsm.getState() != IDLE)
     {
-        if (fsm.getState() == WAITAIFS && endDIFS->isScheduled())
+        if (fsm.getState() == WAITAIFS && isEdcaTimerScheduled(endDIFS))
         {
             // a difs was schedule because all queues ware empty
             // change difs for aifs
             simtime_t remaint = getAIFS(currentAC)-getDIFS();
-            scheduleAt(endDIFS->getArrivalTime()+remaint, endAIFS(currentAC));
-            cancelEvent(endDIFS);
+            scheduleEdcaTimer(getEdcaTimerArrivalTime(endDIFS)+remaint, endAIFS(currentAC));
+            cancelEdcaTimer(endDIFS);
         }
-        else if (fsm.getState() == BACKOFF && endBackoff(numCategories()-1)->isScheduled() &&  transmissionQueue(numCategories()-1)->empty())
+        else if (fsm.getState() == BACKOFF && isEdcaTimerScheduled(endBackoff(numCategories()-1)) &&  transmissionQueue(numCategories()-1)->empty())
         {
             // a backoff was schedule with all the queues empty
             // reschedule the backoff with the appropriate AC
             backoffPeriod(currentAC) = backoffPeriod(numCategories()-1);
             backoff(currentAC) = backoff(numCategories()-1);
             backoff(numCategories()-1) = false;
-            scheduleAt(endBackoff(numCategories()-1)->getArrivalTime(), endBackoff(currentAC));
-            cancelEvent(endBackoff(numCategories()-1));
+            scheduleEdcaTimer(getEdcaTimerArrivalTime(endBackoff(numCategories()-1)), endBackoff(currentAC));
+            cancelEdcaTimer(endBackoff(numCategories()-1));
         }
         EV << "deferring upper message transmission in " << fsm.getStateName() << " state\n";
         return;
@@ -1042,10 +1062,10 @@ void Ieee80211Mac::handleWithFSM(cMessage *msg)
                                   DEFER,
                                   for (int i=0; i<numCategories(); i++)
                                   {
-                                      if (endAIFS(i)->isScheduled())
+                                      if (isEdcaTimerScheduled(endAIFS(i)))
                                           backoff(i) = true;
                                   }
-                                  if (endDIFS->isScheduled()) backoff(numCategories()-1) = true;
+                                  if (isEdcaTimerScheduled(endDIFS)) backoff(numCategories()-1) = true;
                                   cancelAIFSPeriod();
                                   );
             FSMA_No_Event_Transition(Immediate-Busy,
@@ -1053,10 +1073,10 @@ void Ieee80211Mac::handleWithFSM(cMessage *msg)
                                      DEFER,
                                      for (int i=0; i<numCategories(); i++)
                                      {
-                                         if (endAIFS(i)->isScheduled())
+                                         if (isEdcaTimerScheduled(endAIFS(i)))
                                              backoff(i) = true;
                                      }
-                                     if (endDIFS->isScheduled()) backoff(numCategories()-1) = true;
+                                     if (isEdcaTimerScheduled(endDIFS)) backoff(numCategories()-1) = true;
                                      cancelAIFSPeriod();
 
                                      );
@@ -1571,19 +1591,19 @@ void Ieee80211Mac::scheduleDIFSPeriod()
     if (lastReceiveFailed)
     {
         EV << "reception of last frame failed, scheduling EIFS period\n";
-        scheduleAt(simTime() + getEIFS(), endDIFS);
+        scheduleEdcaTimer(simTime() + getEIFS(), endDIFS);
     }
     else
     {
         EV << "scheduling DIFS period\n";
-        scheduleAt(simTime() + getDIFS(), endDIFS);
+        scheduleEdcaTimer(simTime() + getDIFS(), endDIFS);
     }
 }
 
 void Ieee80211Mac::cancelDIFSPeriod()
 {
     EV << "canceling DIFS period\n";
-    cancelEvent(endDIFS);
+    cancelEdcaTimer(endDIFS);
 }
 
 void Ieee80211Mac::scheduleAIFSPeriod()
@@ -1591,25 +1611,25 @@ void Ieee80211Mac::scheduleAIFSPeriod()
     bool schedule = false;
     for (int i = 0; i<numCategories(); i++)
     {
-        if (!endAIFS(i)->isScheduled() && !transmissionQueue(i)->empty())
+        if (!isEdcaTimerScheduled(endAIFS(i)) && !transmissionQueue(i)->empty())
         {
 
             if (lastReceiveFailed)
             {
                 EV << "reception of last frame failed, scheduling EIFS-DIFS+AIFS period (" << i << ")\n";
-                scheduleAt(simTime() + getEIFS() - getDIFS() + getAIFS(i), endAIFS(i));
+                scheduleEdcaTimer(simTime() + getEIFS() - getDIFS() + getAIFS(i), endAIFS(i));
             }
             else
             {
                 EV << "scheduling AIFS period (" << i << ")\n";
-                scheduleAt(simTime() + getAIFS(i), endAIFS(i));
+                scheduleEdcaTimer(simTime() + getAIFS(i), endAIFS(i));
             }
 
         }
-        if (endAIFS(i)->isScheduled())
+        if (isEdcaTimerScheduled(endAIFS(i)))
             schedule = true;
     }
-    if (!schedule && !endDIFS->isScheduled())
+    if (!schedule && !isEdcaTimerScheduled(endDIFS))
     {
         // schedule default DIFS
         currentAC = numCategories()-1;
@@ -1621,16 +1641,16 @@ void Ieee80211Mac::rescheduleAIFSPeriod(int AccessCategory)
 {
     ASSERT(1);
     EV << "rescheduling AIFS[" << AccessCategory << "]\n";
-    cancelEvent(endAIFS(AccessCategory));
-    scheduleAt(simTime() + getAIFS(AccessCategory), endAIFS(AccessCategory));
+    cancelEdcaTimer(endAIFS(AccessCategory));
+    scheduleEdcaTimer(simTime() + getAIFS(AccessCategory), endAIFS(AccessCategory));
 }
 
 void Ieee80211Mac::cancelAIFSPeriod()
 {
     EV << "canceling AIFS period\n";
     for (int i = 0; i<numCategories(); i++)
-        cancelEvent(endAIFS(i));
-    cancelEvent(endDIFS);
+        cancelEdcaTimer(endAIFS(i));
+    cancelEdcaTimer(endDIFS);
 }
 
 //XXXvoid Ieee80211Mac::checkInternalColision()
@@ -1750,11 +1770,11 @@ void Ieee80211Mac::decreaseBackoffPeriod()
     // cancel event endBackoff after decrease or we don't know which endBackoff is scheduled
     for (int i = 0; i<numCategories(); i++)
     {
-        if (backoff(i) && endBackoff(i)->isScheduled())
+        if (backoff(i) && isEdcaTimerScheduled(endBackoff(i)))
         {
             EV<< "old backoff[" << i << "] is " << backoffPeriod(i) << ", sim time is " << simTime()
-            << ", endbackoff sending period is " << endBackoff(i)->getSendingTime() << endl;
-            simtime_t elapsedBackoffTime = simTime() - endBackoff(i)->getSendingTime();
+            << ", endbackoff sending period is " << getEdcaTimerSendingTime(endBackoff(i)) << endl;
+            simtime_t elapsedBackoffTime = simTime() - getEdcaTimerSendingTime(endBackoff(i));
             backoffPeriod(i) -= ((int)(elapsedBackoffTime / getSlotTime())) * getSlotTime();
             EV << "actual backoff[" << i << "] is " <<backoffPeriod(i) << ", elapsed is " << elapsedBackoffTime << endl;
             ASSERT(backoffPeriod(i) >= SIMTIME_ZERO);
@@ -1766,14 +1786,147 @@ void Ieee80211Mac::decreaseBackoffPeriod()
 void Ieee80211Mac::scheduleBackoffPeriod()
 {
     EV << "scheduling backoff period\n";
-    scheduleAt(simTime() + backoffPeriod(), endBackoff());
+    scheduleEdcaTimer(simTime() + backoffPeriod(), endBackoff());
 }
 
 void Ieee80211Mac::cancelBackoffPeriod()
 {
     EV << "cancelling Backoff period - only if some is scheduled\n";
     for (int i = 0; i<numCategories(); i++)
-        cancelEvent(endBackoff(i));
+        cancelEdcaTimer(endBackoff(i));
+}
+
+/****************************************************************
+ * EDCA timer functions.
+ */
+void Ieee80211Mac::scheduleEdcaTimer(simtime_t time, cMessage *msg)
+{
+    if (!virtualEdcaTimers)
+    {
+        cSimpleModule::scheduleAt(time, msg);
+        return;
+    }
+    EdcaTimer *timer = findEdcaTimer(msg);
+    if (timer->scheduled)
+        error("scheduleEdcaTimer(): message (%s)%s is currently scheduled, use cancelEdcaTimer() before rescheduling", msg->getClassName(), msg->getName());
+    timer->scheduled = true;
+    timer->arrivalTime = time;
+    timer->sendingTime = simTime();
+    timer->sequenceNumber = edcaTimerSequence++;
+    for (unsigned int i = 0; i < edcaTimers.size(); i++)
+    {
+        if (&edcaTimers[i] != timer && edcaTimers[i].scheduled && edcaTimers[i].arrivalTime == time)
+        {
+            insertEdcaTimers(time);
+            break;
+        }
+    }
+    insertEarliestEdcaTimer();
+}
+
+void Ieee80211Mac::cancelEdcaTimer(cMessage *msg)
+{
+    if (!virtualEdcaTimers)
+    {
+        cancelEvent(msg);
+        return;
+    }
+    findEdcaTimer(msg)->scheduled = false;
+    if (msg->isScheduled())
+        cancelEvent(msg);
+    insertEarliestEdcaTimer();
+}
+
+bool Ieee80211Mac::isEdcaTimerScheduled(cMessage *msg)
+{
+    return virtualEdcaTimers ? findEdcaTimer(msg)->scheduled : msg->isScheduled();
+}
+
+simtime_t Ieee80211Mac::getEdcaTimerArrivalTime(cMessage *msg)
+{
+    return virtualEdcaTimers ? findEdcaTimer(msg)->arrivalTime : msg->getArrivalTime();
+}
+
+simtime_t Ieee80211Mac::getEdcaTimerSendingTime(cMessage *msg)
+{
+    return virtualEdcaTimers ? findEdcaTimer(msg)->sendingTime : msg->getSendingTime();
+}
+
+Ieee80211Mac::EdcaTimer *Ieee80211Mac::findEdcaTimer(cMessage *msg)
+{
+    for (unsigned int i = 0; i < edcaTimers.size(); i++)
+        if (edcaTimers[i].msg == msg)
+            return &edcaTimers[i];
+    error("findEdcaTimer(): (%s)%s is not an EDCA timer", msg->getClassName(), msg->getName());
+    return NULL;
+}
+
+/**
+ * Inserts the timers expiring at the given time that are not in the FES
+ * yet, in the order they were scheduled.
+ */
+void Ieee80211Mac::insertEdcaTimers(simtime_t time)
+{
+    while (true)
+    {
+        EdcaTimer *first = NULL;
+        for (unsigned int i = 0; i < edcaTimers.size(); i++)
+        {
+            EdcaTimer& timer = edcaTimers[i];
+            if (timer.scheduled && !timer.msg->isScheduled() && timer.arrivalTime == time
+                    && (!first || timer.sequenceNumber < first->sequenceNumber))
+                first = &timer;
+        }
+        if (!first)
+            break;
+        cSimpleModule::scheduleAt(first->arrivalTime, first->msg);
+    }
+}
+
+/**
+ * Makes sure that the earliest timer (by arrival time, then by sequence
+ * number, like in the FES) is in the FES. Timers already in the FES stay
+ * there, so that their position among the events of the same time is kept.
+ */
+void Ieee80211Mac::insertEarliestEdcaTimer()
+{
+    EdcaTimer *earliest = NULL;
+    for (unsigned int i = 0; i < edcaTimers.size(); i++)
+    {
+        EdcaTimer& timer = edcaTimers[i];
+        if (!timer.scheduled)
+            continue;
+        if (!earliest || timer.arrivalTime < earliest->arrivalTime
+                || (timer.arrivalTime == earliest->arrivalTime && timer.sequenceNumber < earliest->sequenceNumber))
+            earliest = &timer;
+    }
+    if (earliest && !earliest->msg->isScheduled())
+        cSimpleModule::scheduleAt(earliest->arrivalTime, earliest->msg);
+}
+
+/**
+ * Called for every self message; when msg is an EDCA timer, marks it as
+ * expired and inserts the next timer, before the handling of msg schedules
+ * anything else.
+ */
+void Ieee80211Mac::handleEdcaTimer(cMessage *msg)
+{
+    for (unsigned int i = 0; i < edcaTimers.size(); i++)
+    {
+        if (edcaTimers[i].msg == msg)
+        {
+            edcaTimers[i].scheduled = false;
+            insertEarliestEdcaTimer();
+            return;
+        }
+    }
+}
+
+int Ieee80211Mac::scheduleAt(simtime_t t, cMessage *msg)
+{
+    if (virtualEdcaTimers)
+        insertEdcaTimers(t);
+    return cSimpleModule::scheduleAt(t, msg);
 }
 
 /****************************************************************
@@ -2211,10 +2364,10 @@ void Ieee80211Mac::logState()
         EV << " " << transmissionQueue(i)->size();
     EV << ", medium is " << (isMediumFree() ? "free" : "busy") << ", scheduled AIFS are";
     for (int i=0; i<numCategs; i++)
-        EV << " " << i << "(" << (edcCAF[i].endAIFS->isScheduled() ? "scheduled" : "") << ")";
+        EV << " " << i << "(" << (isEdcaTimerScheduled(edcCAF[i].endAIFS) ? "scheduled" : "") << ")";
     EV << ", scheduled backoff are";
     for (int i=0; i<numCategs; i++)
-        EV << " " << i << "(" << (edcCAF[i].endBackoff->isScheduled() ? "scheduled" : "") << ")";
+        EV << " " << i << "(" << (isEdcaTimerScheduled(edcCAF[i].endBackoff) ? "scheduled" : "") << ")";
     EV << "\n# currentAC: " << currentAC << ", oldcurrentAC: " << oldcurrentAC;
     if (getCurrentTransmission() != NULL)
         EV << "\n# current transmission: " << getCurrentTransmission()->getId();
@@ -2741,19 +2894,13 @@ void Ieee80211Mac::sendUp(cMessage *msg)
 
 void Ieee80211Mac::removeOldTuplesFromDuplicateMap()
 {
-    if (duplicateDetect && lastTimeDelete+duplicateTimeOut>=simTime())
+    if (duplicateDetect && purgeOldTuples)
     {
-        lastTimeDelete=simTime();
-        for (Ieee80211ASFTupleList::iterator it = asfTuplesList.begin(); it!=asfTuplesList.end(); )
+        // the expired tuples are at the front of the aging list
+        while (!asfAgingList.empty() && asfAgingList.front().first+duplicateTimeOut<simTime())
         {
-            if (it->second.receivedTime+duplicateTimeOut<simTime())
-            {
-                Ieee80211ASFTupleList::iterator itAux=it;
-                it++;
-                asfTuplesList.erase(itAux);
-            }
-            else
-                it++;
+            asfTuplesList.erase(asfAgingList.front().second);
+            asfAgingList.pop_front();
         }
     }
 }
@@ -2787,13 +2934,15 @@ bool Ieee80211Mac::isDuplicated(cMessage *msg)
                 tuple.receivedTime = simTime();
                 tuple.sequenceNumber = frame->getSequenceNumber();
                 tuple.fragmentNumber = frame->getFragmentNumber();
+                tuple.agingListPos = asfAgingList.insert(asfAgingList.end(), std::make_pair(tuple.receivedTime, frame->getTransmitterAddress()));
                 asfTuplesList.insert(std::pair<MACAddress, Ieee80211ASFTuple>(frame->getTransmitterAddress(), tuple));
             }
             else
             {
-                // check if duplicate
+                // check if duplicate (timed out tuples may still be here if they are not purged)
                 if (it->second.sequenceNumber == frame->getSequenceNumber()
-                        && it->second.fragmentNumber == frame->getFragmentNumber())
+                        && it->second.fragmentNumber == frame->getFragmentNumber()
+                        && it->second.receivedTime+duplicateTimeOut>=simTime())
                 {
                     return true;
                 }
@@ -2803,6 +2952,8 @@ bool Ieee80211Mac::isDuplicated(cMessage *msg)
                     it->second.sequenceNumber = frame->getSequenceNumber();
                     it->second.fragmentNumber = frame->getFragmentNumber();
                     it->second.receivedTime = simTime();
+                    asfAgingList.splice(asfAgingList.end(), asfAgingList, it->second.agingListPos);
+                    it->second.agingListPos->first = simTime();
                 }
             }
         }
@@ -60,6 +60,12 @@
 class INET_API Ieee80211Mac : public WirelessMacBase
 {
     typedef std::list<Ieee80211DataOrMgmtFrame*> Ieee80211DataOrMgmtFrameList;
+    /**
+     * Transmitter addresses of the tuples in increasing receivedTime order,
+     * used to expire old tuples.
+     */
+    typedef std::list<std::pair<simtime_t, MACAddress> > Ieee80211ASFAgingList;
+
     /**
      * This is used to populate fragments and identify duplicated messages. See spec 9.2.9.
      */
@@ -68,14 +74,7 @@ class INET_API Ieee80211Mac : public WirelessMacBase
         int sequenceNumber;
         int fragmentNumber;
         simtime_t receivedTime;
-        Ieee80211ASFTuple& operator=(const Ieee80211ASFTuple& other)
-        {
-            if (this==&other) return *this;
-            this->sequenceNumber = other.sequenceNumber;
-            this->fragmentNumber = other.fragmentNumber;
-            this->receivedTime = other.receivedTime;
-            return *this;
-        }
+        Ieee80211ASFAgingList::iterator agingListPos;
     };
 
     typedef std::map<MACAddress, Ieee80211ASFTuple> Ieee80211ASFTupleList;
@@ -353,8 +352,8 @@ class INET_API Ieee80211Mac : public WirelessMacBase
     bool duplicateDetect;
     bool purgeOldTuples;
     simtime_t duplicateTimeOut;
-    simtime_t lastTimeDelete;
     Ieee80211ASFTupleList asfTuplesList;
+    Ieee80211ASFAgingList asfAgingList;
 
     /** Passive queue module to request messages from */
     IPassiveQueue *queueModule;
@@ -392,6 +391,26 @@ class INET_API Ieee80211Mac : public WirelessMacBase
 
     /** Radio state change self message. Currently this is optimized away and sent directly */
     cMessage *mediumStateChange;
+
+    /**
+     * State of the DIFS, AIFS and backoff timers when virtualEdcaTimers is on.
+     * The earliest of them is always in the FES; the others are kept here and
+     * inserted when they become the earliest one. A timer that expires at the
+     * same time as another timer or self message of the MAC is inserted right
+     * away, so that the FES delivers them in the same order as without
+     * virtual timers.
+     */
+    struct EdcaTimer
+    {
+        cMessage *msg;
+        bool scheduled;
+        simtime_t arrivalTime;
+        simtime_t sendingTime;
+        long sequenceNumber;  // orders timers with the same arrival time like the FES would
+    };
+    bool virtualEdcaTimers;
+    std::vector<EdcaTimer> edcaTimers;
+    long edcaTimerSequence;
     //@}
 
   protected:
@@ -524,6 +543,31 @@ class INET_API Ieee80211Mac : public WirelessMacBase
     virtual void finishReception();
     //@}
 
+  protected:
+    /**
+     * @name EDCA timer functions
+     * @brief Used instead of scheduleAt(), cancelEvent() etc. for the DIFS,
+     * AIFS and backoff timers, see virtualEdcaTimers.
+     */
+    //@{
+    virtual void scheduleEdcaTimer(simtime_t time, cMessage *msg);
+    virtual void cancelEdcaTimer(cMessage *msg);
+    virtual bool isEdcaTimerScheduled(cMessage *msg);
+    virtual simtime_t getEdcaTimerArrivalTime(cMessage *msg);
+    virtual simtime_t getEdcaTimerSendingTime(cMessage *msg);
+    virtual EdcaTimer *findEdcaTimer(cMessage *msg);
+    virtual void insertEdcaTimers(simtime_t time);
+    virtual void insertEarliestEdcaTimer();
+    virtual void handleEdcaTimer(cMessage *msg);
+
+    /**
+     * Schedules a self message other than the EDCA timers. Timers tracked
+     * internally that expire at the same time are inserted first, as they
+     * were scheduled earlier.
+     */
+    int scheduleAt(simtime_t t, cMessage *msg);
+    //@}
+
   protected:
     /**
      * @name Frame transmission functions
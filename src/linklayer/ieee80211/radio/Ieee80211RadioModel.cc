@@ -23,6 +23,7 @@
 #include "FWMath.h"
 #include "yans-error-rate-model.h"
 #include "nist-error-rate-model.h"
+#include "TableErrorRateModel.h"
 #define NS3CALMODE
 
 
@@ -59,12 +60,15 @@ void Ieee80211RadioModel::initializeFrom(cModule *radioModule)
     else
         phyOpMode = 'g';
 
-    if (strcmp("YansModel", radioModule->par("errorModel").stringValue())==0)
+    const char *errorModelName = radioModule->par("errorModel").stringValue();
+    if (strcmp("YansModel", errorModelName)==0)
         errorModel = new YansErrorRateModel();
-    else if (strcmp("NistModel", radioModule->par("errorModel").stringValue())==0)
+    else if (strcmp("NistModel", errorModelName)==0)
         errorModel = new NistErrorRateModel();
     else
-        opp_error("Error %s model is not valid",radioModule->par("errorModel").stringValue());
+        opp_error("Error %s model is not valid", errorModelName);
+    if (radioModule->par("useErrorRateTable").boolValue())
+        errorModel = new TableErrorRateModel(errorModelName, errorModel);
 
 
     btSize = radioModule->par("btSize").longValue();
@@ -137,8 +141,13 @@ PhyIndication Ieee80211RadioModel::isReceivedCorrectly(AirFrame *airframe, const
         if (iter->snr < snirMin)
             snirMin = iter->snr;
 
-    cPacket *frame = airframe->getEncapsulatedPacket();
-    EV << "packet (" << frame->getClassName() << ")" << frame->getName() << " (" << frame->info() << ") snrMin=" << snirMin << endl;
+    // note: getEncapsulatedPacket() would unshare the encapsulated frame (a deep copy),
+    // so we only touch it for logging; the AirFrame itself has zero length
+    if (!ev.isDisabled())
+    {
+        cPacket *frame = airframe->getEncapsulatedPacket();
+        EV << "packet (" << frame->getClassName() << ")" << frame->getName() << " (" << frame->info() << ") snrMin=" << snirMin << endl;
+    }
 
     if (i%1000==0)
     {
@@ -153,7 +162,7 @@ PhyIndication Ieee80211RadioModel::isReceivedCorrectly(AirFrame *airframe, const
         EV << "COLLISION! Packet got lost. Noise only\n";
         return COLLISION;
     }
-    else if (isPacketOK(snirMin, frame->getBitLength(), airframe->getBitrate()))
+    else if (isPacketOK(snirMin, airframe->getBitLength(), airframe->getBitrate()))
     {
         EV << "packet was received correctly, it is now handed to upper layer...\n";
         return FRAMEOK;
@@ -0,0 +1,120 @@
+//
+// Copyright (C) 2015 OpenSim Ltd.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <math.h>
+#include <algorithm>
+
+#include "TableErrorRateModel.h"
+
+const double TableErrorRateModel::MIN_SNR_DB = -10;
+const double TableErrorRateModel::MAX_SNR_DB = 40;
+const double TableErrorRateModel::SNR_STEP_DB = 0.01;
+const uint32_t TableErrorRateModel::REFERENCE_NBITS = 1024;
+
+// bounds of the tabulated ln L; they stand for L = 0 and L = infinity (a success
+// rate of 1 - ber cannot give a per-bit loss above ~37 in double precision)
+#define MIN_LOG_LOSS -1000.0
+#define MAX_LOG_LOSS 10.0
+
+std::map<std::string, TableErrorRateModel::TableMap> TableErrorRateModel::tables;
+
+bool TableErrorRateModel::ModeKey::operator<(const ModeKey& other) const
+{
+    if (modulationClass != other.modulationClass)
+        return modulationClass < other.modulationClass;
+    if (constellationSize != other.constellationSize)
+        return constellationSize < other.constellationSize;
+    if (codeRate != other.codeRate)
+        return codeRate < other.codeRate;
+    if (dataRate != other.dataRate)
+        return dataRate < other.dataRate;
+    return bandwidth < other.bandwidth;
+}
+
+TableErrorRateModel::TableErrorRateModel(const char *modelName, IErrorModel *model) :
+        model(model)
+{
+    modelTables = &tables[modelName];
+}
+
+TableErrorRateModel::~TableErrorRateModel()
+{
+    delete model;
+}
+
+double TableErrorRateModel::computeLogLoss(const ModulationType& mode, double snr) const
+{
+    // evaluate a longer chunk so that small bit error rates do not vanish in 1 - ber
+    double loss;
+    double successRate = model->GetChunkSuccessRate(mode, snr, REFERENCE_NBITS);
+    if (successRate > 0)
+        loss = -log(successRate) / REFERENCE_NBITS;
+    else
+    {
+        // some of the models return 0 or even negative values at very low SNRs
+        successRate = model->GetChunkSuccessRate(mode, snr, 1);
+        if (successRate <= 0)
+            return MAX_LOG_LOSS;
+        loss = -log(successRate);
+    }
+
+    if (!(loss > 0))
+        return MIN_LOG_LOSS;
+    return std::min(std::max(log(loss), MIN_LOG_LOSS), MAX_LOG_LOSS);
+}
+
+const TableErrorRateModel::Table& TableErrorRateModel::getTable(const ModulationType& mode) const
+{
+    ModeKey key;
+    key.modulationClass = mode.getModulationClass();
+    key.constellationSize = mode.getConstellationSize();
+    key.codeRate = mode.getCodeRate();
+    key.dataRate = mode.getDataRate();
+    key.bandwidth = mode.getBandwidth();
+
+    TableMap::iterator it = modelTables->find(key);
+    if (it != modelTables->end())
+        return it->second;
+
+    Table& table = (*modelTables)[key];
+    int size = (int)floor((MAX_SNR_DB - MIN_SNR_DB) / SNR_STEP_DB + 0.5) + 1;
+    table.resize(size);
+    for (int i = 0; i < size; i++)
+        table[i] = computeLogLoss(mode, pow(10.0, (MIN_SNR_DB + i * SNR_STEP_DB) / 10));
+    return table;
+}
+
+double TableErrorRateModel::GetChunkSuccessRate(ModulationType mode, double snr, uint32_t nbits) const
+{
+    double snrDB = 10 * log10(snr);
+    if (!(snrDB >= MIN_SNR_DB && snrDB < MAX_SNR_DB))
+        return model->GetChunkSuccessRate(mode, snr, nbits);
+
+    const Table& table = getTable(mode);
+    double position = (snrDB - MIN_SNR_DB) / SNR_STEP_DB;
+    int index = std::min((int)position, (int)table.size() - 2);
+    // the DSSS models jump to a loss of 0 or to no success at all; do not
+    // interpolate across such a step
+    if ((table[index] <= MIN_LOG_LOSS) != (table[index + 1] <= MIN_LOG_LOSS) ||
+        (table[index] >= MAX_LOG_LOSS) != (table[index + 1] >= MAX_LOG_LOSS))
+        return model->GetChunkSuccessRate(mode, snr, nbits);
+    double fraction = position - index;
+    double logLoss = table[index] + fraction * (table[index + 1] - table[index]);
+    if (logLoss <= MIN_LOG_LOSS)
+        return 1;
+    return exp(-(double)nbits * exp(logLoss));
+}
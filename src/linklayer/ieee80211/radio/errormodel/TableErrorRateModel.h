@@ -0,0 +1,86 @@
+//
+// Copyright (C) 2015 OpenSim Ltd.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_TABLEERRORRATEMODEL_H
+#define __INET_TABLEERRORRATEMODEL_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "WifiMode.h"
+#include "IErrorModel.h"
+
+/**
+ * Table-driven front-end of an analytic error rate model (NistErrorRateModel,
+ * YansErrorRateModel). The chunk success rates of all these models have the
+ * form S(snr)^nbits, so it is enough to tabulate the per-bit loss
+ * L(snr) = -ln S(snr); the success rate of a chunk is then exp(-nbits * L).
+ *
+ * The tables are computed on first use of a modulation, on a 0.01 dB SNR
+ * grid between -10 dB and 40 dB, and ln L is interpolated linearly between
+ * grid points. SNR values outside the grid, and grid cells where the model
+ * steps to a success rate of 1 or 0, are passed to the analytic model.
+ * For chunks of 16 bits or more (the PLCP header alone has 24) the success
+ * rate is within 1e-5 of the analytic one; shorter chunks may be off by more
+ * just above the SNR where the model's error probability saturates.
+ * Tables depend only on the analytic model and the modulation, so they are
+ * shared by all instances that wrap the same kind of model.
+ */
+class INET_API TableErrorRateModel : public IErrorModel
+{
+  protected:
+    // the properties of a ModulationType the success rate depends on
+    struct ModeKey
+    {
+        int modulationClass;
+        int constellationSize;
+        int codeRate;
+        uint32_t dataRate;
+        uint32_t bandwidth;
+
+        bool operator<(const ModeKey& other) const;
+    };
+    typedef std::vector<double> Table;  // ln L at the grid points
+    typedef std::map<ModeKey, Table> TableMap;  // tables of one kind of analytic model
+
+    static const double MIN_SNR_DB;
+    static const double MAX_SNR_DB;
+    static const double SNR_STEP_DB;
+    static const uint32_t REFERENCE_NBITS;
+
+    static std::map<std::string, TableMap> tables;
+
+    IErrorModel *model;
+    TableMap *modelTables;  // points into 'tables'
+
+  protected:
+    const Table& getTable(const ModulationType& mode) const;
+    double computeLogLoss(const ModulationType& mode, double snr) const;
+
+  public:
+    /**
+     * Takes ownership of the model. The name identifies the kind of model
+     * the tables are shared with.
+     */
+    TableErrorRateModel(const char *modelName, IErrorModel *model);
+    virtual ~TableErrorRateModel();
+
+    virtual double GetChunkSuccessRate(ModulationType mode, double snr, uint32_t nbits) const;
+};
+
+#endif
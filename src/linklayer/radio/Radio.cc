@@ -78,6 +78,7 @@ void Radio::initialize(int stage)
         thermalNoise = FWMath::dBm2mW(par("thermalNoise"));
         sensitivity = FWMath::dBm2mW(par("sensitivity"));
         carrierFrequency = par("carrierFrequency");
+        negligiblePowerLevel = thermalNoise / pow(10.0, par("negligiblePowerMargin").doubleValue() / 10.0);
 
         // initialize noiseLevel
         noiseLevel = thermalNoise;
@@ -103,6 +104,7 @@ void Radio::initialize(int stage)
         // statistics
         numGivenUp = 0;
         numReceivedCorrectly = 0;
+        numPrefiltered = 0;
 
         // Initialize radio state. If thermal noise is already to high, radio
         // state has to be initialized as RECV
@@ -112,6 +114,7 @@ void Radio::initialize(int stage)
 
         WATCH(noiseLevel);
         WATCH(rs);
+        WATCH(numPrefiltered);
 
         obstacles = ObstacleControlAccess().getIfExists();
         if (obstacles) EV << "Found ObstacleControl" << endl;
@@ -369,7 +372,10 @@ AirFrame *Radio::encapsulatePacket(cPacket *frame)
 
 void Radio::sendUp(AirFrame *airframe)
 {
+    // this is where the receiver gets its private copy of the (so far shared) frame
     cPacket *frame = airframe->decapsulate();
+    if (airframe->getKind() != FRAMEOK)
+        frame->setKind(airframe->getKind());  // PhyIndication set in handleLowerMsgEnd()
     Radio80211aControlInfo * cinfo = new Radio80211aControlInfo;
     if (radioModel->haveTestFrame())
     {
@@ -602,10 +608,8 @@ void Radio::handleSelfMsg(cMessage *msg)
  * currently being received message (if any) has to be updated as
  * well as the RadioState.
  */
-void Radio::handleLowerMsgStart(AirFrame* airframe)
+double Radio::calculateReceivedPower(AirFrame *airframe)
 {
-    // Calculate the receive power of the message
-
     // calculate distance
     const Coord& framePos = airframe->getSenderPos();
     double distance = getRadioPosition().distance(framePos);
@@ -621,6 +625,31 @@ void Radio::handleLowerMsgStart(AirFrame* airframe)
     double rcvdPower = receptionModel->calculateReceivedPower(airframe->getPSend(), frequency, distance);
     if (obstacles && distance > MIN_DISTANCE)
         rcvdPower = obstacles->calculateReceivedPower(rcvdPower, carrierFrequency, framePos, 0, getRadioPosition(), 0);
+    return rcvdPower;
+}
+
+bool Radio::prefilterAirFrame(AirFrame *airframe)
+{
+    Enter_Method_Silent();
+
+    // the power is calculated only once (the reception model may be random),
+    // and handleLowerMsgStart() will use it
+    double rcvdPower = calculateReceivedPower(airframe);
+    airframe->setPowRec(rcvdPower);
+    airframe->setPowRecValid(true);
+
+    if (rcvdPower < sensitivity && rcvdPower < negligiblePowerLevel)
+    {
+        numPrefiltered++;
+        return false;
+    }
+    return true;
+}
+
+void Radio::handleLowerMsgStart(AirFrame* airframe)
+{
+    // Calculate the receive power of the message, unless prefilterAirFrame() already did
+    double rcvdPower = airframe->getPowRecValid() ? airframe->getPowRec() : calculateReceivedPower(airframe);
     airframe->setPowRec(rcvdPower);
     // store the receive power in the recvBuff
     recvBuff[airframe] = rcvdPower;
@@ -717,9 +746,11 @@ void Radio::handleLowerMsgEnd(AirFrame * airframe)
         //else
         //    delete airframe;
         PhyIndication frameState = radioModel->isReceivedCorrectly(airframe, list);
+        // the encapsulated frame is shared with the other receivers' copies of the
+        // AirFrame until decapsulation, so the state is transferred to it in sendUp()
+        airframe->setKind(frameState);
         if (frameState != FRAMEOK)
         {
-            airframe->getEncapsulatedPacket()->setKind(frameState);
             airframe->setName(frameState == COLLISION ? "COLLISION" : "BITERROR");
 
             numGivenUp++;
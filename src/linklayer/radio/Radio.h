@@ -66,6 +66,14 @@ class INET_API Radio : public ChannelAccess, public ILifecycle
 
     virtual bool handleOperationStage(LifecycleOperation *operation, int stage, IDoneCallback *doneCallback);
 
+    /**
+     * Calculates the received power of the frame and stores it in the frame.
+     * Returns false if the power is below both the sensitivity and the
+     * negligible power level, i.e. the frame would not change the noise level
+     * noticeably.
+     */
+    virtual bool prefilterAirFrame(AirFrame *airframe);
+
   protected:
     virtual void initialize(int stage);
     virtual void finish();
@@ -84,6 +92,9 @@ class INET_API Radio : public ChannelAccess, public ILifecycle
     /** @brief Unbuffer the frame and update noise levels and snr information */
     virtual void handleLowerMsgEnd(AirFrame *airframe);
 
+    /** @brief Calculates the power of the frame at this radio's position, using the reception model and obstacles */
+    virtual double calculateReceivedPower(AirFrame *airframe);
+
     /** @brief Buffers message for 'transmission time' */
     virtual void bufferMsg(AirFrame *airframe);
 
@@ -248,6 +259,12 @@ class INET_API Radio : public ChannelAccess, public ILifecycle
      */
     double receptionThreshold;
 
+    /*
+     * frames received with less power (and below sensitivity) are discarded by prefilterAirFrame()
+     */
+    double negligiblePowerLevel;
+    long numPrefiltered;
+
     /*
      * this variable is used to disconnect the possibility of sent packets to the ChannelControl
      */
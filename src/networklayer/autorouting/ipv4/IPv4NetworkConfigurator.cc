@@ -18,7 +18,16 @@
 // Authors: Levente Meszaros (primary author), Andras Varga, Tamas Borbely
 //
 
+#include <stdio.h>
+#include <string.h>
 #include <set>
+#include <sstream>
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
 #include "stlutils.h"
 #include "IRoutingTable.h"
 #include "IInterfaceTable.h"
@@ -119,6 +128,7 @@ void IPv4NetworkConfigurator::initialize(int stage)
         addSubnetRoutesParameter = par("addSubnetRoutes");
         addDefaultRoutesParameter = par("addDefaultRoutes");
         optimizeRoutesParameter = par("optimizeRoutes");
+        useLinkWeightsParameter = par("useLinkWeights");
         configuration = par("config");
     }
     else if (stage == 2) {
@@ -146,6 +156,25 @@ void IPv4NetworkConfigurator::computeConfiguration()
     long initializeStartTime = clock();
 
     fullTopology.clear();
+
+    // reuse the configuration computed by an earlier run if the network has not changed
+    const char *configCacheFile = par("configCache");
+    uint64 configHash = 0;
+    if (isNotEmpty(configCacheFile))
+    {
+        T(configHash = computeConfigurationHash());
+        bool loaded;
+        T(loaded = loadConfigurationCache(fullTopology, configCacheFile, configHash));
+        if (loaded)
+        {
+            EV_INFO << "Configuration loaded from " << configCacheFile << endl;
+            if (assignAddressesParameter)
+                setInterfaceAddresses(fullTopology);
+            printElapsedTime("initialize", initializeStartTime);
+            return;
+        }
+    }
+
     // extract fullTopology into the IPv4Topology object, then fill in a LinkInfo[] vector
     T(extractTopology(fullTopology));
     // read the configuration from XML; it will serve as input for address assignment
@@ -156,20 +185,8 @@ void IPv4NetworkConfigurator::computeConfiguration()
 
     // NOTE: We need to configure the IP addresses already here.
     // They are needed for the pruned topologies!
-    if (assignAddressesParameter) {
-        for (int i = 0; i < fullTopology.getNumNodes(); i++) {
-            Node *node = (Node *)fullTopology.getNode(i);
-            for (int i = 0; i < (int)node->interfaceInfos.size(); i++) {
-               InterfaceInfo *interfaceInfo = node->interfaceInfos.at(i);
-               InterfaceEntry *interfaceEntry = interfaceInfo->interfaceEntry;
-               IPv4InterfaceData *interfaceData = interfaceEntry->ipv4Data();
-                if (interfaceInfo->configure) {
-                    interfaceData->setIPAddress(IPv4Address(interfaceInfo->address));                     
-                    interfaceData->setNetmask(IPv4Address(interfaceInfo->netmask));
-                }
-            }
-        }
-    }
+    if (assignAddressesParameter)
+        setInterfaceAddresses(fullTopology);
 
     bool hasConfiguration = false;
     for(std::set<unsigned int>::iterator iterator = fullTopology.networkSet.begin();
@@ -199,9 +216,35 @@ void IPv4NetworkConfigurator::computeConfiguration()
 
 //     dumpRoutes(fullTopology);
 
+    if (isNotEmpty(configCacheFile))
+    {
+        if (hasConfiguration)
+            EV_WARN << "Configuration cache is not supported with separate networks, not saving " << configCacheFile << endl;
+        else
+        {
+            T(saveConfigurationCache(fullTopology, configCacheFile, configHash));
+            EV_INFO << "Configuration saved to " << configCacheFile << endl;
+        }
+    }
+
     printElapsedTime("initialize", initializeStartTime);
 }
 
+void IPv4NetworkConfigurator::setInterfaceAddresses(IPv4Topology& topology)
+{
+    for (int i = 0; i < topology.getNumNodes(); i++) {
+        Node *node = (Node *)topology.getNode(i);
+        for (int j = 0; j < (int)node->interfaceInfos.size(); j++) {
+            InterfaceInfo *interfaceInfo = node->interfaceInfos.at(j);
+            if (interfaceInfo->configure) {
+                IPv4InterfaceData *interfaceData = interfaceInfo->interfaceEntry->ipv4Data();
+                interfaceData->setIPAddress(IPv4Address(interfaceInfo->address));
+                interfaceData->setNetmask(IPv4Address(interfaceInfo->netmask));
+            }
+        }
+    }
+}
+
 void IPv4NetworkConfigurator::ensureConfigurationComputed(IPv4Topology& fullTopology)
 {
     if (fullTopology.getNumNodes() == 0)
@@ -1501,6 +1544,420 @@ void IPv4NetworkConfigurator::dumpConfig(IPv4Topology& topology)
     fclose(f);
 }
 
+namespace {
+
+// incremental 64-bit FNV-1a hash, used for keying the configuration cache
+class ConfigurationHash
+{
+  protected:
+    uint64 value;
+
+  public:
+    ConfigurationHash() : value(14695981039346656037ULL) {}
+    void add(const char *s) { for (; s && *s; s++) addByte(*s); addByte(0); }
+    void add(const std::string& s) { add(s.c_str()); }
+    void add(long l) { char buf[32]; sprintf(buf, "%ld", l); add(buf); }
+    void addByte(char c) { value ^= (unsigned char)c; value *= 1099511628211ULL; }
+    uint64 getValue() const { return value; }
+};
+
+void hashXML(ConfigurationHash& hash, cXMLElement *element)
+{
+    hash.add(element->getTagName());
+    const cXMLAttributeMap& attributes = element->getAttributes();
+    for (cXMLAttributeMap::const_iterator it = attributes.begin(); it != attributes.end(); ++it) {
+        hash.add(it->first);
+        hash.add(it->second);
+    }
+    hash.add(element->getNodeValue());
+    for (cXMLElement *child = element->getFirstChild(); child; child = child->getNextSibling())
+        hashXML(hash, child);
+    hash.add("/");
+}
+
+void hashParameters(ConfigurationHash& hash, cComponent *component)
+{
+    for (int i = 0; i < component->getNumParams(); i++) {
+        cPar& par = component->par(i);
+        hash.add(par.getName());
+        if (par.getType() == cPar::XML && par.xmlValue())
+            hashXML(hash, par.xmlValue());
+        else
+            hash.add(par.str());
+    }
+}
+
+// hashes the module hierarchy and connections; module parameters only if requested
+void hashModule(ConfigurationHash& hash, cModule *module, bool withParameters)
+{
+    hash.add(module->getFullName());
+    hash.add(module->getNedTypeName());
+    if (withParameters)
+        hashParameters(hash, module);
+    for (cModule::GateIterator it(module); !it.end(); it++) {
+        cGate *gate = it();
+        cGate *nextGate = gate->getNextGate();
+        if (!nextGate)
+            continue;
+        hash.add(gate->getFullName());
+        hash.add(nextGate->getOwnerModule()->getFullPath());
+        hash.add(nextGate->getFullName());
+        cChannel *channel = gate->getChannel();
+        if (channel) {
+            hash.add(channel->getNedTypeName());
+            hashParameters(hash, channel);
+        }
+    }
+    for (cModule::SubmoduleIterator it(module); !it.end(); it++)
+        hashModule(hash, it(), withParameters);
+    hash.add("/");
+}
+
+// helpers for reading and writing the configuration cache
+void writeUint32(FILE *f, uint32 value) { fwrite(&value, sizeof(value), 1, f); }
+void writeInt32(FILE *f, int32 value) { fwrite(&value, sizeof(value), 1, f); }
+void writeDouble(FILE *f, double value) { fwrite(&value, sizeof(value), 1, f); }
+void writeString(FILE *f, const char *s) { uint32 length = strlen(s); writeUint32(f, length); fwrite(s, 1, length, f); }
+
+// reads the configuration cache; a short read or an implausible count marks it as failed,
+// after which all reads return zeros
+class ConfigurationCacheReader
+{
+  protected:
+    FILE *f;
+    long size;
+    bool ok;
+
+  public:
+    ConfigurationCacheReader(FILE *f) : f(f), size(0), ok(true) {
+        if (fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) < 0 || fseek(f, 0, SEEK_SET) != 0)
+            ok = false;
+    }
+    bool isOk() const { return ok && !ferror(f); }
+    bool isAtEnd() { return ok && fgetc(f) == EOF && feof(f); }
+    void fail() { ok = false; }
+    void read(void *buffer, size_t length) { if (ok && length > 0 && fread(buffer, 1, length, f) != length) ok = false; }
+    uint32 readUint32() { uint32 value = 0; read(&value, sizeof(value)); return ok ? value : 0; }
+    int32 readInt32() { int32 value = 0; read(&value, sizeof(value)); return ok ? value : 0; }
+    double readDouble() { double value = 0; read(&value, sizeof(value)); return ok ? value : 0; }
+
+    // reads the number of the following items, which is at most maxCount; every item
+    // takes at least 4 bytes, so counts the rest of the file cannot hold are rejected too
+    uint32 readCount(uint32 maxCount = ~(uint32)0) {
+        uint32 count = readUint32();
+        long position = ok ? ftell(f) : -1;
+        if (position < 0 || count > maxCount || (uint64)count * sizeof(uint32) > (uint64)(size - position))
+            ok = false;
+        return ok ? count : 0;
+    }
+
+    std::string readString() {
+        uint32 length = readUint32();
+        long position = ok ? ftell(f) : -1;
+        if (position < 0 || length > (uint64)(size - position))
+            ok = false;
+        std::string s(ok ? length : 0, '\0');
+        if (!s.empty())
+            read(&s[0], length);
+        return ok ? s : std::string();
+    }
+};
+
+const char CONFIGURATION_CACHE_MAGIC[] = "INET IPv4NetworkConfigurator cache";
+const uint32 CONFIGURATION_CACHE_VERSION = 1;
+
+}
+
+uint64 IPv4NetworkConfigurator::computeConfigurationHash()
+{
+    ConfigurationHash hash;
+
+    // parameters of this module, including the XML configuration
+    hashParameters(hash, this);
+
+    // module hierarchy and connections, with channel parameters (datarate, netID)
+    hashModule(hash, simulation.getSystemModule(), false);
+
+    // interfaces and routing settings of the network nodes as they are at this point of the
+    // initialization. Of the other module parameters only those of network interface modules
+    // are considered (e.g. the SSID of wireless NICs), so that the cache remains valid across
+    // runs that differ only in e.g. application parameters
+    for (cModule::SubmoduleIterator it(simulation.getSystemModule()); !it.end(); it++) {
+        std::vector<cModule *> modules;
+        modules.push_back(it());
+        while (!modules.empty()) {
+            cModule *module = modules.back();
+            modules.pop_back();
+            IInterfaceTable *interfaceTable = module->getProperties()->get("node") ? IPvXAddressResolver().findInterfaceTableOf(module) : NULL;
+            if (interfaceTable) {
+                hash.add(module->getFullPath());
+                IRoutingTable *routingTable = IPvXAddressResolver().findRoutingTableOf(module);
+                if (routingTable) {
+                    hash.add((long)routingTable->isIPForwardingEnabled());
+                    hash.add((long)routingTable->isMulticastForwardingEnabled());
+                }
+                for (int i = 0; i < interfaceTable->getNumInterfaces(); i++) {
+                    InterfaceEntry *interfaceEntry = interfaceTable->getInterface(i);
+                    hash.add(interfaceEntry->getFullName());
+                    hash.add((long)interfaceEntry->getNodeInputGateId());
+                    hash.add((long)interfaceEntry->getNodeOutputGateId());
+                    hash.add((long)interfaceEntry->getMTU());
+                    hash.add((long)interfaceEntry->isLoopback());
+                    IPv4InterfaceData *interfaceData = interfaceEntry->ipv4Data();
+                    if (interfaceData) {
+                        hash.add((long)interfaceData->getIPAddress().getInt());
+                        hash.add((long)interfaceData->getNetmask().getInt());
+                        hash.add((long)interfaceData->getMetric());
+                    }
+                    if (interfaceEntry->getInterfaceModule())
+                        hashModule(hash, interfaceEntry->getInterfaceModule(), true);
+                }
+            }
+            for (cModule::SubmoduleIterator jt(module); !jt.end(); jt++)
+                modules.push_back(jt());
+        }
+    }
+
+    return hash.getValue();
+}
+
+bool IPv4NetworkConfigurator::loadConfigurationCache(IPv4Topology& topology, const char *fileName, uint64 hash)
+{
+    FILE *f = fopen(fileName, "rb");
+    if (!f)
+        return false;
+    ConfigurationCacheReader reader(f);
+
+    bool upToDate = reader.readString() == CONFIGURATION_CACHE_MAGIC && reader.readUint32() == CONFIGURATION_CACHE_VERSION;
+    uint32 hashHigh = reader.readUint32();
+    uint32 hashLow = reader.readUint32();
+    if (!upToDate || !reader.isOk() || hashHigh != (uint32)(hash >> 32) || hashLow != (uint32)hash) {
+        EV_INFO << "Configuration cache " << fileName << " is outdated" << endl;
+        fclose(f);
+        return false;
+    }
+
+    // nodes, each module at most once
+    uint32 numNodes = reader.readCount(simulation.getLastModuleId() + 1);
+    std::vector<Node *> nodes;
+    std::set<cModule *> modules;
+    uint32 numNodeInterfaces = 0;
+    for (uint32 i = 0; reader.isOk() && i < numNodes; i++) {
+        std::string path = reader.readString();
+        cModule *module = reader.isOk() ? simulation.getModuleByPath(path.c_str()) : NULL;
+        if (!module || !modules.insert(module).second) {
+            reader.fail();
+            break;
+        }
+        Node *node = new Node(module);
+        node->interfaceTable = IPvXAddressResolver().findInterfaceTableOf(module);
+        node->routingTable = IPvXAddressResolver().findRoutingTableOf(module);
+        if (node->interfaceTable)
+            numNodeInterfaces += node->interfaceTable->getNumInterfaces();
+        topology.addNode(node);
+        nodes.push_back(node);
+    }
+
+    // links and interfaces, each interface of the nodes on at most one link
+    uint32 numLinks = reader.readCount(numNodeInterfaces);
+    for (uint32 i = 0; reader.isOk() && i < numLinks; i++) {
+        LinkInfo *linkInfo = new LinkInfo();
+        topology.linkInfos.push_back(linkInfo);
+        uint32 numInterfaces = reader.readCount(numNodeInterfaces - topology.interfaceInfos.size());
+        for (uint32 j = 0; reader.isOk() && j < numInterfaces; j++) {
+            uint32 nodeIndex = reader.readUint32();
+            std::string name = reader.readString();
+            Node *node = reader.isOk() && nodeIndex < nodes.size() ? nodes[nodeIndex] : NULL;
+            InterfaceEntry *interfaceEntry = node && node->interfaceTable ? node->interfaceTable->getInterfaceByName(name.c_str()) : NULL;
+            if (!interfaceEntry || topology.interfaceInfos.count(interfaceEntry)) {
+                reader.fail();
+                break;
+            }
+            InterfaceInfo *interfaceInfo = new InterfaceInfo(node, linkInfo, interfaceEntry);
+            interfaceInfo->configure = reader.readUint32() != 0;
+            interfaceInfo->mtu = reader.readInt32();
+            interfaceInfo->metric = reader.readDouble();
+            interfaceInfo->address = reader.readUint32();
+            interfaceInfo->addressSpecifiedBits = reader.readUint32();
+            interfaceInfo->netmask = reader.readUint32();
+            interfaceInfo->netmaskSpecifiedBits = reader.readUint32();
+            uint32 numMulticastGroups = reader.readCount();
+            for (uint32 k = 0; k < numMulticastGroups; k++)
+                interfaceInfo->multicastGroups.push_back(IPv4Address(reader.readUint32()));
+            linkInfo->interfaceInfos.push_back(interfaceInfo);
+            node->interfaceInfos.push_back(interfaceInfo);
+            topology.interfaceInfos[interfaceEntry] = interfaceInfo;
+        }
+    }
+
+    // routes
+    for (uint32 i = 0; reader.isOk() && i < numNodes; i++) {
+        Node *node = nodes[i];
+        uint32 numRoutes = reader.readCount();
+        for (uint32 j = 0; reader.isOk() && j < numRoutes; j++) {
+            IPv4Route *route = new IPv4Route();
+            node->staticRoutes.push_back(route);
+            route->setDestination(IPv4Address(reader.readUint32()));
+            route->setNetmask(IPv4Address(reader.readUint32()));
+            route->setGateway(IPv4Address(reader.readUint32()));
+            std::string interfaceName = reader.readString();
+            route->setSourceType((IPv4Route::SourceType)reader.readInt32());
+            route->setMetric(reader.readInt32());
+            if (!interfaceName.empty()) {
+                InterfaceEntry *interfaceEntry = node->interfaceTable ? node->interfaceTable->getInterfaceByName(interfaceName.c_str()) : NULL;
+                if (!interfaceEntry)
+                    reader.fail();
+                route->setInterface(interfaceEntry);
+            }
+        }
+        uint32 numMulticastRoutes = reader.readCount();
+        for (uint32 j = 0; reader.isOk() && j < numMulticastRoutes; j++) {
+            IPv4MulticastRoute *route = new IPv4MulticastRoute();
+            node->staticMulticastRoutes.push_back(route);
+            route->setOrigin(IPv4Address(reader.readUint32()));
+            route->setOriginNetmask(IPv4Address(reader.readUint32()));
+            route->setMulticastGroup(IPv4Address(reader.readUint32()));
+            route->setSourceType((IPv4MulticastRoute::SourceType)reader.readInt32());
+            route->setMetric(reader.readInt32());
+            std::string inInterfaceName = reader.readString();
+            if (!inInterfaceName.empty()) {
+                InterfaceEntry *interfaceEntry = node->interfaceTable ? node->interfaceTable->getInterfaceByName(inInterfaceName.c_str()) : NULL;
+                if (!interfaceEntry) {
+                    reader.fail();
+                    break;
+                }
+                route->setInInterface(new IPv4MulticastRoute::InInterface(interfaceEntry));
+            }
+            uint32 numOutInterfaces = reader.readCount(node->interfaceTable ? node->interfaceTable->getNumInterfaces() : 0);
+            for (uint32 k = 0; reader.isOk() && k < numOutInterfaces; k++) {
+                std::string outInterfaceName = reader.readString();
+                bool isLeaf = reader.readUint32() != 0;
+                InterfaceEntry *interfaceEntry = reader.isOk() ? node->interfaceTable->getInterfaceByName(outInterfaceName.c_str()) : NULL;
+                if (!interfaceEntry)
+                    reader.fail();
+                else
+                    route->addOutInterface(new IPv4MulticastRoute::OutInterface(interfaceEntry, isLeaf));
+            }
+        }
+    }
+
+    // the end marker must be followed by the end of the file
+    bool ok = reader.isOk() && reader.readString() == CONFIGURATION_CACHE_MAGIC && reader.isAtEnd();
+    fclose(f);
+
+    if (!ok) {
+        EV_WARN << "Configuration cache " << fileName << " is truncated or does not match the network, ignoring it" << endl;
+        for (int i = 0; i < topology.getNumNodes(); i++) {
+            Node *node = (Node *)topology.getNode(i);
+            for (int j = 0; j < (int)node->staticRoutes.size(); j++)
+                delete node->staticRoutes[j];
+            for (int j = 0; j < (int)node->staticMulticastRoutes.size(); j++)
+                delete node->staticMulticastRoutes[j];
+        }
+        for (int i = 0; i < (int)topology.linkInfos.size(); i++)
+            delete topology.linkInfos[i];
+        topology.linkInfos.clear();
+        topology.interfaceInfos.clear();
+        topology.clear();
+    }
+    return ok;
+}
+
+void IPv4NetworkConfigurator::saveConfigurationCache(IPv4Topology& topology, const char *fileName, uint64 hash)
+{
+    // unique per process, in the same directory so that it can be renamed over the target
+    std::ostringstream tempFileName;
+    tempFileName << fileName << ".tmp" << getpid();
+    FILE *f = fopen(tempFileName.str().c_str(), "wb");
+    if (!f)
+        throw cRuntimeError("Cannot write configuration cache file '%s'", tempFileName.str().c_str());
+
+    writeString(f, CONFIGURATION_CACHE_MAGIC);
+    writeUint32(f, CONFIGURATION_CACHE_VERSION);
+    writeUint32(f, (uint32)(hash >> 32));
+    writeUint32(f, (uint32)hash);
+
+    // nodes
+    std::map<Node *, uint32> nodeIndices;
+    writeUint32(f, topology.getNumNodes());
+    for (int i = 0; i < topology.getNumNodes(); i++) {
+        Node *node = (Node *)topology.getNode(i);
+        nodeIndices[node] = i;
+        writeString(f, node->module->getFullPath().c_str());
+    }
+
+    // links and interfaces
+    writeUint32(f, topology.linkInfos.size());
+    for (int i = 0; i < (int)topology.linkInfos.size(); i++) {
+        LinkInfo *linkInfo = topology.linkInfos[i];
+        writeUint32(f, linkInfo->interfaceInfos.size());
+        for (int j = 0; j < (int)linkInfo->interfaceInfos.size(); j++) {
+            InterfaceInfo *interfaceInfo = linkInfo->interfaceInfos[j];
+            writeUint32(f, nodeIndices[interfaceInfo->node]);
+            writeString(f, interfaceInfo->interfaceEntry->getName());
+            writeUint32(f, interfaceInfo->configure);
+            writeInt32(f, interfaceInfo->mtu);
+            writeDouble(f, interfaceInfo->metric);
+            writeUint32(f, interfaceInfo->address);
+            writeUint32(f, interfaceInfo->addressSpecifiedBits);
+            writeUint32(f, interfaceInfo->netmask);
+            writeUint32(f, interfaceInfo->netmaskSpecifiedBits);
+            writeUint32(f, interfaceInfo->multicastGroups.size());
+            for (int k = 0; k < (int)interfaceInfo->multicastGroups.size(); k++)
+                writeUint32(f, interfaceInfo->multicastGroups[k].getInt());
+        }
+    }
+
+    // routes
+    for (int i = 0; i < topology.getNumNodes(); i++) {
+        Node *node = (Node *)topology.getNode(i);
+        writeUint32(f, node->staticRoutes.size());
+        for (int j = 0; j < (int)node->staticRoutes.size(); j++) {
+            IPv4Route *route = node->staticRoutes[j];
+            writeUint32(f, route->getDestination().getInt());
+            writeUint32(f, route->getNetmask().getInt());
+            writeUint32(f, route->getGateway().getInt());
+            writeString(f, route->getInterfaceName());
+            writeInt32(f, route->getSourceType());
+            writeInt32(f, route->getMetric());
+        }
+        writeUint32(f, node->staticMulticastRoutes.size());
+        for (int j = 0; j < (int)node->staticMulticastRoutes.size(); j++) {
+            IPv4MulticastRoute *route = node->staticMulticastRoutes[j];
+            writeUint32(f, route->getOrigin().getInt());
+            writeUint32(f, route->getOriginNetmask().getInt());
+            writeUint32(f, route->getMulticastGroup().getInt());
+            writeInt32(f, route->getSourceType());
+            writeInt32(f, route->getMetric());
+            writeString(f, route->getInInterface() ? route->getInInterface()->getInterface()->getName() : "");
+            writeUint32(f, route->getNumOutInterfaces());
+            for (unsigned int k = 0; k < route->getNumOutInterfaces(); k++) {
+                writeString(f, route->getOutInterface(k)->getInterface()->getName());
+                writeUint32(f, route->getOutInterface(k)->isLeaf());
+            }
+        }
+    }
+
+    // end marker, detects truncated files
+    writeString(f, CONFIGURATION_CACHE_MAGIC);
+
+    bool failed = ferror(f) != 0;
+    if (fclose(f) != 0 || failed) {
+        remove(tempFileName.str().c_str());
+        throw cRuntimeError("Error writing configuration cache file '%s'", tempFileName.str().c_str());
+    }
+
+    // rename() does not replace an existing file on Windows; there the old file
+    // is removed first, and a concurrent run may find no cache for a moment
+    if (rename(tempFileName.str().c_str(), fileName) != 0) {
+        remove(fileName);
+        if (rename(tempFileName.str().c_str(), fileName) != 0) {
+            remove(tempFileName.str().c_str());
+            throw cRuntimeError("Cannot rename '%s' to configuration cache file '%s'", tempFileName.str().c_str(), fileName);
+        }
+    }
+}
+
 void IPv4NetworkConfigurator::readMulticastGroupConfiguration(IPv4Topology& topology)
 {
     cXMLElementList multicastGroupElements = configuration->getChildrenByTagName("multicast-group");
@@ -1871,6 +2328,24 @@ IPv4NetworkConfigurator::LinkInfo *IPv4NetworkConfigurator::findLinkOfInterface(
     return NULL;
 }
 
+bool IPv4NetworkConfigurator::RouteLessThan::operator()(const IPv4Route *route1, const IPv4Route *route2) const
+{
+    // orders by the same fields that IPv4Route::equals() compares
+    if (route1->getDestination() != route2->getDestination())
+        return route1->getDestination() < route2->getDestination();
+    if (route1->getNetmask() != route2->getNetmask())
+        return route1->getNetmask() < route2->getNetmask();
+    if (route1->getGateway() != route2->getGateway())
+        return route1->getGateway() < route2->getGateway();
+    if (route1->getInterface() != route2->getInterface())
+        return route1->getInterface() < route2->getInterface();
+    if (route1->getSourceType() != route2->getSourceType())
+        return route1->getSourceType() < route2->getSourceType();
+    if (route1->getMetric() != route2->getMetric())
+        return route1->getMetric() < route2->getMetric();
+    return route1->getRoutingTable() < route2->getRoutingTable();
+}
+
 bool IPv4NetworkConfigurator::containsRoute(const std::vector<IPv4Route *>& routes, IPv4Route *route)
 {
     for (int i = 0; i < (int)routes.size(); i++)
@@ -1890,7 +2365,10 @@ void IPv4NetworkConfigurator::addStaticRoutes(IPv4Topology& topology, unsigned i
 
         // calculate shortest paths from everywhere to sourceNode
         // we are going to use the paths in reverse direction (assuming all links are bidirectional)
-        topology.calculateUnweightedSingleShortestPathsTo(sourceNode);
+        if (useLinkWeightsParameter)
+            topology.calculateWeightedSingleShortestPathsTo(sourceNode);
+        else
+            topology.calculateUnweightedSingleShortestPathsTo(sourceNode);
 
         // check if adding the default routes would be ok (this is an optimization)
         if (addDefaultRoutesParameter && sourceNode->interfaceInfos.size() == 1 && sourceNode->interfaceInfos[0]->linkInfo->gatewayInterfaceInfo)
@@ -1926,6 +2404,9 @@ void IPv4NetworkConfigurator::addStaticRoutes(IPv4Topology& topology, unsigned i
         }
         else
         {
+            // routes already present, for detecting duplicates
+            std::set<IPv4Route *, RouteLessThan> existingRoutes(sourceNode->staticRoutes.begin(), sourceNode->staticRoutes.end());
+
             // add a route to all destinations in the network
             for (int j = 0; j < topology.getNumNodes(); j++)
             {
@@ -1940,23 +2421,16 @@ void IPv4NetworkConfigurator::addStaticRoutes(IPv4Topology& topology, unsigned i
 
                 // determine next hop interface
                 // find next hop interface (the last IP interface on the path that is not in the source node)
-                Node *node = destinationNode;
-                Link *link = NULL;
-                InterfaceInfo *nextHopInterfaceInfo = NULL;
-                while (node != sourceNode)
-                {
-                    link = (Link *)node->getPath(0);
-                    if (node->interfaceTable && node != sourceNode && link->sourceInterfaceInfo)
-                        nextHopInterfaceInfo = link->sourceInterfaceInfo;
-                    node = (Node *)node->getPath(0)->getRemoteNode();
-                }
+                findNextHop(destinationNode, sourceNode);
+                Link *link = destinationNode->nextHopLink;
+                InterfaceInfo *nextHopInterfaceInfo = destinationNode->nextHopInterfaceInfo;
                 const InterfaceInfo* ingressInterfaceInfo = ((Link*)destinationNode->getPath(0))->sourceInterfaceInfo;
 
                 // determine source interface
                 if (link->destinationInterfaceInfo && link->destinationInterfaceInfo->addStaticRoute)
                 {
                     InterfaceEntry* sourceInterfaceEntry    = link->destinationInterfaceInfo->interfaceEntry;
-                    IRoutingTable*  destinationRoutingTable = IPvXAddressResolver().routingTableOf(destinationNode->getModule());
+                    IRoutingTable*  destinationRoutingTable = destinationNode->routingTable ? destinationNode->routingTable : IPvXAddressResolver().routingTableOf(destinationNode->getModule());
 
                     // add the same routes for all destination interfaces (IP packets are accepted from any interface at the destination)
                     for (int j = 0; j < (int)destinationNode->interfaceInfos.size(); j++)
@@ -1993,7 +2467,7 @@ void IPv4NetworkConfigurator::addStaticRoutes(IPv4Topology& topology, unsigned i
                                 route->setGateway(gatewayAddress);
                             route->setSourceType(IPv4Route::MANUAL);
                             route->setMetric(10 + networkID);
-                            if (containsRoute(sourceNode->staticRoutes, route))
+                            if (!existingRoutes.insert(route).second)
                                 delete route;
                             else {
                                 sourceNode->staticRoutes.push_back(route);
@@ -2011,6 +2485,37 @@ void IPv4NetworkConfigurator::addStaticRoutes(IPv4Topology& topology, unsigned i
     }
 }
 
+void IPv4NetworkConfigurator::findNextHop(Node *node, Node *targetNode)
+{
+    // walk towards targetNode until a node with a memoized result is found
+    std::vector<Node *> path;
+    while (node != targetNode && node->nextHopTarget != targetNode)
+    {
+        path.push_back(node);
+        node = (Node *)node->getPath(0)->getRemoteNode();
+    }
+
+    // fill in the results backwards; the next hop interface closest to targetNode wins
+    for (int i = (int)path.size() - 1; i >= 0; i--)
+    {
+        node = path[i];
+        Link *link = (Link *)node->getPath(0);
+        Node *remoteNode = (Node *)link->getRemoteNode();
+        InterfaceInfo *interfaceInfo = node->interfaceTable ? link->sourceInterfaceInfo : NULL;
+        if (remoteNode == targetNode)
+        {
+            node->nextHopLink = link;
+            node->nextHopInterfaceInfo = interfaceInfo;
+        }
+        else
+        {
+            node->nextHopLink = remoteNode->nextHopLink;
+            node->nextHopInterfaceInfo = remoteNode->nextHopInterfaceInfo ? remoteNode->nextHopInterfaceInfo : interfaceInfo;
+        }
+        node->nextHopTarget = targetNode;
+    }
+}
+
 /**
  * Returns true if the two routes are the same except their address prefix and netmask.
  * If it returns true we say that the routes have the same color.
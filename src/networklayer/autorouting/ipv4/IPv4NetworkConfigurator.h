@@ -58,8 +58,13 @@ class INET_API IPv4NetworkConfigurator : public cSimpleModule, public IPvXAddres
                 std::vector<IPv4Route *> staticRoutes;
                 std::vector<IPv4MulticastRoute *> staticMulticastRoutes;
 
+                // memoized results of findNextHop() for the current target of the shortest path calculation
+                Node *nextHopTarget;
+                Link *nextHopLink;
+                InterfaceInfo *nextHopInterfaceInfo;
+
             public:
-                Node(cModule *module) : Topology::Node(module->getId()) { this->module = module; interfaceTable = NULL; routingTable = NULL; }
+                Node(cModule *module) : Topology::Node(module->getId()) { this->module = module; interfaceTable = NULL; routingTable = NULL; nextHopTarget = NULL; nextHopLink = NULL; nextHopInterfaceInfo = NULL; }
         };
 
         /**
@@ -202,6 +207,7 @@ class INET_API IPv4NetworkConfigurator : public cSimpleModule, public IPvXAddres
         bool addSubnetRoutesParameter;
         bool addDefaultRoutesParameter;
         bool optimizeRoutesParameter;
+        bool useLinkWeightsParameter;
         cXMLElement *configuration;
 
         // internal state
@@ -274,11 +280,21 @@ class INET_API IPv4NetworkConfigurator : public cSimpleModule, public IPvXAddres
 
         /**
          * Adds static routes to all routing tables in the network.
-         * The algorithm uses Dijkstra's weighted shortest path algorithm.
+         * The algorithm uses Dijkstra's shortest path algorithm, weighted by
+         * the link weights if the useLinkWeights parameter is set.
          * May add default routes and subnet routes if possible and requested.
          */
         virtual void addStaticRoutes(IPv4Topology& topology, unsigned int networkID);
 
+        /**
+         * Determines the last link and the last IP interface not in targetNode
+         * on the shortest path from node to targetNode, where targetNode is the
+         * target of the most recent shortest path calculation. Results are
+         * memoized in the nodes along the path, so that finding the next hops
+         * of all nodes takes linear time.
+         */
+        void findNextHop(Node *node, Node *targetNode);
+
         /**
          * Destructively optimizes the given IPv4 routes by merging some of them.
          * The resulting routes might be different in that they will route packets
@@ -302,7 +318,32 @@ class INET_API IPv4NetworkConfigurator : public cSimpleModule, public IPvXAddres
         virtual void dumpRoutes(IPv4Topology& topology);
         virtual void dumpConfig(IPv4Topology& topology);
 
+        /**
+         * Computes a hash of what the configuration depends on: the module
+         * hierarchy and its connections, channel parameters, the interfaces and
+         * forwarding settings of the network nodes, and the parameters of this
+         * module including the XML configuration. It keys the configuration
+         * cache (see the configCache parameter).
+         */
+        virtual uint64 computeConfigurationHash();
+
+        /**
+         * Loads the addresses and routes computed by an earlier run from the given
+         * file into the topology. Returns false, leaving the topology empty, if
+         * the file does not exist, belongs to a different hash, is truncated, or
+         * does not match the network; the configuration is then computed as usual.
+         */
+        virtual bool loadConfigurationCache(IPv4Topology& topology, const char *fileName, uint64 hash);
+
+        /**
+         * Saves the addresses and routes of the topology in a compact binary file.
+         * The file is written under a temporary name first and then renamed, so
+         * concurrent runs never see a partially written cache.
+         */
+        virtual void saveConfigurationCache(IPv4Topology& topology, const char *fileName, uint64 hash);
+
         // helper functions
+        void setInterfaceAddresses(IPv4Topology& topology);
         virtual void performConfigurations(IPv4Topology& topology, unsigned int networkID);
         virtual void extractWiredNeighbors(IPv4Topology& topology, Topology::LinkOut *linkOut, LinkInfo* linkInfo, std::set<InterfaceEntry *>& interfacesSeen, std::vector<Node *>& nodesVisited);
         virtual void extractWirelessNeighbors(IPv4Topology& topology, const char *wirelessId, LinkInfo* linkInfo, std::set<InterfaceEntry *>& interfacesSeen, std::vector<Node *>& nodesVisited);
@@ -331,6 +372,9 @@ class INET_API IPv4NetworkConfigurator : public cSimpleModule, public IPvXAddres
                 uint32& mergedNetmask, uint32& mergedNetmaskSpecifiedBits, uint32& mergedNetmaskIncompatibleBits);
 
         // helpers for routing table optimization
+        struct RouteLessThan {
+            bool operator()(const IPv4Route *route1, const IPv4Route *route2) const;
+        };
         bool containsRoute(const std::vector<IPv4Route *>& routes, IPv4Route *route);
         bool routesHaveSameColor(IPv4Route *route1, IPv4Route *route2);
         int findRouteIndexWithSameColor(const std::vector<IPv4Route *>& routes, IPv4Route *route);
@@ -409,10 +409,10 @@ void Established::entry()
         }
     }
 
-    std::vector<BGP::RoutingTableEntry*> BGPRoutingTable = session.getBGPRoutingTable();
-    for (std::vector<BGP::RoutingTableEntry*>::iterator it = BGPRoutingTable.begin(); it != BGPRoutingTable.end(); it++)
+    const BGP::RIB& BGPRoutingTable = session.getBGPRoutingTable();
+    for (int i = 0; i < BGPRoutingTable.getNumEntries(); i++)
     {
-        session.updateSendProcess((*it));
+        session.updateSendProcess(BGPRoutingTable.getEntry(i));
     }
 
     //when all EGP Session is in established state, start IGP Session(s)
@@ -0,0 +1,58 @@
+//
+// Copyright (C) 2015 OpenSim Ltd.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+
+#include "BGPRIB.h"
+
+
+void BGP::RIB::addEntry(RoutingTableEntry *entry)
+{
+    entries.push_back(entry);
+    entriesByPrefix[prefixOf(entry)].push_back(entry);
+}
+
+bool BGP::RIB::removeEntry(RoutingTableEntry *entry)
+{
+    PrefixMap::iterator it = entriesByPrefix.find(prefixOf(entry));
+    if (it == entriesByPrefix.end())
+        return false;
+    EntryVector& samePrefix = it->second;
+    EntryVector::iterator pos = std::find(samePrefix.begin(), samePrefix.end(), entry);
+    if (pos == samePrefix.end())
+        return false;
+    samePrefix.erase(pos);
+    if (samePrefix.empty())
+        entriesByPrefix.erase(it);
+
+    // keep the insertion order; removals are rare compared to lookups
+    entries.erase(std::find(entries.begin(), entries.end(), entry));
+    return true;
+}
+
+BGP::RoutingTableEntry *BGP::RIB::findEntry(const IPv4Route *entry) const
+{
+    PrefixMap::const_iterator it = entriesByPrefix.find(prefixOf(entry));
+    return it == entriesByPrefix.end() ? NULL : it->second.front();
+}
+
+void BGP::RIB::clear()
+{
+    entries.clear();
+    entriesByPrefix.clear();
+}
+
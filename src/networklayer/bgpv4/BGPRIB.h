@@ -0,0 +1,91 @@
+//
+// Copyright (C) 2015 OpenSim Ltd.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_BGPRIB_H
+#define __INET_BGPRIB_H
+
+#include <map>
+#include <vector>
+
+#include "INETDefs.h"
+
+#include "BGPRoutingTableEntry.h"
+
+namespace BGP {
+
+/**
+ * A set of BGP routes indexed by prefix, used for the Loc-RIB and the
+ * prefix deny lists of BGPRouting. Routes are identified by their masked
+ * destination address (destination & netmask), so a lookup finds the same
+ * route a linear search by the masked destination would: the first one
+ * added, in O(log n) instead of O(n).
+ *
+ * Routes are kept in insertion order as well, for iteration. The RIB does
+ * not own the routes.
+ */
+class INET_API RIB
+{
+  public:
+    typedef std::vector<RoutingTableEntry *> EntryVector;
+
+  protected:
+    typedef std::map<uint32, EntryVector> PrefixMap;
+
+    EntryVector entries;        // all routes, in insertion order
+    PrefixMap entriesByPrefix;  // masked destination -> routes, in insertion order
+
+  protected:
+    static uint32 prefixOf(const IPv4Route *entry) { return entry->getDestination().getInt() & entry->getNetmask().getInt(); }
+
+  public:
+    /**
+     * Appends the route. Routes with the same masked destination may be
+     * added several times; lookups return the first one.
+     */
+    void addEntry(RoutingTableEntry *entry);
+
+    /**
+     * Removes the route. Returns false if it was not found. The destination
+     * and netmask must be the same as at insertion.
+     */
+    bool removeEntry(RoutingTableEntry *entry);
+
+    /**
+     * Returns the first route added with the same masked destination as
+     * the given route (the netmasks are not compared), or NULL.
+     */
+    RoutingTableEntry *findEntry(const IPv4Route *entry) const;
+
+    /**
+     * Removes all routes.
+     */
+    void clear();
+
+    int getNumEntries() const { return entries.size(); }
+    RoutingTableEntry *getEntry(int k) const { return entries[k]; }
+
+    /**
+     * Returns the routes in insertion order. Non-const for WATCH_PTRVECTOR;
+     * do not modify.
+     */
+    EntryVector& getEntries() { return entries; }
+};
+
+} // namespace BGP
+
+#endif
+
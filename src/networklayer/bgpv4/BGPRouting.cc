@@ -32,9 +32,9 @@ BGPRouting::~BGPRouting(void)
     {
         (*sessionIterator).second->~BGPSession();
     }
-    _BGPRoutingTable.erase(_BGPRoutingTable.begin(), _BGPRoutingTable.end());
-    _prefixListIN.erase(_prefixListIN.begin(), _prefixListIN.end());
-    _prefixListOUT.erase(_prefixListOUT.begin(), _prefixListOUT.end());
+    _BGPRoutingTable.clear();
+    _prefixListIN.clear();
+    _prefixListOUT.clear();
 }
 
 void BGPRouting::initialize(int stage)
@@ -57,7 +57,7 @@ void BGPRouting::initialize(int stage)
         cXMLElement *bgpConfig = par("bgpConfig").xmlValue();
         loadConfigFromXML(bgpConfig);
         createWatch("myAutonomousSystem", _myAS);
-        WATCH_PTRVECTOR(_BGPRoutingTable);
+        createStdPtrVectorWatcher("_BGPRoutingTable", _BGPRoutingTable.getEntries());
     }
 }
 
@@ -300,7 +300,7 @@ void BGPRouting::processMessage(const BGPUpdateMessage& msg)
 unsigned char BGPRouting::decisionProcess(const BGPUpdateMessage& msg, BGP::RoutingTableEntry* entry, BGP::SessionID sessionIndex)
 {
     //Don't add the route if it exists in PrefixListINTable or in ASListINTable
-    if (isInTable(_prefixListIN, entry) != (unsigned long)-1 || isInASList(_ASListIN, entry))
+    if (_prefixListIN.findEntry(entry) != NULL || isInASList(_ASListIN, entry))
     {
         return 0;
     }
@@ -312,17 +312,17 @@ unsigned char BGPRouting::decisionProcess(const BGPUpdateMessage& msg, BGP::Rout
 
     //if the route already exist in BGP routing table, tieBreakingProcess();
     //(RFC 4271: 9.1.2.2 Breaking Ties)
-    unsigned long BGPindex = isInTable(_BGPRoutingTable, entry);
-    if (BGPindex != (unsigned long)-1)
+    BGP::RoutingTableEntry* oldEntry = _BGPRoutingTable.findEntry(entry);
+    if (oldEntry != NULL)
     {
-        if (tieBreakingProcess(_BGPRoutingTable[BGPindex], entry))
+        if (tieBreakingProcess(oldEntry, entry))
         {
             return 0;
         }
         else
         {
             entry->setInterface(_BGPSessions[sessionIndex]->getLinkIntf());
-            _BGPRoutingTable.push_back(entry);
+            _BGPRoutingTable.addEntry(entry);
             _rt->addRoute(entry);
             return BGP::ROUTE_DESTINATION_CHANGED;
         }
@@ -350,7 +350,7 @@ unsigned char BGPRouting::decisionProcess(const BGPUpdateMessage& msg, BGP::Rout
     }
 
     entry->setInterface(_BGPSessions[sessionIndex]->getLinkIntf());
-    _BGPRoutingTable.push_back(entry);
+    _BGPRoutingTable.addEntry(entry);
 
     if (_BGPSessions[sessionIndex]->getType() == BGP::EGP)
     {
@@ -402,11 +402,14 @@ void BGPRouting::updateSendProcess(const unsigned char type, BGP::SessionID sess
     //if it is not the currentSession and if the session is already established
     //SESSION = IGP : send an update message to External BGP Peer (EGP) only
     //if it is not the currentSession and if the session is already established
+    if (_prefixListOUT.findEntry(entry) != NULL || isInASList(_ASListOUT, entry))
+    {
+        return;
+    }
     for (std::map<BGP::SessionID, BGPSession*>::iterator sessionIt = _BGPSessions.begin();
         sessionIt != _BGPSessions.end(); sessionIt ++)
     {
-        if (isInTable(_prefixListOUT, entry) != (unsigned long)-1 || isInASList(_ASListOUT, entry) ||
-            ((*sessionIt).first == sessionIndex && type != BGP::NEW_SESSION_ESTABLISHED ) ||
+        if (((*sessionIt).first == sessionIndex && type != BGP::NEW_SESSION_ESTABLISHED ) ||
             (type == BGP::NEW_SESSION_ESTABLISHED && (*sessionIt).first != sessionIndex ) ||
             !(*sessionIt).second->isEstablished() )
         {
@@ -578,16 +581,16 @@ std::vector<const char *> BGPRouting::loadASConfig(cXMLElementList& ASConfig)
             entry->setNetmask(IPv4Address((*ASConfigIt)->getAttribute("Netmask")));
             if (nodeName == "DenyRouteIN")
             {
-                _prefixListIN.push_back(entry);
+                _prefixListIN.addEntry(entry);
             }
             else if (nodeName == "DenyRouteOUT")
             {
-                _prefixListOUT.push_back(entry);
+                _prefixListOUT.addEntry(entry);
             }
             else
             {
-                _prefixListIN.push_back(entry);
-                _prefixListOUT.push_back(entry);
+                _prefixListIN.addEntry(entry);
+                _prefixListOUT.addEntry(entry);
             }
         }
         else if (nodeName == "DenyAS" || nodeName == "DenyASIN" || nodeName == "DenyASOUT")
@@ -595,16 +598,16 @@ std::vector<const char *> BGPRouting::loadASConfig(cXMLElementList& ASConfig)
             BGP::ASID ASCur = atoi((*ASConfigIt)->getNodeValue());
             if (nodeName == "DenyASIN")
             {
-                _ASListIN.push_back(ASCur);
+                _ASListIN.insert(ASCur);
             }
             else if (nodeName == "DenyASOUT")
             {
-                _ASListOUT.push_back(ASCur);
+                _ASListOUT.insert(ASCur);
             }
             else
             {
-                _ASListIN.push_back(ASCur);
-                _ASListOUT.push_back(ASCur);
+                _ASListIN.insert(ASCur);
+                _ASListOUT.insert(ASCur);
             }
         }
         else
@@ -733,9 +736,9 @@ BGP::SessionID BGPRouting::createSession(BGP::type typeSession, const char* peer
 }
 
 
-BGP::SessionID BGPRouting::findIdFromPeerAddr(std::map<BGP::SessionID, BGPSession*> sessions, IPv4Address peerAddr)
+BGP::SessionID BGPRouting::findIdFromPeerAddr(const std::map<BGP::SessionID, BGPSession*>& sessions, IPv4Address peerAddr)
 {
-    for (std::map<BGP::SessionID, BGPSession*>::iterator sessionIterator = sessions.begin();
+    for (std::map<BGP::SessionID, BGPSession*>::const_iterator sessionIterator = sessions.begin();
         sessionIterator != sessions.end(); sessionIterator ++)
     {
         if ((*sessionIterator).second->getPeerAddr().equals(peerAddr))
@@ -748,29 +751,43 @@ BGP::SessionID BGPRouting::findIdFromPeerAddr(std::map<BGP::SessionID, BGPSessio
 
 /*delete BGP Routing entry, if the route deleted correctly return true, false else*/
 bool BGPRouting::deleteBGPRoutingEntry(BGP::RoutingTableEntry* entry){
-    for (std::vector<BGP::RoutingTableEntry*>::iterator it = _BGPRoutingTable.begin();
-         it != _BGPRoutingTable.end(); it++)
+    BGP::RoutingTableEntry* oldEntry = _BGPRoutingTable.findEntry(entry);
+    if (oldEntry != NULL)
     {
-        if (((*it)->getDestination().getInt() & (*it)->getNetmask().getInt()) ==
-            (entry->getDestination().getInt() & entry->getNetmask().getInt()))
-        {
-            _BGPRoutingTable.erase(it);
-            _rt->deleteRoute(entry);
-            return true;
-        }
+        _BGPRoutingTable.removeEntry(oldEntry);
+        _rt->deleteRoute(entry);
+        return true;
     }
     return false;
 }
 
-/*return index of the IPv4 table if the route is found, -1 else*/
+/*return index of the first route of the IPv4 table that covers addr, -1 else*/
 int BGPRouting::isInRoutingTable(IRoutingTable* rtTable, IPv4Address addr)
 {
-    for (int i = 0; i < rtTable->getNumRoutes(); i++)
-    {
-        const IPv4Route* entry = rtTable->getRoute(i);
-        if (IPv4Address::maskedAddrAreEqual(addr, entry->getDestination(), entry->getNetmask()))
+    // The routes are sorted by netmask (longest first), then by destination,
+    // so the first route covering addr is the first one with the longest
+    // netmask for which (netmask, addr & netmask) is in the table. Each
+    // prefix length is looked up by binary search; invalid routes count too.
+    int numRoutes = rtTable->getNumRoutes();
+    for (int length = 32; length >= 0; length--)
+    {
+        IPv4Address netmask = IPv4Address::makeNetmask(length);
+        IPv4Address destination = addr.doAnd(netmask);
+        int lo = 0, hi = numRoutes;
+        while (lo < hi)
+        {
+            int mid = lo + (hi - lo) / 2;
+            const IPv4Route* entry = rtTable->getRoute(mid);
+            if (entry->getNetmask() > netmask || (entry->getNetmask() == netmask && entry->getDestination() < destination))
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo < numRoutes)
         {
-            return i;
+            const IPv4Route* entry = rtTable->getRoute(lo);
+            if (entry->getNetmask() == netmask && entry->getDestination() == destination)
+                return lo;
         }
     }
     return -1;
@@ -788,9 +805,9 @@ int BGPRouting::isInInterfaceTable(IInterfaceTable* ifTable, IPv4Address addr)
     return -1;
 }
 
-BGP::SessionID BGPRouting::findIdFromSocketConnId(std::map<BGP::SessionID, BGPSession*> sessions, int connId)
+BGP::SessionID BGPRouting::findIdFromSocketConnId(const std::map<BGP::SessionID, BGPSession*>& sessions, int connId)
 {
-    for (std::map<BGP::SessionID, BGPSession*>::iterator sessionIterator = sessions.begin();
+    for (std::map<BGP::SessionID, BGPSession*>::const_iterator sessionIterator = sessions.begin();
         sessionIterator != sessions.end(); sessionIterator ++)
     {
         TCPSocket* socket = (*sessionIterator).second->getSocket();
@@ -802,32 +819,14 @@ BGP::SessionID BGPRouting::findIdFromSocketConnId(std::map<BGP::SessionID, BGPSe
     return -1;
 }
 
-/*return index of the table if the route is found, -1 else*/
-unsigned long BGPRouting::isInTable(std::vector<BGP::RoutingTableEntry*> rtTable, BGP::RoutingTableEntry* entry)
-{
-    for (unsigned long i = 0; i < rtTable.size(); i++)
-    {
-        BGP::RoutingTableEntry* entryCur = rtTable[i];
-        if ((entry->getDestination().getInt() & entry->getNetmask().getInt()) ==
-            (entryCur->getDestination().getInt() & entryCur->getNetmask().getInt()))
-        {
-            return i;
-        }
-    }
-    return -1;
-}
-
 /*return true if the AS is found, false else*/
-bool BGPRouting::isInASList(std::vector<BGP::ASID> ASList, BGP::RoutingTableEntry* entry)
+bool BGPRouting::isInASList(const std::set<BGP::ASID>& ASList, BGP::RoutingTableEntry* entry)
 {
-    for (std::vector<BGP::ASID>::iterator it = ASList.begin(); it != ASList.end(); it++)
+    for (unsigned int i = 0; i < entry->getASCount(); i++)
     {
-        for (unsigned int i = 0; i < entry->getASCount(); i++)
+        if (ASList.find(entry->getAS(i)) != ASList.end())
         {
-            if ((*it) == entry->getAS(i))
-            {
-                return true;
-            }
+            return true;
         }
     }
     return false;
@@ -836,6 +835,12 @@ bool BGPRouting::isInASList(std::vector<BGP::ASID> ASList, BGP::RoutingTableEntr
 /*return true if OSPF exists, false else*/
 bool BGPRouting::ospfExist(IRoutingTable* rtTable)
 {
+    // without an OSPF module there is nothing to insert external routes
+    // into, so don't scan the whole table for every new EGP route
+    if (OSPFRoutingAccess().getIfExists() == NULL)
+    {
+        return false;
+    }
     for (int i=0; i<rtTable->getNumRoutes(); i++)
     {
         if (rtTable->getRoute(i)->getSourceType() == IPv4Route::OSPF)
@@ -18,6 +18,8 @@
 #ifndef __INET_BGPROUTING_H
 #define __INET_BGPROUTING_H
 
+#include <set>
+
 #include "INETDefs.h"
 
 #include "TCPSocket.h"
@@ -26,6 +28,7 @@
 #include "InterfaceTableAccess.h"
 #include "OSPFRoutingAccess.h"
 #include "BGPRoutingTableEntry.h"
+#include "BGPRIB.h"
 #include "BGPCommon.h"
 #include "IPv4InterfaceData.h"
 #include "IPv4Address.h"
@@ -66,7 +69,7 @@ protected:
     cMessage*       getCancelEvent(cMessage* msg)               { return cancelEvent(msg);}
     cGate*          getGate(const char* gateName)               { return gate(gateName);}
     IRoutingTable*  getIPRoutingTable()                         { return _rt;}
-    std::vector<BGP::RoutingTableEntry*> getBGPRoutingTable()   { return _BGPRoutingTable;}
+    const BGP::RIB& getBGPRoutingTable()                        { return _BGPRoutingTable;}
     /**
      * \brief active listenSocket for a given session (used by BGPFSM)
      */
@@ -90,7 +93,7 @@ protected:
      */
     bool checkExternalRoute(const IPv4Route* ospfRoute);
 
-private:
+protected:
     void handleTimer(cMessage *timer);
 
     void processMessageFromTCP(cMessage *msg);
@@ -114,8 +117,7 @@ private:
     bool tieBreakingProcess(BGP::RoutingTableEntry* oldEntry, BGP::RoutingTableEntry* entry);
 
     BGP::SessionID createSession(BGP::type typeSession, const char* peerAddr);
-    bool isInASList(std::vector<BGP::ASID> ASList, BGP::RoutingTableEntry* entry);
-    unsigned long   isInTable(std::vector<BGP::RoutingTableEntry*> rtTable, BGP::RoutingTableEntry* entry);
+    bool isInASList(const std::set<BGP::ASID>& ASList, BGP::RoutingTableEntry* entry);
 
     std::vector<const char *> loadASConfig(cXMLElementList& ASConfig);
     void loadSessionConfig(cXMLElementList& sessionList, simtime_t* delayTab);
@@ -124,10 +126,10 @@ private:
     bool ospfExist(IRoutingTable* rtTable);
     void loadTimerConfig(cXMLElementList& timerConfig, simtime_t* delayTab);
     unsigned char asLoopDetection(BGP::RoutingTableEntry* entry, BGP::ASID myAS);
-    BGP::SessionID findIdFromPeerAddr(std::map<BGP::SessionID, BGPSession*> sessions, IPv4Address peerAddr);
-    int isInRoutingTable(IRoutingTable* rtTable, IPv4Address addr);
+    BGP::SessionID findIdFromPeerAddr(const std::map<BGP::SessionID, BGPSession*>& sessions, IPv4Address peerAddr);
+    static int isInRoutingTable(IRoutingTable* rtTable, IPv4Address addr);
     int isInInterfaceTable(IInterfaceTable* rtTable, IPv4Address addr);
-    BGP::SessionID findIdFromSocketConnId(std::map<BGP::SessionID, BGPSession*> sessions, int connId);
+    BGP::SessionID findIdFromSocketConnId(const std::map<BGP::SessionID, BGPSession*>& sessions, int connId);
     unsigned int calculateStartDelay(int rtListSize, unsigned char rtPosition, unsigned char rtPeerPosition);
 
     TCPSocketMap                            _socketMap;
@@ -136,11 +138,11 @@ private:
 
     IInterfaceTable*                        _inft;
     IRoutingTable*                          _rt;                // The IP routing table
-    std::vector<BGP::RoutingTableEntry*>    _BGPRoutingTable;   // The BGP routing table
-    std::vector<BGP::RoutingTableEntry*>    _prefixListIN;
-    std::vector<BGP::RoutingTableEntry*>    _prefixListOUT;
-    std::vector<BGP::ASID>                  _ASListIN;
-    std::vector<BGP::ASID>                  _ASListOUT;
+    BGP::RIB                                _BGPRoutingTable;   // The BGP routing table (Loc-RIB)
+    BGP::RIB                                _prefixListIN;
+    BGP::RIB                                _prefixListOUT;
+    std::set<BGP::ASID>                     _ASListIN;
+    std::set<BGP::ASID>                     _ASListOUT;
     std::map<BGP::SessionID, BGPSession*>   _BGPSessions;
 
     static const int  BGP_TCP_CONNECT_VALID = 71;
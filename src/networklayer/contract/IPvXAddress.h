@@ -218,6 +218,12 @@ class INET_API IPvXAddress
      */
     const uint32 *words() const {return d;}
 
+    /**
+     * Returns a hash of the address, for hash tables (see HashIndex).
+     * Equal addresses have equal hashes.
+     */
+    unsigned int getHash() const {return isv6 ? (d[0] ^ d[1] ^ d[2] ^ d[3] ^ 0x9e3779b9u) : d[0];}
+
     /**
      * Returns true if the two addresses are equal
      */
@@ -0,0 +1,193 @@
+//
+// Copyright (C) 2015 OpenSim Ltd.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_FILTERINDEX_H
+#define __INET_FILTERINDEX_H
+
+#include <algorithm>
+#include <vector>
+
+#include "INETDefs.h"
+
+/**
+ * A set of filters, identified by their position in a filter list,
+ * stored as a bit vector.
+ *
+ * @see FilterIndex
+ */
+class INET_API FilterSet
+{
+  protected:
+    std::vector<uint64> words;
+
+  public:
+    FilterSet() {}
+    explicit FilterSet(int numFilters) : words((numFilters + 63) / 64, 0) {}
+
+    void add(int filter) { words[filter / 64] |= (uint64)1 << (filter % 64); }
+    void remove(int filter) { words[filter / 64] &= ~((uint64)1 << (filter % 64)); }
+    bool contains(int filter) const { return (words[filter / 64] >> (filter % 64)) & 1; }
+
+    int getNumWords() const { return words.size(); }
+    uint64 getWord(int i) const { return words[i]; }
+
+    /**
+     * Returns the position of the lowest bit set in a nonzero word.
+     */
+    static int getLowestBit(uint64 word)
+    {
+        int bit = 0;
+        if (!(word & 0xffffffffu)) { word >>= 32; bit += 32; }
+        if (!(word & 0xffffu)) { word >>= 16; bit += 16; }
+        if (!(word & 0xffu)) { word >>= 8; bit += 8; }
+        while (!(word & 1)) { word >>= 1; bit++; }
+        return bit;
+    }
+};
+
+/**
+ * Index of a filter list over one packet field (address, port, etc.).
+ * Every filter matches one range of field values, or none at all. The
+ * ranges cut the value space into elementary intervals; the index stores
+ * the set of matching filters for each interval, so a lookup is a binary
+ * search. Intersecting the sets found for all fields of a packet gives
+ * the filters matching the packet ("bit vector" packet classification);
+ * the first matching filter is the lowest element of the intersection.
+ *
+ * Key must be copyable and have operator<.
+ */
+template <typename Key>
+class FilterIndex
+{
+  protected:
+    struct Event
+    {
+        Key key;
+        bool after;    // position: at key, or right after key
+        int filter;
+        bool start;
+
+        bool operator<(const Event& other) const
+        {
+            if (key < other.key) return true;
+            if (other.key < key) return false;
+            return after < other.after;
+        }
+    };
+
+    int numFilters;
+    std::vector<Event> events;   // collected by addRange(), consumed by build()
+
+    // interval i starts at bounds[i] and extends to the start of interval i+1
+    struct Bound
+    {
+        Key key;
+        bool after;    // starts right after key, not at key
+    };
+    std::vector<Bound> bounds;
+    std::vector<FilterSet> sets;
+    FilterSet noFilters;   // for values before the first interval
+
+  public:
+    FilterIndex() : numFilters(0) {}
+
+    /**
+     * Starts building a new index for a list of numFilters filters.
+     */
+    void clear(int numFilters)
+    {
+        this->numFilters = numFilters;
+        events.clear();
+        bounds.clear();
+        sets.clear();
+        noFilters = FilterSet(numFilters);
+    }
+
+    /**
+     * Declares that the filter matches the values between min and max
+     * (inclusive). May be called at most once for every filter; filters
+     * without a range do not match any value.
+     */
+    void addRange(int filter, const Key& min, const Key& max)
+    {
+        Event e;
+        e.filter = filter;
+        e.key = min;
+        e.after = false;
+        e.start = true;
+        events.push_back(e);
+        e.key = max;
+        e.after = true;
+        e.start = false;
+        events.push_back(e);
+    }
+
+    /**
+     * Computes the intervals from the ranges added since clear().
+     */
+    void build()
+    {
+        std::stable_sort(events.begin(), events.end());
+        FilterSet current(numFilters);
+        for (unsigned int i = 0; i < events.size(); )
+        {
+            unsigned int j = i;
+            for ( ; j < events.size() && !(events[i] < events[j]); j++)
+            {
+                if (events[j].start)
+                    current.add(events[j].filter);
+                else
+                    current.remove(events[j].filter);
+            }
+            Bound bound;
+            bound.key = events[i].key;
+            bound.after = events[i].after;
+            bounds.push_back(bound);
+            sets.push_back(current);
+            i = j;
+        }
+        events.clear();
+    }
+
+    /**
+     * Returns the set of filters whose range contains the value.
+     */
+    const FilterSet& lookup(const Key& value) const
+    {
+        // find the last interval that starts at or before the value
+        int lo = 0, hi = bounds.size();
+        while (lo < hi)
+        {
+            int mid = (lo + hi) / 2;
+            const Bound& bound = bounds[mid];
+            bool startsAtOrBefore = bound.after ? bound.key < value : !(value < bound.key);
+            if (startsAtOrBefore)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo == 0 ? noFilters : sets[lo - 1];
+    }
+
+    /**
+     * Returns the number of elementary intervals. For statistics.
+     */
+    int getNumIntervals() const { return bounds.size(); }
+};
+
+#endif
+
@@ -16,6 +16,8 @@
 // along with this program; if not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <climits>
+
 #include "INETDefs.h"
 #include "IPvXAddress.h"
 #include "IPvXAddressResolver.h"
@@ -146,6 +148,7 @@ void MultiFieldClassifier::initialize(int stage)
     {
         cXMLElement *config = par("filters").xmlValue();
         configureFilters(config);
+        compileFilters();
     }
 }
 
@@ -172,33 +175,73 @@ void MultiFieldClassifier::handleMessage(cMessage *msg)
 
 int MultiFieldClassifier::classifyPacket(cPacket *packet)
 {
+    // same result as testing Filter::matches() of each filter in order, see compileFilters()
     for (; packet; packet = packet->getEncapsulatedPacket())
     {
 #ifdef WITH_IPv4
         IPv4Datagram *ipv4Datagram = dynamic_cast<IPv4Datagram*>(packet);
         if (ipv4Datagram)
-        {
-            for (std::vector<Filter>::iterator it = filters.begin(); it != filters.end(); ++it)
-                if (it->matches(ipv4Datagram))
-                    return it->gateIndex;
-            return -1;
-        }
+            return findFirstMatchingFilter(srcAddr4Index.lookup(ipv4Datagram->getSrcAddress().getInt()),
+                                           destAddr4Index.lookup(ipv4Datagram->getDestAddress().getInt()),
+                                           ipv4Datagram->getTransportProtocol(), ipv4Datagram->getTypeOfService(),
+                                           ipv4Datagram->getEncapsulatedPacket());
 #endif
 #ifdef WITH_IPv6
         IPv6Datagram *ipv6Datagram = dynamic_cast<IPv6Datagram *>(packet);
         if (ipv6Datagram)
-        {
-            for (std::vector<Filter>::iterator it = filters.begin(); it != filters.end(); ++it)
-                if (it->matches(ipv6Datagram))
-                    return it->gateIndex;
-            return -1;
-        }
+            return findFirstMatchingFilter(srcAddr6Index.lookup(ipv6Datagram->getSrcAddress()),
+                                           destAddr6Index.lookup(ipv6Datagram->getDestAddress()),
+                                           ipv6Datagram->getTransportProtocol(), ipv6Datagram->getTrafficClass(),
+                                           ipv6Datagram->getEncapsulatedPacket());
 #endif
     }
 
     return -1;
 }
 
+int MultiFieldClassifier::findFirstMatchingFilter(const FilterSet& srcAddrSet, const FilterSet& destAddrSet,
+                                                  int protocol, int tos, cPacket *transportPacket)
+{
+    int srcPort = -1, destPort = -1;
+    if (filtersUsePorts)
+        getPorts(transportPacket, srcPort, destPort);
+
+    const FilterSet& protocolSet = protocolIndex.lookup(protocol);
+    const FilterSet& tosSet = tosIndex[tos & 0xff];
+    const FilterSet& srcPortSet = srcPortIndex.lookup(srcPort);
+    const FilterSet& destPortSet = destPortIndex.lookup(destPort);
+
+    int numWords = protocolSet.getNumWords();
+    for (int i = 0; i < numWords; i++)
+    {
+        uint64 word = srcAddrSet.getWord(i) & destAddrSet.getWord(i) & protocolSet.getWord(i) &
+                      tosSet.getWord(i) & srcPortSet.getWord(i) & destPortSet.getWord(i);
+        if (word)
+            return filters[i * 64 + FilterSet::getLowestBit(word)].gateIndex;
+    }
+    return -1;
+}
+
+void MultiFieldClassifier::getPorts(cPacket *transportPacket, int& srcPort, int& destPort)
+{
+#ifdef WITH_UDP
+    UDPPacket *udpPacket = dynamic_cast<UDPPacket*>(transportPacket);
+    if (udpPacket)
+    {
+        srcPort = udpPacket->getSourcePort();
+        destPort = udpPacket->getDestinationPort();
+    }
+#endif
+#ifdef WITH_TCP_COMMON
+    TCPSegment *tcpSegment = dynamic_cast<TCPSegment*>(transportPacket);
+    if (tcpSegment)
+    {
+        srcPort = tcpSegment->getSrcPort();
+        destPort = tcpSegment->getDestPort();
+    }
+#endif
+}
+
 void MultiFieldClassifier::addFilter(const Filter &filter)
 {
     if (filter.gateIndex < 0 || filter.gateIndex >= numOutGates)
@@ -297,4 +340,97 @@ void MultiFieldClassifier::configureFilters(cXMLElement *config)
     }
 }
 
+void MultiFieldClassifier::compileFilters()
+{
+    // Every field of a filter matches a single range of values (or all values,
+    // or none), mirroring the tests in Filter::matches().
+    int numFilters = filters.size();
+#ifdef WITH_IPv4
+    srcAddr4Index.clear(numFilters);
+    destAddr4Index.clear(numFilters);
+#endif
+#ifdef WITH_IPv6
+    srcAddr6Index.clear(numFilters);
+    destAddr6Index.clear(numFilters);
+#endif
+    protocolIndex.clear(numFilters);
+    srcPortIndex.clear(numFilters);
+    destPortIndex.clear(numFilters);
+    tosIndex.assign(256, FilterSet(numFilters));
+    filtersUsePorts = false;
+
+    for (int i = 0; i < numFilters; i++)
+    {
+        const Filter& filter = filters[i];
+#ifdef WITH_IPv4
+        addAddressRange4(srcAddr4Index, i, filter.srcAddr, filter.srcPrefixLength);
+        addAddressRange4(destAddr4Index, i, filter.destAddr, filter.destPrefixLength);
+#endif
+#ifdef WITH_IPv6
+        addAddressRange6(srcAddr6Index, i, filter.srcAddr, filter.srcPrefixLength);
+        addAddressRange6(destAddr6Index, i, filter.destAddr, filter.destPrefixLength);
+#endif
+        if (filter.protocol >= 0)
+            protocolIndex.addRange(i, filter.protocol, filter.protocol);
+        else
+            protocolIndex.addRange(i, INT_MIN, INT_MAX);
+
+        for (int tos = 0; tos < 256; tos++)
+            if (filter.tosMask == 0 || (filter.tos & filter.tosMask) == (tos & filter.tosMask))
+                tosIndex[tos].add(i);
+
+        // packets without ports are looked up with port -1
+        if (filter.srcPortMin >= 0)
+            srcPortIndex.addRange(i, filter.srcPortMin, filter.srcPortMax);
+        else
+            srcPortIndex.addRange(i, -1, INT_MAX);
+        if (filter.destPortMin >= 0)
+            destPortIndex.addRange(i, filter.destPortMin, filter.destPortMax);
+        else
+            destPortIndex.addRange(i, -1, INT_MAX);
+        if (filter.srcPortMin >= 0 || filter.destPortMin >= 0)
+            filtersUsePorts = true;
+    }
+
+#ifdef WITH_IPv4
+    srcAddr4Index.build();
+    destAddr4Index.build();
+#endif
+#ifdef WITH_IPv6
+    srcAddr6Index.build();
+    destAddr6Index.build();
+#endif
+    protocolIndex.build();
+    srcPortIndex.build();
+    destPortIndex.build();
+}
 
+#ifdef WITH_IPv4
+void MultiFieldClassifier::addAddressRange4(FilterIndex<uint32>& index, int filter, const IPvXAddress& addr, int prefixLength)
+{
+    if (prefixLength <= 0)
+        index.addRange(filter, 0, 0xffffffffu);
+    else if (!addr.isIPv6())
+    {
+        uint32 mask = IPv4Address::makeNetmask(std::min(prefixLength, 32)).getInt();
+        uint32 prefix = addr.get4().getInt() & mask;
+        index.addRange(filter, prefix, prefix | ~mask);
+    }
+}
+#endif
+
+#ifdef WITH_IPv6
+void MultiFieldClassifier::addAddressRange6(FilterIndex<IPv6Address>& index, int filter, const IPvXAddress& addr, int prefixLength)
+{
+    if (prefixLength <= 0)
+        index.addRange(filter, IPv6Address(0, 0, 0, 0), IPv6Address(0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu));
+    else if (addr.isIPv6())
+    {
+        IPv6Address prefix = addr.get6().getPrefix(prefixLength);
+        IPv6Address suffixMask = IPv6Address::constructMask(prefixLength);
+        const uint32 *p = prefix.words();
+        const uint32 *m = suffixMask.words();
+        index.addRange(filter, prefix, IPv6Address(p[0] | ~m[0], p[1] | ~m[1], p[2] | ~m[2], p[3] | ~m[3]));
+    }
+}
+#endif
@@ -22,8 +22,14 @@
 
 #include "INETDefs.h"
 
+#include "IPvXAddress.h"
+#include "FilterIndex.h"
+
+class IPv4Datagram;
+class IPv6Datagram;
+
 /**
- * Absolute dropper.
+ * Multi-field classifier; see the NED file for more info.
  */
 class INET_API MultiFieldClassifier : public cSimpleModule
 {
@@ -59,6 +65,22 @@ class INET_API MultiFieldClassifier : public cSimpleModule
     int numOutGates;
     std::vector<Filter> filters;
 
+    // compiled form of 'filters': indices over the packet fields; a packet
+    // is classified by the first filter present in all sets found for it
+#ifdef WITH_IPv4
+    FilterIndex<uint32> srcAddr4Index;
+    FilterIndex<uint32> destAddr4Index;
+#endif
+#ifdef WITH_IPv6
+    FilterIndex<IPv6Address> srcAddr6Index;
+    FilterIndex<IPv6Address> destAddr6Index;
+#endif
+    FilterIndex<int> protocolIndex;
+    std::vector<FilterSet> tosIndex;    // indexed by the TOS / traffic class byte
+    FilterIndex<int> srcPortIndex;
+    FilterIndex<int> destPortIndex;
+    bool filtersUsePorts;
+
     int numRcvd;
 
     static simsignal_t pkClassSignal;
@@ -66,9 +88,19 @@ class INET_API MultiFieldClassifier : public cSimpleModule
   protected:
     void addFilter(const Filter &filter);
     void configureFilters(cXMLElement *config);
+    void compileFilters();
+    int findFirstMatchingFilter(const FilterSet& srcAddrSet, const FilterSet& destAddrSet,
+                                int protocol, int tos, cPacket *transportPacket);
+    static void getPorts(cPacket *transportPacket, int& srcPort, int& destPort);
+#ifdef WITH_IPv4
+    static void addAddressRange4(FilterIndex<uint32>& index, int filter, const IPvXAddress& addr, int prefixLength);
+#endif
+#ifdef WITH_IPv6
+    static void addAddressRange6(FilterIndex<IPv6Address>& index, int filter, const IPvXAddress& addr, int prefixLength);
+#endif
 
   public:
-    MultiFieldClassifier() {}
+    MultiFieldClassifier() : filtersUsePorts(false) {}
 
   protected:
     virtual int numInitStages() const { return 4; }
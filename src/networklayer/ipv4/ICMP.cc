@@ -84,6 +84,15 @@ void ICMP::sendErrorMessage(IPv4Datagram *origDatagram, int inputInterfaceId, IC
         return;
     }
 
+    // don't send ICMP error messages for non-first fragments (RFC 1122 3.2.2);
+    // they don't carry the transport header the sender would need anyway
+    if (origDatagram->getFragmentOffset() != 0)
+    {
+        EV << "won't send ICMP error messages for non-first fragment " << origDatagram << endl;
+        delete origDatagram;
+        return;
+    }
+
     // do not reply with error message to error message
     if (origDatagram->getTransportProtocol() == IP_PROT_ICMP)
     {
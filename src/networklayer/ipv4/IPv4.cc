@@ -748,6 +748,17 @@ void IPv4::fragmentAndSend(IPv4Datagram *datagram, const InterfaceEntry *ie, IPv
     int noOfFragments = (payloadLength + fragmentLength - 1) / fragmentLength;
     EV << "Breaking datagram into " << noOfFragments << " fragments\n";
 
+    // Only the first fragment carries the encapsulated packet, the others are
+    // header-only copies of the datagram (IPv4FragBuf keeps the one with the
+    // payload). The datagram may itself be a first fragment that is shorter
+    // than its payload, so its length is adjusted before decapsulating.
+    cPacket *encapsulatedPacket = NULL;
+    if (datagram->getEncapsulatedPacket())
+    {
+        datagram->setBitLength(datagram->getBitLength() + datagram->getEncapsulatedPacket()->getBitLength());
+        encapsulatedPacket = datagram->decapsulate();
+    }
+
     // create and send fragments
     std::string fragMsgName = datagram->getName();
     fragMsgName += "-frag";
@@ -758,10 +769,10 @@ void IPv4::fragmentAndSend(IPv4Datagram *datagram, const InterfaceEntry *ie, IPv
         // length equal to fragmentLength, except for last fragment;
         int thisFragmentLength = lastFragment ? payloadLength - offset : fragmentLength;
 
-        // FIXME is it ok that full encapsulated packet travels in every datagram fragment?
-        // should better travel in the last fragment only. Cf. with reassembly code!
-        IPv4Datagram *fragment = (IPv4Datagram *) datagram->dup();
+        IPv4Datagram *fragment = datagram->dup();
         fragment->setName(fragMsgName.c_str());
+        if (offset == 0 && encapsulatedPacket)
+            fragment->encapsulate(encapsulatedPacket);
 
         // "more fragments" bit is unchanged in the last fragment, otherwise true
         if (!lastFragment)
@@ -76,9 +76,9 @@ IPv4Datagram *IPv4FragBuf::addFragment(IPv4Datagram *datagram, simtime_t now)
                                            datagram->getFragmentOffset() + bytes,
                                            !datagram->getMoreFragments());
 
-    // store datagram. Only one fragment carries the actual modelled
-    // content (getEncapsulatedPacket()), other (empty) ones are only
-    // preserved so that we can send them in ICMP if reassembly times out.
+    // store datagram. Only one fragment (the first one, see IPv4::fragmentAndSend())
+    // carries the actual modelled content (getEncapsulatedPacket()), other (empty)
+    // ones are only preserved so that we can send them in ICMP if reassembly times out.
     if (buf->datagram == NULL)
     {
         buf->datagram = datagram;
@@ -101,7 +101,7 @@ IPv4Datagram *IPv4FragBuf::addFragment(IPv4Datagram *datagram, simtime_t now)
         ret->setByteLength(ret->getHeaderLength()+buf->buf.getTotalLength());
         ret->setFragmentOffset(0);
         ret->setMoreFragments(false);
-        bufs.erase(i);
+        bufs.erase(key);  // 'i' is invalid if this buffer was created above
         return ret;
     }
     else
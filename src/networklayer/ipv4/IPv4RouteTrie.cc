@@ -0,0 +1,214 @@
+//
+// Copyright (C) 2015 OpenSim Ltd.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+
+#include "IPv4RouteTrie.h"
+
+#include "IPv4Route.h"
+
+
+IPv4RouteTrie::IPv4RouteTrie(RouteLessThan lessThan) : lessThan(lessThan)
+{
+    root = new Node(0, 0, NULL);
+    numRoutes = 0;
+    numNodes = 1;
+}
+
+IPv4RouteTrie::~IPv4RouteTrie()
+{
+    deleteSubtree(root);
+}
+
+void IPv4RouteTrie::deleteSubtree(Node *node)
+{
+    if (node)
+    {
+        deleteSubtree(node->child[0]);
+        deleteSubtree(node->child[1]);
+        delete node;
+    }
+}
+
+void IPv4RouteTrie::clear()
+{
+    deleteSubtree(root->child[0]);
+    deleteSubtree(root->child[1]);
+    root->child[0] = root->child[1] = NULL;
+    root->routes.clear();
+    numRoutes = 0;
+    numNodes = 1;
+}
+
+int IPv4RouteTrie::commonPrefixLength(uint32 a, uint32 b, int maxLength)
+{
+    uint32 diff = a ^ b;
+    int length = 0;
+    while (length < maxLength && !(diff & (0x80000000u >> length)))
+        length++;
+    return length;
+}
+
+void IPv4RouteTrie::addRoute(IPv4Route *route)
+{
+    int length = route->getNetmask().getNetmaskLength();
+    uint32 prefix = route->getDestination().getInt() & mask(length);
+
+    Node *node = root;
+    while (node->length != length)
+    {
+        // here node->length < length, and node's prefix covers 'prefix'
+        int bit = bitAt(prefix, node->length);
+        Node *child = node->child[bit];
+        if (!child)
+        {
+            child = new Node(prefix, length, node);
+            node->child[bit] = child;
+            numNodes++;
+            node = child;
+            break;
+        }
+
+        int common = commonPrefixLength(prefix, child->prefix, std::min(length, child->length));
+        if (common == child->length)
+        {
+            node = child;
+            continue;
+        }
+
+        // the new prefix diverges from the child's prefix (or is a prefix of it):
+        // insert a node of length 'common' between node and child
+        Node *split = new Node(prefix & mask(common), common, node);
+        numNodes++;
+        node->child[bit] = split;
+        split->child[bitAt(child->prefix, common)] = child;
+        child->parent = split;
+        if (common == length)
+        {
+            node = split;
+        }
+        else
+        {
+            Node *leaf = new Node(prefix, length, split);
+            numNodes++;
+            split->child[bitAt(prefix, common)] = leaf;
+            node = leaf;
+        }
+        break;
+    }
+
+    // keep routes of the same prefix in the same order as RoutingTable::routes
+    std::vector<IPv4Route *>::iterator pos = std::upper_bound(node->routes.begin(), node->routes.end(), route, lessThan);
+    node->routes.insert(pos, route);
+    numRoutes++;
+}
+
+IPv4RouteTrie::Node *IPv4RouteTrie::findNode(uint32 prefix, int length) const
+{
+    Node *node = root;
+    while (node && node->length < length)
+    {
+        node = node->child[bitAt(prefix, node->length)];
+        if (node && (node->length > length || (prefix & mask(node->length)) != node->prefix))
+            return NULL;
+    }
+    return node;
+}
+
+IPv4RouteTrie::Node *IPv4RouteTrie::findNodeOf(Node *node, const IPv4Route *route) const
+{
+    if (!node)
+        return NULL;
+    if (std::find(node->routes.begin(), node->routes.end(), route) != node->routes.end())
+        return node;
+    Node *found = findNodeOf(node->child[0], route);
+    return found ? found : findNodeOf(node->child[1], route);
+}
+
+bool IPv4RouteTrie::removeRoute(IPv4Route *route)
+{
+    int length = route->getNetmask().getNetmaskLength();
+    uint32 prefix = route->getDestination().getInt() & mask(length);
+
+    Node *node = findNode(prefix, length);
+    if (!node || std::find(node->routes.begin(), node->routes.end(), route) == node->routes.end())
+    {
+        // destination or netmask was modified after insertion (see RoutingTable::routeChanged())
+        node = findNodeOf(root, route);
+        if (!node)
+            return false;
+    }
+    removeFromNode(node, route);
+    return true;
+}
+
+void IPv4RouteTrie::removeFromNode(Node *node, IPv4Route *route)
+{
+    node->routes.erase(std::find(node->routes.begin(), node->routes.end(), route));
+    numRoutes--;
+    compact(node);
+}
+
+void IPv4RouteTrie::compact(Node *node)
+{
+    // remove nodes that neither carry routes nor branch
+    while (node != root && node->routes.empty())
+    {
+        Node *parent = node->parent;
+        int side = parent->child[0] == node ? 0 : 1;
+        if (node->child[0] && node->child[1])
+            return;
+        Node *child = node->child[0] ? node->child[0] : node->child[1];
+        parent->child[side] = child;
+        if (child)
+            child->parent = parent;
+        delete node;
+        numNodes--;
+        if (child)
+            return;  // parent's branching did not change
+        node = parent;
+    }
+}
+
+IPv4Route *IPv4RouteTrie::findBestMatchingRoute(const IPv4Address& dest) const
+{
+    uint32 addr = dest.getInt();
+
+    // collect the matching nodes that carry routes, shortest prefix first
+    const Node *matches[33];
+    int numMatches = 0;
+    const Node *node = root;
+    while (node && (addr & mask(node->length)) == node->prefix)
+    {
+        if (!node->routes.empty())
+            matches[numMatches++] = node;
+        if (node->length == 32)
+            break;
+        node = node->child[bitAt(addr, node->length)];
+    }
+
+    // the longest prefix with a valid route wins
+    while (numMatches > 0)
+    {
+        const std::vector<IPv4Route *>& routes = matches[--numMatches]->routes;
+        for (std::vector<IPv4Route *>::const_iterator it = routes.begin(); it != routes.end(); ++it)
+            if ((*it)->isValid())
+                return *it;
+    }
+    return NULL;
+}
+
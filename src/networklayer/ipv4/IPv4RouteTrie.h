@@ -0,0 +1,118 @@
+//
+// Copyright (C) 2015 OpenSim Ltd.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __INET_IPv4ROUTETRIE_H
+#define __INET_IPv4ROUTETRIE_H
+
+
+#include <vector>
+
+#include "INETDefs.h"
+
+#include "IPv4Address.h"
+
+class IPv4Route;
+
+
+/**
+ * Longest prefix match index over IPv4 unicast routes, implemented as a
+ * path-compressed binary (Patricia) trie. Every node stands for one
+ * destination prefix; nodes that carry routes hold them in the order
+ * defined by the comparator given to the constructor, so the first valid
+ * route of the deepest matching node is the same route a linear scan of
+ * RoutingTable's sorted route vector would return.
+ *
+ * The trie does not own the routes. It is maintained incrementally by
+ * RoutingTable on every route insertion and removal; lookups cost at
+ * most 33 node visits regardless of the number of routes.
+ *
+ * @see RoutingTable
+ */
+class INET_API IPv4RouteTrie
+{
+  public:
+    typedef bool (*RouteLessThan)(const IPv4Route *a, const IPv4Route *b);
+
+  protected:
+    struct Node
+    {
+        uint32 prefix;      // destination prefix, bits outside 'length' are zero
+        int length;         // prefix length in bits (0..32)
+        Node *parent;
+        Node *child[2];     // subtrees for next bit 0 and 1
+        std::vector<IPv4Route *> routes;  // routes for exactly this prefix, best first
+
+        Node(uint32 prefix, int length, Node *parent) : prefix(prefix), length(length), parent(parent) {child[0] = child[1] = NULL;}
+    };
+
+    Node *root;               // the 0.0.0.0/0 node, always present
+    RouteLessThan lessThan;   // orders routes with the same prefix
+    int numRoutes;
+    int numNodes;
+
+  protected:
+    static uint32 mask(int length) { return length <= 0 ? 0 : length >= 32 ? 0xffffffffu : ~(0xffffffffu >> length); }
+    static int bitAt(uint32 addr, int pos) { return (addr >> (31 - pos)) & 1; }
+    static int commonPrefixLength(uint32 a, uint32 b, int maxLength);
+
+    Node *findNode(uint32 prefix, int length) const;
+    Node *findNodeOf(Node *node, const IPv4Route *route) const;
+    void removeFromNode(Node *node, IPv4Route *route);
+    void compact(Node *node);
+    void deleteSubtree(Node *node);
+
+  public:
+    IPv4RouteTrie(RouteLessThan lessThan);
+    ~IPv4RouteTrie();
+
+    /**
+     * Inserts the route under the prefix given by its destination and netmask.
+     * The netmask must be a valid (contiguous) netmask.
+     */
+    void addRoute(IPv4Route *route);
+
+    /**
+     * Removes the route from the trie. Returns false if it was not found.
+     * Routes whose destination or netmask changed since insertion are
+     * still found (by a full traversal).
+     */
+    bool removeRoute(IPv4Route *route);
+
+    /**
+     * Removes all routes.
+     */
+    void clear();
+
+    /**
+     * Performs longest prefix match: returns the best valid route whose
+     * prefix covers the given address, or NULL if there is none.
+     */
+    IPv4Route *findBestMatchingRoute(const IPv4Address& dest) const;
+
+    /**
+     * Returns the number of routes stored in the trie.
+     */
+    int getNumRoutes() const { return numRoutes; }
+
+    /**
+     * Returns the number of trie nodes, including the root. For statistics.
+     */
+    int getNumNodes() const { return numNodes; }
+};
+
+#endif
+
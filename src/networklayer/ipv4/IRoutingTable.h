@@ -153,7 +153,9 @@ class INET_API IRoutingTable
     virtual int getNumRoutes() const = 0;
 
     /**
-     * Returns the kth route.
+     * Returns the kth route. Routes are ordered by netmask (longest first),
+     * then by destination address, so the first route matching an address
+     * is the one with the longest prefix.
      */
     virtual IPv4Route *getRoute(int k) const = 0;
 
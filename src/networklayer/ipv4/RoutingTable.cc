@@ -28,6 +28,7 @@
 #include "InterfaceTableAccess.h"
 #include "IPv4InterfaceData.h"
 #include "IPv4Route.h"
+#include "IPv4RouteTrie.h"
 #include "NotificationBoard.h"
 #include "NotifierConsts.h"
 #include "RoutingTableParser.h"
@@ -58,6 +59,9 @@ RoutingTable::RoutingTable()
 {
     ift = NULL;
     nb = NULL;
+    useRoutingCache = true;
+    preciseCacheInvalidation = false;
+    routeTrie = NULL;
 }
 
 RoutingTable::~RoutingTable()
@@ -66,6 +70,7 @@ RoutingTable::~RoutingTable()
         delete routes[i];
     for (unsigned int i=0; i<multicastRoutes.size(); i++)
         delete multicastRoutes[i];
+    delete routeTrie;
 }
 
 void RoutingTable::initialize(int stage)
@@ -79,6 +84,18 @@ void RoutingTable::initialize(int stage)
 
         IPForward = par("IPForward").boolValue();
         multicastForward = par("forwardMulticast");
+        useRoutingCache = par("useRoutingCache").boolValue();
+        preciseCacheInvalidation = par("preciseCacheInvalidation").boolValue();
+
+        const char *routeLookup = par("routeLookup").stringValue();
+        if (!strcmp(routeLookup, "trie"))
+        {
+            routeTrie = new IPv4RouteTrie(routeLessThan);
+            for (RouteVector::iterator it = routes.begin(); it != routes.end(); ++it)
+                routeTrie->addRoute(*it);
+        }
+        else if (strcmp(routeLookup, "linear"))
+            error("Invalid routeLookup parameter value '%s', must be 'linear' or 'trie'", routeLookup);
 
         nb->subscribe(this, NF_INTERFACE_CREATED);
         nb->subscribe(this, NF_INTERFACE_DELETED);
@@ -235,6 +252,7 @@ void RoutingTable::deleteInterfaceRoutes(InterfaceEntry *entry)
         if (route->getInterface() == entry)
         {
             it = routes.erase(it);
+            unindexRoute(route);
             ASSERT(route->getRoutingTable() == this); // still filled in, for the listeners' benefit
             nb->fireChangeNotification(NF_IPv4_ROUTE_DELETED, route);
             delete route;
@@ -284,6 +302,32 @@ void RoutingTable::invalidateCache()
     localBroadcastAddresses.clear();
 }
 
+void RoutingTable::invalidateRoutingCache()
+{
+    // local addresses only depend on the interface configuration
+    if (preciseCacheInvalidation)
+        routingCache.clear();
+    else
+        invalidateCache();
+}
+
+void RoutingTable::invalidateCacheForRoute(const IPv4Route *entry)
+{
+    if (!preciseCacheInvalidation)
+    {
+        invalidateCache();
+        return;
+    }
+
+    // the cache is ordered by address, so the destinations covered by the
+    // route's prefix form a contiguous range
+    IPv4Address destination = entry->getDestination();
+    IPv4Address netmask = entry->getNetmask();
+    RoutingCache::iterator it = routingCache.lower_bound(destination.doAnd(netmask));
+    while (it != routingCache.end() && IPv4Address::maskedAddrAreEqual(it->first, destination, netmask))
+        routingCache.erase(it++);
+}
+
 void RoutingTable::printRoutingTable() const
 {
     EV << "-- Routing table --\n";
@@ -469,6 +513,7 @@ void RoutingTable::purge()
         else
         {
             it = routes.erase(it);
+            unindexRoute(route);
             ASSERT(route->getRoutingTable() == this); // still filled in, for the listeners' benefit
             nb->fireChangeNotification(NF_IPv4_ROUTE_DELETED, route);
             delete route;
@@ -494,7 +539,7 @@ void RoutingTable::purge()
 
     if (deleted)
     {
-        invalidateCache();
+        invalidateRoutingCache();
         updateDisplayString();
     }
 }
@@ -503,30 +548,39 @@ IPv4Route *RoutingTable::findBestMatchingRoute(const IPv4Address& dest) const
 {
     Enter_Method("findBestMatchingRoute(%u.%u.%u.%u)", dest.getDByte(0), dest.getDByte(1), dest.getDByte(2), dest.getDByte(3)); // note: str().c_str() too slow here
 
-    RoutingCache::iterator it = routingCache.find(dest);
-    if (it != routingCache.end())
+    if (useRoutingCache)
     {
-        if (it->second==NULL || it->second->isValid())
-            return it->second;
+        RoutingCache::iterator it = routingCache.find(dest);
+        if (it != routingCache.end())
+        {
+            if (it->second==NULL || it->second->isValid())
+                return it->second;
+        }
     }
 
     // find best match (one with longest prefix)
     // default route has zero prefix length, so (if exists) it'll be selected as last resort
     IPv4Route *bestRoute = NULL;
-    for (RouteVector::const_iterator i=routes.begin(); i!=routes.end(); ++i)
+    if (routeTrie)
+        bestRoute = routeTrie->findBestMatchingRoute(dest);
+    else
     {
-        IPv4Route *e = *i;
-        if (e->isValid())
+        for (RouteVector::const_iterator i=routes.begin(); i!=routes.end(); ++i)
         {
-            if (IPv4Address::maskedAddrAreEqual(dest, e->getDestination(), e->getNetmask())) // match
+            IPv4Route *e = *i;
+            if (e->isValid())
             {
-                bestRoute = const_cast<IPv4Route *>(e);
-                break;
+                if (IPv4Address::maskedAddrAreEqual(dest, e->getDestination(), e->getNetmask())) // match
+                {
+                    bestRoute = const_cast<IPv4Route *>(e);
+                    break;
+                }
             }
         }
     }
 
-    routingCache[dest] = bestRoute;
+    if (useRoutingCache)
+        routingCache[dest] = bestRoute;
     return bestRoute;
 }
 
@@ -610,6 +664,18 @@ void RoutingTable::setRouterId(IPv4Address a)
     routerId = a;
 }
 
+void RoutingTable::indexRoute(IPv4Route *entry)
+{
+    if (routeTrie)
+        routeTrie->addRoute(entry);
+}
+
+void RoutingTable::unindexRoute(IPv4Route *entry)
+{
+    if (routeTrie && !routeTrie->removeRoute(entry))
+        error("route lookup index is inconsistent: route not found");
+}
+
 void RoutingTable::internalAddRoute(IPv4Route *entry)
 {
     if (!entry->getNetmask().isValidNetmask())
@@ -646,6 +712,7 @@ void RoutingTable::internalAddRoute(IPv4Route *entry)
     // stop at the first match when doing the longest netmask matching
     RouteVector::iterator pos = upper_bound(routes.begin(), routes.end(), entry, routeLessThan);
     routes.insert(pos, entry);
+    indexRoute(entry);
 
     entry->setRoutingTable(this);
 }
@@ -656,7 +723,7 @@ void RoutingTable::addRoute(IPv4Route *entry)
 
     internalAddRoute(entry);
 
-    invalidateCache();
+    invalidateCacheForRoute(entry);
     updateDisplayString();
 
     nb->fireChangeNotification(NF_IPv4_ROUTE_ADDED, entry);
@@ -668,6 +735,7 @@ IPv4Route *RoutingTable::internalRemoveRoute(IPv4Route *entry)
     if (i!=routes.end())
     {
         routes.erase(i);
+        unindexRoute(entry);
         return entry;
     }
     return NULL;
@@ -681,7 +749,7 @@ IPv4Route *RoutingTable::removeRoute(IPv4Route *entry)
 
     if (entry != NULL)
     {
-        invalidateCache();
+        invalidateCacheForRoute(entry);
         updateDisplayString();
         ASSERT(entry->getRoutingTable() == this); // still filled in, for the listeners' benefit
         nb->fireChangeNotification(NF_IPv4_ROUTE_DELETED, entry);
@@ -698,7 +766,7 @@ bool RoutingTable::deleteRoute(IPv4Route *entry)
 
     if (entry != NULL)
     {
-        invalidateCache();
+        invalidateCacheForRoute(entry);
         updateDisplayString();
         ASSERT(entry->getRoutingTable() == this); // still filled in, for the listeners' benefit
         nb->fireChangeNotification(NF_IPv4_ROUTE_DELETED, entry);
@@ -770,7 +838,8 @@ void RoutingTable::addMulticastRoute(IPv4MulticastRoute *entry)
 
     internalAddMulticastRoute(entry);
 
-    invalidateCache();
+    if (!preciseCacheInvalidation)
+        invalidateCache();
     updateDisplayString();
 
     nb->fireChangeNotification(NF_IPv4_MROUTE_ADDED, entry);
@@ -795,7 +864,8 @@ IPv4MulticastRoute *RoutingTable::removeMulticastRoute(IPv4MulticastRoute *entry
 
     if (entry != NULL)
     {
-        invalidateCache();
+        if (!preciseCacheInvalidation)
+            invalidateCache();
         updateDisplayString();
         ASSERT(entry->getRoutingTable() == this); // still filled in, for the listeners' benefit
         nb->fireChangeNotification(NF_IPv4_MROUTE_DELETED, entry);
@@ -812,7 +882,8 @@ bool RoutingTable::deleteMulticastRoute(IPv4MulticastRoute *entry)
 
     if (entry != NULL)
     {
-        invalidateCache();
+        if (!preciseCacheInvalidation)
+            invalidateCache();
         updateDisplayString();
         ASSERT(entry->getRoutingTable() == this); // still filled in, for the listeners' benefit
         nb->fireChangeNotification(NF_IPv4_MROUTE_DELETED, entry);
@@ -829,7 +900,11 @@ void RoutingTable::routeChanged(IPv4Route *entry, int fieldCode)
         ASSERT(entry != NULL);  // failure means inconsistency: route was not found in this routing table
         internalAddRoute(entry);
 
-        invalidateCache();
+        // the old prefix is not known any more if the destination or netmask changed
+        if (fieldCode==IPv4Route::F_METRIC)
+            invalidateCacheForRoute(entry);
+        else
+            invalidateRoutingCache();
         updateDisplayString();
     }
     nb->fireChangeNotification(NF_IPv4_ROUTE_CHANGED, entry); // TODO include fieldCode in the notification
@@ -844,7 +919,8 @@ void RoutingTable::multicastRouteChanged(IPv4MulticastRoute *entry, int fieldCod
         ASSERT(entry != NULL);  // failure means inconsistency: route was not found in this routing table
         internalAddMulticastRoute(entry);
 
-        invalidateCache();
+        if (!preciseCacheInvalidation)
+            invalidateCache();
         updateDisplayString();
     }
     nb->fireChangeNotification(NF_IPv4_MROUTE_CHANGED, entry); // TODO include fieldCode in the notification
@@ -860,6 +936,7 @@ void RoutingTable::updateNetmaskRoutes()
             std::vector<IPv4Route *>::iterator it = routes.begin()+(k--);  // '--' is necessary because indices shift down
             IPv4Route *route = *it;
             routes.erase(it);
+            unindexRoute(route);
             ASSERT(route->getRoutingTable() == this); // still filled in, for the listeners' benefit
             nb->fireChangeNotification(NF_IPv4_ROUTE_DELETED, route);
             delete route;
@@ -886,6 +963,7 @@ void RoutingTable::updateNetmaskRoutes()
             route->setRoutingTable(this);
             RouteVector::iterator pos = upper_bound(routes.begin(), routes.end(), route, routeLessThan);
             routes.insert(pos, route);
+            indexRoute(route);
             nb->fireChangeNotification(NF_IPv4_ROUTE_ADDED, route);
         }
     }
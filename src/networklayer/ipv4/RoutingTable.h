@@ -38,6 +38,7 @@
 #include "ILifecycle.h"
 
 class IInterfaceTable;
+class IPv4RouteTrie;
 class NotificationBoard;
 class RoutingTableParser;
 
@@ -81,6 +82,8 @@ class INET_API RoutingTable: public cSimpleModule, public IRoutingTable, protect
     IPv4Address routerId;
     bool IPForward;
     bool multicastForward;
+    bool useRoutingCache;
+    bool preciseCacheInvalidation;
 
     // for convenience
     typedef IPv4MulticastRoute::OutInterface OutInterface;
@@ -90,6 +93,9 @@ class INET_API RoutingTable: public cSimpleModule, public IRoutingTable, protect
     typedef std::map<IPv4Address, IPv4Route *> RoutingCache;
     mutable RoutingCache routingCache;
 
+    // longest prefix match index over 'routes', or NULL if lookups scan 'routes' linearly
+    IPv4RouteTrie *routeTrie;
+
     // local addresses cache (to speed up isLocalAddress())
     typedef std::set<IPv4Address> AddressSet;
     mutable AddressSet localAddresses;
@@ -130,12 +136,25 @@ class INET_API RoutingTable: public cSimpleModule, public IRoutingTable, protect
     // invalidates routing cache and local addresses cache
     virtual void invalidateCache();
 
+    // invalidates the routing cache after the route table changed; unless
+    // preciseCacheInvalidation is set, it also invalidates the local addresses cache
+    virtual void invalidateRoutingCache();
+
+    // invalidates the routing cache entries that may be affected by adding, removing
+    // or modifying the given route, i.e. those covered by its destination prefix;
+    // falls back to invalidateCache() unless preciseCacheInvalidation is set
+    virtual void invalidateCacheForRoute(const IPv4Route *entry);
+
     // helper for sorting routing table, used by addRoute()
     static bool routeLessThan(const IPv4Route *a, const IPv4Route *b);
 
     // helper for sorting multicast routing table, used by addMulticastRoute()
     static bool multicastRouteLessThan(const IPv4MulticastRoute *a, const IPv4MulticastRoute *b);
 
+    // keeps the route lookup index in sync with 'routes'
+    void indexRoute(IPv4Route *entry);
+    void unindexRoute(IPv4Route *entry);
+
     // helper functions:
     void internalAddRoute(IPv4Route *entry);
     IPv4Route *internalRemoveRoute(IPv4Route *entry);
@@ -122,7 +122,7 @@ IPv6Datagram *IPv6FragBuf::addFragment(IPv6Datagram *datagram, IPv6FragmentHeade
         ASSERT(ret);
         ret->removeExtensionHeader(IP_PROT_IPv6EXT_FRAGMENT);
         ret->setByteLength(ret->calculateUnfragmentableHeaderByteLength()+buf->buf.getTotalLength());
-        bufs.erase(i);
+        bufs.erase(key);  // 'i' is invalid if this buffer was created above
         return ret;
     }
     else
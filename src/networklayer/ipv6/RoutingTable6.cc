@@ -114,6 +114,7 @@ void RoutingTable6::initialize(int stage)
         WATCH_MAP(destCache); // FIXME commented out for now
         isrouter = par("isRouter");
         multicastForward = par("forwardMulticast");
+        preciseCacheInvalidation = par("preciseCacheInvalidation").boolValue();
         WATCH(isrouter);
 
 #ifdef WITH_xMIPv6
@@ -266,7 +267,7 @@ void RoutingTable6::routeChanged(IPv6Route *entry, int fieldCode)
      the Destination Cache in such a way that all entries will use the latest
      route information.*/
     if (fieldCode==IPv6Route::F_NEXTHOP || fieldCode==IPv6Route::F_IFACE)
-        purgeDestCache();
+        purgeDestCacheForRoute(entry);
 
     updateDisplayString();
 
@@ -608,6 +609,24 @@ void RoutingTable6::purgeDestCacheEntriesToNeighbour(const IPv6Address& nextHopA
     updateDisplayString();
 }
 
+void RoutingTable6::purgeDestCacheForPrefix(const IPv6Address& prefix, int prefixLength)
+{
+    // the cache is ordered by address, so the covered destinations form a contiguous range
+    DestCache::iterator it = destCache.lower_bound(prefix.getPrefix(prefixLength));
+    while (it!=destCache.end() && it->first.matches(prefix, prefixLength))
+        destCache.erase(it++);
+
+    updateDisplayString();
+}
+
+void RoutingTable6::purgeDestCacheForRoute(const IPv6Route *route)
+{
+    if (preciseCacheInvalidation)
+        purgeDestCacheForPrefix(route->getDestPrefix(), route->getPrefixLength());
+    else
+        purgeDestCache();
+}
+
 void RoutingTable6::purgeDestCacheForInterfaceID(int interfaceId)
 {
     for (DestCache::iterator it=destCache.begin(); it!=destCache.end(); )
@@ -787,7 +806,7 @@ void RoutingTable6::addRoute(IPv6Route *route)
 
     /*XXX: this deletes some cache entries we want to keep, but the node MUST update
      the Destination Cache in such a way that the latest route information are used.*/
-    purgeDestCache();
+    purgeDestCacheForRoute(route);
     updateDisplayString();
 
     nb->fireChangeNotification(NF_IPv6_ROUTE_ADDED, route);
@@ -801,13 +820,13 @@ void RoutingTable6::removeRoute(IPv6Route *route)
     nb->fireChangeNotification(NF_IPv6_ROUTE_DELETED, route); // rather: going to be deleted
 
     routeList.erase(it);
-    delete route;
 
     /*XXX: this deletes some cache entries we want to keep, but the node MUST update
      the Destination Cache in such a way that all entries using the next-hop from
      the deleted route perform next-hop determination again rather than continue
      sending traffic using that deleted route next-hop.*/
-    purgeDestCache();
+    purgeDestCacheForRoute(route);
+    delete route;
     updateDisplayString();
 }
 
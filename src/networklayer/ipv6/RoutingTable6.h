@@ -152,6 +152,7 @@ class INET_API RoutingTable6 : public cSimpleModule, protected INotifiable, publ
 
     bool isrouter;
     bool multicastForward;  //If node is forwarding multicast info
+    bool preciseCacheInvalidation;  // route changes only purge the affected destination cache entries
 
 #ifdef WITH_xMIPv6
     bool ishome_agent; //added by Zarrar Yousaf @ CNI, UniDortmund on 20.02.07
@@ -330,6 +331,20 @@ class INET_API RoutingTable6 : public cSimpleModule, protected INotifiable, publ
      */
     void purgeDestCacheForInterfaceID(int interfaceId);
 
+    /**
+     * Removes the destination cache entries whose destination is covered by
+     * the given prefix, i.e. those whose next hop may change after a route
+     * with that prefix is added, removed or modified.
+     */
+    void purgeDestCacheForPrefix(const IPv6Address& prefix, int prefixLength);
+
+    /**
+     * Purges the destination cache after the given route changed: only the
+     * entries covered by its prefix if preciseCacheInvalidation is set,
+     * otherwise all of them.
+     */
+    void purgeDestCacheForRoute(const IPv6Route *route);
+
     //@}
 
     /** @name Managing prefixes and the route table */
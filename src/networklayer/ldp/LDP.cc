@@ -1267,13 +1267,14 @@ bool LDP::lookupLabel(IPv4Datagram *ipdatagram, LabelOpVector& outLabel, std::st
         return false;
 
     // LDP traffic (both discovery...
-    if (protocol == IP_PROT_UDP && check_and_cast<UDPPacket*>(ipdatagram->getEncapsulatedPacket())->getDestinationPort() == LDP_PORT)
+    // (non-first fragments carry no transport header and are classified as regular traffic)
+    UDPPacket *udpPacket = protocol == IP_PROT_UDP ? dynamic_cast<UDPPacket*>(ipdatagram->getEncapsulatedPacket()) : NULL;
+    if (udpPacket && udpPacket->getDestinationPort() == LDP_PORT)
         return false;
 
     // ...and session)
-    if (protocol == IP_PROT_TCP && check_and_cast<TCPSegment*>(ipdatagram->getEncapsulatedPacket())->getDestPort() == LDP_PORT)
-        return false;
-    if (protocol == IP_PROT_TCP && check_and_cast<TCPSegment*>(ipdatagram->getEncapsulatedPacket())->getSrcPort() == LDP_PORT)
+    TCPSegment *tcpSegment = protocol == IP_PROT_TCP ? dynamic_cast<TCPSegment*>(ipdatagram->getEncapsulatedPacket()) : NULL;
+    if (tcpSegment && (tcpSegment->getDestPort() == LDP_PORT || tcpSegment->getSrcPort() == LDP_PORT))
         return false;
 
     // regular traffic, classify, label etc.
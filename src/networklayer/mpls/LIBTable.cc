@@ -17,6 +17,7 @@
 #include "LIBTable.h"
 #include "XMLUtils.h"
 #include "RoutingTableAccess.h"
+#include "InterfaceTableAccess.h"
 
 Define_Module(LIBTable);
 
@@ -28,7 +29,8 @@ void LIBTable::initialize(int stage)
     if (stage == 0)
     {
         maxLabel = 0;
-        WATCH_VECTOR(lib);
+        ift = InterfaceTableAccess().get();
+        WATCH_LIST(lib);
     }
     else if (stage == 4)
     {
@@ -51,23 +53,39 @@ bool LIBTable::resolveLabel(std::string inInterface, int inLabel,
 {
     bool any = (inInterface.length() == 0);
 
-    for (unsigned int i = 0; i < lib.size(); i++)
+    const LabelIndex::Bucket& bucket = labelIndex.getBucket(hashInt(inLabel));
+    for (LabelIndex::Bucket::const_iterator it = bucket.begin(); it != bucket.end(); ++it)
     {
-        if (!any && lib[i].inInterface != inInterface)
+        const LIBEntry& entry = *it->value;
+        if (!any && entry.inInterface != inInterface)
             continue;
 
-        if (lib[i].inLabel != inLabel)
+        if (entry.inLabel != inLabel)
             continue;
 
-        outLabel = lib[i].outLabel;
-        outInterface = lib[i].outInterface;
-        color = lib[i].color;
+        outLabel = entry.outLabel;
+        outInterface = entry.outInterface;
+        color = entry.color;
 
         return true;
     }
     return false;
 }
 
+const LIBTable::LIBEntry *LIBTable::findLibEntry(int inInterfaceId, int inLabel) const
+{
+    bool any = (inInterfaceId == -1);
+
+    const LabelIndex::Bucket& bucket = labelIndex.getBucket(hashInt(inLabel));
+    for (LabelIndex::Bucket::const_iterator it = bucket.begin(); it != bucket.end(); ++it)
+    {
+        const LIBEntry& entry = *it->value;
+        if (entry.inLabel == inLabel && (any || entry.inInterfaceId == inInterfaceId))
+            return &entry;
+    }
+    return NULL;
+}
+
 int LIBTable::installLibEntry(int inLabel, std::string inInterface, const LabelOpVector& outLabel,
             std::string outInterface, int color)
 {
@@ -79,20 +97,24 @@ int LIBTable::installLibEntry(int inLabel, std::string inInterface, const LabelO
         newItem.outLabel = outLabel;
         newItem.outInterface = outInterface;
         newItem.color = color;
-        lib.push_back(newItem);
+        addEntry(newItem);
         return newItem.inLabel;
     }
     else
     {
-        for (unsigned int i = 0; i < lib.size(); i++)
+        const LabelIndex::Bucket& bucket = labelIndex.getBucket(hashInt(inLabel));
+        for (LabelIndex::Bucket::const_iterator it = bucket.begin(); it != bucket.end(); ++it)
         {
-            if (lib[i].inLabel != inLabel)
+            LIBEntry& entry = *it->value;
+            if (entry.inLabel != inLabel)
                 continue;
 
-            lib[i].inInterface = inInterface;
-            lib[i].outLabel = outLabel;
-            lib[i].outInterface = outInterface;
-            lib[i].color = color;
+            entry.inInterface = inInterface;
+            entry.inInterfaceId = getInterfaceId(inInterface);
+            entry.outLabel = outLabel;
+            entry.outInterface = outInterface;
+            entry.outInterfaceId = getInterfaceId(outInterface);
+            entry.color = color;
             return inLabel;
         }
         ASSERT(false);
@@ -102,17 +124,34 @@ int LIBTable::installLibEntry(int inLabel, std::string inInterface, const LabelO
 
 void LIBTable::removeLibEntry(int inLabel)
 {
-    for (unsigned int i = 0; i < lib.size(); i++)
+    const LabelIndex::Bucket& bucket = labelIndex.getBucket(hashInt(inLabel));
+    for (LabelIndex::Bucket::const_iterator it = bucket.begin(); it != bucket.end(); ++it)
     {
-        if (lib[i].inLabel != inLabel)
+        if (it->value->inLabel != inLabel)
             continue;
 
-        lib.erase(lib.begin() + i);
+        LIBEntryList::iterator entry = it->value;
+        labelIndex.remove(it->hash, entry);
+        lib.erase(entry);
         return;
     }
     ASSERT(false);
 }
 
+int LIBTable::getInterfaceId(const std::string& interfaceName)
+{
+    InterfaceEntry *ie = interfaceName.empty() ? NULL : ift->getInterfaceByName(interfaceName.c_str());
+    return ie ? ie->getInterfaceId() : -1;
+}
+
+void LIBTable::addEntry(const LIBEntry& entry)
+{
+    LIBEntryList::iterator newEntry = lib.insert(lib.end(), entry);
+    newEntry->inInterfaceId = getInterfaceId(entry.inInterface);
+    newEntry->outInterfaceId = getInterfaceId(entry.outInterface);
+    labelIndex.insert(hashInt(newEntry->inLabel), newEntry);
+}
+
 void LIBTable::readTableFromXML(const cXMLElement* libtable)
 {
     ASSERT(libtable);
@@ -165,7 +204,7 @@ void LIBTable::readTableFromXML(const cXMLElement* libtable)
             newItem.outLabel.push_back(l);
         }
 
-        lib.push_back(newItem);
+        addEntry(newItem);
 
         ASSERT(newItem.inLabel > 0);
 
@@ -16,15 +16,19 @@
 #ifndef __INET_LIBTABLE_H
 #define __INET_LIBTABLE_H
 
+#include <list>
 #include <vector>
 #include <string>
 
 #include "INETDefs.h"
 
+#include "HashIndex.h"
 #include "ConstType.h"
 #include "IPv4Address.h"
 #include "IPv4Datagram.h"
 
+class IInterfaceTable;
+
 // label operations
 #define PUSH_OPER              0
 #define SWAP_OPER              1
@@ -51,18 +55,27 @@ class INET_API LIBTable: public cSimpleModule
         {
             int inLabel;
             std::string inInterface;
+            int inInterfaceId;      // -1 if inInterface is not in the interface table
 
             LabelOpVector outLabel;
             std::string outInterface;
+            int outInterfaceId;     // -1 if outInterface is not in the interface table
 
             // FIXME colors in nam, temporary solution
             int color;
         };
 
     protected:
+        IInterfaceTable *ift;
         IPv4Address routerId;
         int maxLabel;
-        std::vector<LIBEntry> lib;
+        typedef std::list<LIBEntry> LIBEntryList;
+        LIBEntryList lib;
+
+        // index of lib by inLabel; entries are inserted in the order of lib,
+        // so that lookups return the same entry as a linear scan of lib
+        typedef HashIndex<LIBEntryList::iterator> LabelIndex;
+        LabelIndex labelIndex;
 
     protected:
         virtual void initialize(int stage);
@@ -72,11 +85,24 @@ class INET_API LIBTable: public cSimpleModule
         // static configuration
         virtual void readTableFromXML(const cXMLElement* libtable);
 
+        // maintenance of lib and labelIndex
+        virtual int getInterfaceId(const std::string& interfaceName);
+        virtual void addEntry(const LIBEntry& entry);
+
     public:
         // label management
         virtual bool resolveLabel(std::string inInterface, int inLabel,
                           LabelOpVector& outLabel, std::string& outInterface, int& color);
 
+        /**
+         * Returns the entry that resolveLabel() would use for the given incoming
+         * interface id (-1 for any interface) and label, or NULL if there is none.
+         * The entry is owned by the table and is valid until the next change of
+         * the table; per-packet lookups use this instead of copying the label
+         * operations.
+         */
+        virtual const LIBEntry *findLibEntry(int inInterfaceId, int inLabel) const;
+
         virtual int installLibEntry(int inLabel, std::string inInterface, const LabelOpVector& outLabel,
                             std::string outInterface, int color);
 
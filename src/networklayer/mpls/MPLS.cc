@@ -81,8 +81,9 @@ void MPLS::processPacketFromL3(cMessage * msg)
     // XXX temporary solution, until TCPSocket and IPv4 are extended to support nam tracing
     if (ipdatagram->getTransportProtocol() == IP_PROT_TCP)
     {
-        TCPSegment *seg = check_and_cast<TCPSegment*>(ipdatagram->getEncapsulatedPacket());
-        if (seg->getDestPort() == LDP_PORT || seg->getSrcPort() == LDP_PORT)
+        // non-first fragments carry no segment
+        TCPSegment *seg = dynamic_cast<TCPSegment*>(ipdatagram->getEncapsulatedPacket());
+        if (seg && (seg->getDestPort() == LDP_PORT || seg->getSrcPort() == LDP_PORT))
         {
             ASSERT(!ipdatagram->hasPar("color"));
             ipdatagram->addPar("color") = LDP_TRAFFIC;
@@ -214,11 +215,10 @@ void MPLS::processMPLSPacketFromL2(MPLSPacket *mplsPacket)
 {
     int gateIndex = mplsPacket->getArrivalGate()->getIndex();
     InterfaceEntry *ie = ift->getInterfaceByNetworkLayerGateIndex(gateIndex);
-    std::string senderInterface = ie->getName();
     ASSERT(mplsPacket->hasLabel());
     int oldLabel = mplsPacket->getTopLabel();
 
-    EV << "Received " << mplsPacket << " from L2, label=" << oldLabel << " inInterface=" << senderInterface << endl;
+    EV << "Received " << mplsPacket << " from L2, label=" << oldLabel << " inInterface=" << ie->getName() << endl;
 
     if (oldLabel==-1)
     {
@@ -232,12 +232,9 @@ void MPLS::processMPLSPacketFromL2(MPLSPacket *mplsPacket)
         return;
     }
 
-    LabelOpVector outLabel;
-    std::string outInterface;
-    int color;
-
-    bool found = lt->resolveLabel(senderInterface, oldLabel, outLabel, outInterface, color);
-    if (!found)
+    // look up by interface id and use the entry in place: no string compares or copies per packet
+    const LIBTable::LIBEntry *libEntry = lt->findLibEntry(ie->getInterfaceId(), oldLabel);
+    if (!libEntry)
     {
         EV << "discarding packet, incoming label not resolved" << endl;
 
@@ -245,9 +242,12 @@ void MPLS::processMPLSPacketFromL2(MPLSPacket *mplsPacket)
         return;
     }
 
-    int outgoingPort = ift->getInterfaceByName(outInterface.c_str())->getNetworkLayerGateIndex();
+    const std::string& outInterface = libEntry->outInterface;
+    int color = libEntry->color;
+    InterfaceEntry *outIe = ift->getInterfaceById(libEntry->outInterfaceId);
+    int outgoingPort = outIe ? outIe->getNetworkLayerGateIndex() : -1;
 
-    doStackOps(mplsPacket, outLabel);
+    doStackOps(mplsPacket, libEntry->outLabel);
 
     if (mplsPacket->hasLabel())
     {
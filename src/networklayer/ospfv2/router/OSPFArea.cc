@@ -18,6 +18,8 @@
 #include "OSPFArea.h"
 #include "OSPFRouter.h"
 #include <memory.h>
+#include <functional>
+#include <queue>
 
 OSPF::Area::Area(OSPF::AreaID id) :
     areaID(id),
@@ -1346,13 +1348,349 @@ OSPF::SummaryLSA* OSPF::Area::originateSummaryLSA(const OSPF::SummaryLSA* summar
     return NULL;
 }
 
+void OSPF::Area::NetworkRouteIndex::add(const OSPF::RoutingTableEntry* entry, unsigned long position)
+{
+    uint32 netmask = entry->getNetmask().getInt();
+    entriesByNetmask[netmask][entry->getDestination().getInt() & netmask].insert(position);
+}
+
+void OSPF::Area::NetworkRouteIndex::remove(const OSPF::RoutingTableEntry* entry, unsigned long position)
+{
+    uint32 netmask = entry->getNetmask().getInt();
+    std::map<uint32, PositionsByAddress>::iterator maskIt = entriesByNetmask.find(netmask);
+    if (maskIt == entriesByNetmask.end()) {
+        return;
+    }
+    PositionsByAddress::iterator addressIt = maskIt->second.find(entry->getDestination().getInt() & netmask);
+    if (addressIt == maskIt->second.end()) {
+        return;
+    }
+    addressIt->second.erase(position);
+    if (addressIt->second.empty()) {
+        maskIt->second.erase(addressIt);
+        if (maskIt->second.empty()) {
+            entriesByNetmask.erase(maskIt);
+        }
+    }
+}
+
+/**
+ * Returns the position of the entry a linear search for the longest match would
+ * find: the entry covering the destination with the largest masked destination
+ * address (a zero masked address never matches), the first one on a tie.
+ * Returns -1 if there is no such entry.
+ */
+long OSPF::Area::NetworkRouteIndex::findLongestMatch(uint32 destination) const
+{
+    uint32 longestMatch = 0;
+    long position = -1;
+
+    for (std::map<uint32, PositionsByAddress>::const_iterator maskIt = entriesByNetmask.begin(); maskIt != entriesByNetmask.end(); maskIt++) {
+        uint32 maskedDestination = destination & maskIt->first;
+        if (maskedDestination == 0 || maskedDestination < longestMatch) {
+            continue;
+        }
+        PositionsByAddress::const_iterator addressIt = maskIt->second.find(maskedDestination);
+        if (addressIt == maskIt->second.end()) {
+            continue;
+        }
+        long firstPosition = *(addressIt->second.begin());
+        if ((maskedDestination > longestMatch) || (firstPosition < position)) {
+            longestMatch = maskedDestination;
+            position = firstPosition;
+        }
+    }
+    return position;
+}
+
+/**
+ * Collects everything the shortest path tree calculation depends on: the
+ * router and network LSAs without the stub links that do not lead to a
+ * network vertex, and the state of the interfaces of the area. If these are
+ * unchanged since the last calculation, the tree will be the same as well.
+ */
+void OSPF::Area::collectShortestPathTreeInputs(std::vector<unsigned long>& inputs)
+{
+    unsigned long i, j;
+
+    inputs.push_back(parentRouter->getRouterID().getInt());
+    inputs.push_back(spfTreeRoot->getHeader().getLinkStateID().getInt());
+
+    unsigned long interfaceNum = associatedInterfaces.size();
+    for (i = 0; i < interfaceNum; i++) {
+        OSPF::Interface* intf = associatedInterfaces[i];
+        inputs.push_back(intf->getType());
+        inputs.push_back(intf->getState());
+        inputs.push_back(intf->getIfIndex());
+        inputs.push_back(intf->getDesignatedRouter().ipInterfaceAddress.getInt());
+        unsigned long neighborCount = intf->getNeighborCount();
+        inputs.push_back(neighborCount);
+        for (j = 0; j < neighborCount; j++) {
+            inputs.push_back(intf->getNeighbor(j)->getNeighborID().getInt());
+            inputs.push_back(intf->getNeighbor(j)->getAddress().getInt());
+        }
+    }
+
+    std::set<uint32> networkAddresses;
+    unsigned long lsaCount = networkLSAs.size();
+    for (i = 0; i < lsaCount; i++) {
+        OSPF::NetworkLSA* networkLSA = networkLSAs[i];
+        IPv4Address linkStateID = networkLSA->getHeader().getLinkStateID();
+        networkAddresses.insert((linkStateID & networkLSA->getNetworkMask()).getInt());
+        inputs.push_back(linkStateID.getInt());
+        inputs.push_back(networkLSA->getHeader().getAdvertisingRouter().getInt());
+        inputs.push_back(networkLSA->getHeader().getLsAge() == MAX_AGE);
+        inputs.push_back(networkLSA->getNetworkMask().getInt());
+        unsigned int routerCount = networkLSA->getAttachedRoutersArraySize();
+        inputs.push_back(routerCount);
+        for (j = 0; j < routerCount; j++) {
+            inputs.push_back(networkLSA->getAttachedRouters(j).getInt());
+        }
+    }
+
+    lsaCount = routerLSAs.size();
+    for (i = 0; i < lsaCount; i++) {
+        OSPF::RouterLSA* routerLSA = routerLSAs[i];
+        inputs.push_back(routerLSA->getHeader().getLinkStateID().getInt());
+        inputs.push_back(routerLSA->getHeader().getAdvertisingRouter().getInt());
+        inputs.push_back(routerLSA->getHeader().getLsAge() == MAX_AGE);
+        unsigned int linkCount = routerLSA->getLinksArraySize();
+        for (j = 0; j < linkCount; j++) {
+            Link& link = routerLSA->getLinks(j);
+            if ((link.getType() == STUB_LINK) &&
+                (networkAddresses.find(link.getLinkID().getInt() & link.getLinkData()) == networkAddresses.end()))
+            {
+                continue;
+            }
+            inputs.push_back(link.getType());
+            inputs.push_back(link.getLinkID().getInt());
+            inputs.push_back(link.getLinkData());
+            inputs.push_back(link.getLinkCost());
+        }
+        inputs.push_back(LS_INFINITY + 1);  // end of links
+    }
+}
+
+void OSPF::Area::saveShortestPathTree(const std::vector<OSPFLSA*>& treeVertices)
+{
+    std::map<OSPFLSA*, long> treeIndex;
+    unsigned long treeSize = treeVertices.size();
+
+    spfTree.clear();
+    for (unsigned long i = 0; i < treeSize; i++) {
+        OSPFLSA* vertex = treeVertices[i];
+        OSPF::RoutingInfo* routingInfo = check_and_cast<OSPF::RoutingInfo*> (vertex);
+        SPFTreeVertex treeVertex;
+
+        treeVertex.type = static_cast<LSAType> (vertex->getHeader().getLsType());
+        treeVertex.linkStateID = vertex->getHeader().getLinkStateID();
+        treeVertex.distance = routingInfo->getDistance();
+        for (unsigned int j = 0; j < routingInfo->getNextHopCount(); j++) {
+            treeVertex.nextHops.push_back(routingInfo->getNextHop(j));
+        }
+        treeVertex.parentIndex = (i == 0) ? -1 : treeIndex[routingInfo->getParent()];
+
+        treeIndex[vertex] = i;
+        spfTree.push_back(treeVertex);
+    }
+}
+
+/**
+ * Sets up the distance, next hops and parent of the vertices of the saved
+ * tree, as the calculation would. Returns false if a vertex is not found.
+ */
+bool OSPF::Area::restoreShortestPathTree(std::vector<OSPFLSA*>& treeVertices)
+{
+    unsigned long treeSize = spfTree.size();
+
+    for (unsigned long i = 0; i < treeSize; i++) {
+        const SPFTreeVertex& treeVertex = spfTree[i];
+        OSPFLSA* vertex;
+
+        if (treeVertex.type == ROUTERLSA_TYPE) {
+            vertex = findRouterLSA(treeVertex.linkStateID);
+        } else {
+            vertex = findNetworkLSA(treeVertex.linkStateID);
+        }
+        if ((vertex == NULL) || ((i == 0) && (vertex != spfTreeRoot))) {
+            treeVertices.clear();
+            return false;
+        }
+        treeVertices.push_back(vertex);
+    }
+
+    for (unsigned long i = 0; i < treeSize; i++) {
+        const SPFTreeVertex& treeVertex = spfTree[i];
+        OSPF::RoutingInfo* routingInfo = check_and_cast<OSPF::RoutingInfo*> (treeVertices[i]);
+
+        routingInfo->setDistance(treeVertex.distance);
+        unsigned long nextHopCount = treeVertex.nextHops.size();
+        for (unsigned long j = 0; j < nextHopCount; j++) {
+            routingInfo->addNextHop(treeVertex.nextHops[j]);
+        }
+        if (treeVertex.parentIndex >= 0) {
+            routingInfo->setParent(treeVertices[treeVertex.parentIndex]);
+        }
+    }
+    return true;
+}
+
+/**
+ * Adds the routing table entries for a vertex just added to the shortest path tree.
+ * @param vertex         [in] The vertex added to the tree.
+ * @param previousVertex [in] The vertex added to the tree before it.
+ */
+void OSPF::Area::addShortestPathTreeVertexRoutes(OSPFLSA* vertex, OSPFLSA* previousVertex,
+                                                 std::vector<OSPF::RoutingTableEntry*>& newRoutingTable,
+                                                 NetworkRouteIndex& routeIndex)
+{
+    unsigned long i;
+
+    if (vertex->getHeader().getLsType() == ROUTERLSA_TYPE) {
+        OSPF::RouterLSA* routerLSA = check_and_cast<OSPF::RouterLSA*> (vertex);
+        if (routerLSA->getB_AreaBorderRouter() || routerLSA->getE_ASBoundaryRouter()) {
+            OSPF::RoutingTableEntry* entry = new OSPF::RoutingTableEntry;
+            OSPF::RouterID destinationID = routerLSA->getHeader().getLinkStateID();
+            unsigned int nextHopCount = routerLSA->getNextHopCount();
+            OSPF::RoutingTableEntry::RoutingDestinationType destinationType = OSPF::RoutingTableEntry::NETWORK_DESTINATION;
+
+            entry->setDestination(destinationID);
+            entry->setLinkStateOrigin(routerLSA);
+            entry->setArea(areaID);
+            entry->setPathType(OSPF::RoutingTableEntry::INTRAAREA);
+            entry->setCost(routerLSA->getDistance());
+            if (routerLSA->getB_AreaBorderRouter()) {
+                destinationType |= OSPF::RoutingTableEntry::AREA_BORDER_ROUTER_DESTINATION;
+            }
+            if (routerLSA->getE_ASBoundaryRouter()) {
+                destinationType |= OSPF::RoutingTableEntry::AS_BOUNDARY_ROUTER_DESTINATION;
+            }
+            entry->setDestinationType(destinationType);
+            entry->setOptionalCapabilities(routerLSA->getHeader().getLsOptions());
+            for (i = 0; i < nextHopCount; i++) {
+                entry->addNextHop(routerLSA->getNextHop(i));
+            }
+
+            newRoutingTable.push_back(entry);
+
+            OSPF::Area* backbone;
+            if (areaID != OSPF::BACKBONE_AREAID) {
+                backbone = parentRouter->getAreaByID(OSPF::BACKBONE_AREAID);
+            } else {
+                backbone = this;
+            }
+            if (backbone != NULL) {
+                OSPF::Interface* virtualIntf = backbone->findVirtualLink(destinationID);
+                if ((virtualIntf != NULL) && (virtualIntf->getTransitAreaID() == areaID)) {
+                    OSPF::IPv4AddressRange range;
+                    range.address = getInterface(routerLSA->getNextHop(0).ifIndex)->getAddressRange().address;
+                    range.mask = IPv4Address::ALLONES_ADDRESS;
+                    virtualIntf->setAddressRange(range);
+                    virtualIntf->setIfIndex(routerLSA->getNextHop(0).ifIndex);
+                    virtualIntf->setOutputCost(routerLSA->getDistance());
+                    OSPF::Neighbor* virtualNeighbor = virtualIntf->getNeighbor(0);
+                    if (virtualNeighbor != NULL) {
+                        unsigned int linkCount = routerLSA->getLinksArraySize();
+                        OSPF::RouterLSA* toRouterLSA = dynamic_cast<OSPF::RouterLSA*> (previousVertex);
+                        if (toRouterLSA != NULL) {
+                            for (i = 0; i < linkCount; i++) {
+                                Link& link = routerLSA->getLinks(i);
+
+                                if ((link.getType() == POINTTOPOINT_LINK) &&
+                                    (link.getLinkID() == toRouterLSA->getHeader().getLinkStateID()) &&
+                                    (virtualIntf->getState() < OSPF::Interface::WAITING_STATE))
+                                {
+                                    virtualNeighbor->setAddress(IPv4Address(link.getLinkData()));
+                                    virtualIntf->processEvent(OSPF::Interface::INTERFACE_UP);
+                                    break;
+                                }
+                            }
+                        } else {
+                            OSPF::NetworkLSA* toNetworkLSA = dynamic_cast<OSPF::NetworkLSA*> (previousVertex);
+                            if (toNetworkLSA != NULL) {
+                                for (i = 0; i < linkCount; i++) {
+                                    Link& link = routerLSA->getLinks(i);
+
+                                    if ((link.getType() == TRANSIT_LINK) &&
+                                        (link.getLinkID() == toNetworkLSA->getHeader().getLinkStateID()) &&
+                                        (virtualIntf->getState() < OSPF::Interface::WAITING_STATE))
+                                    {
+                                        virtualNeighbor->setAddress(IPv4Address(link.getLinkData()));
+                                        virtualIntf->processEvent(OSPF::Interface::INTERFACE_UP);
+                                        break;
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if (vertex->getHeader().getLsType() == NETWORKLSA_TYPE) {
+        OSPF::NetworkLSA* networkLSA = check_and_cast<OSPF::NetworkLSA*> (vertex);
+        IPv4Address destinationID = (networkLSA->getHeader().getLinkStateID() & networkLSA->getNetworkMask());
+        unsigned int nextHopCount = networkLSA->getNextHopCount();
+        bool overWrite = false;
+        OSPF::RoutingTableEntry* entry = NULL;
+        long position = routeIndex.findLongestMatch(destinationID.getInt());
+
+        if (position >= 0) {
+            entry = newRoutingTable[position];
+            const OSPFLSA* entryOrigin = entry->getLinkStateOrigin();
+            if ((entry->getCost() != networkLSA->getDistance()) ||
+                (entryOrigin->getHeader().getLinkStateID() >= networkLSA->getHeader().getLinkStateID()))
+            {
+                overWrite = true;
+            }
+        }
+
+        if ((entry == NULL) || (overWrite)) {
+            if (entry == NULL) {
+                entry = new OSPF::RoutingTableEntry;
+            } else {
+                routeIndex.remove(entry, position);
+            }
+
+            entry->setDestination(IPv4Address(destinationID));
+            entry->setNetmask(networkLSA->getNetworkMask());
+            entry->setLinkStateOrigin(networkLSA);
+            entry->setArea(areaID);
+            entry->setPathType(OSPF::RoutingTableEntry::INTRAAREA);
+            entry->setCost(networkLSA->getDistance());
+            entry->setDestinationType(OSPF::RoutingTableEntry::NETWORK_DESTINATION);
+            entry->setOptionalCapabilities(networkLSA->getHeader().getLsOptions());
+            for (i = 0; i < nextHopCount; i++) {
+                entry->addNextHop(networkLSA->getNextHop(i));
+            }
+
+            if (!overWrite) {
+                position = newRoutingTable.size();
+                newRoutingTable.push_back(entry);
+            }
+            routeIndex.add(entry, position);
+        }
+    }
+}
+
+/**
+ * Calculates the shortest path tree of the area (RFC2328 16.1), and adds the
+ * resulting intra-area routes to the routing table.
+ *
+ * The candidate list is a binary heap. Only the stub links of the router LSAs
+ * are examined when nothing else changed since the last calculation: the tree
+ * saved then is set up again instead of running the calculation.
+ */
 void OSPF::Area::calculateShortestPathTree(std::vector<OSPF::RoutingTableEntry*>& newRoutingTable)
 {
     OSPF::RouterID routerID = parentRouter->getRouterID();
-    bool finished = false;
     std::vector<OSPFLSA*> treeVertices;
     OSPFLSA* justAddedVertex;
-    std::vector<OSPFLSA*> candidateVertices;
+    std::priority_queue<SPFCandidate, std::vector<SPFCandidate>, std::greater<SPFCandidate> > candidateVertices;
+    std::map<OSPFLSA*, unsigned long> vertexStates;    // 0 for the vertices on the tree, the candidate sequence number for the others
+    unsigned long candidateSequence = 0;
+    NetworkRouteIndex routeIndex;
     unsigned long            i, j, k;
     unsigned long lsaCount;
 
@@ -1379,358 +1717,197 @@ void OSPF::Area::calculateShortestPathTree(std::vector<OSPF::RoutingTableEntry*>
     for (i = 0; i < lsaCount; i++) {
         networkLSAs[i]->clearNextHops();
     }
-    spfTreeRoot->setDistance(0);
-    treeVertices.push_back(spfTreeRoot);
-    justAddedVertex = spfTreeRoot;          // (1)
 
-    do {
-        LSAType vertexType = static_cast<LSAType> (justAddedVertex->getHeader().getLsType());
+    unsigned long routeCount = newRoutingTable.size();
+    for (i = 0; i < routeCount; i++) {
+        if (newRoutingTable[i]->getDestinationType() == OSPF::RoutingTableEntry::NETWORK_DESTINATION) {
+            routeIndex.add(newRoutingTable[i], i);
+        }
+    }
 
-        if ((vertexType == ROUTERLSA_TYPE)) {
-            OSPF::RouterLSA* routerVertex = check_and_cast<OSPF::RouterLSA*> (justAddedVertex);
-            if (routerVertex->getV_VirtualLinkEndpoint()) {    // (2)
+    // virtual links are brought up while the tree is built, so the tree is not reused when there are any
+    OSPF::Area* backbone = parentRouter->getAreaByID(OSPF::BACKBONE_AREAID);
+    std::vector<unsigned long> treeInputs;
+    collectShortestPathTreeInputs(treeInputs);
+    bool reuseTree = !spfTree.empty() && (treeInputs == spfTreeInputs) &&
+                     ((backbone == NULL) || !backbone->hasVirtualLink(areaID)) &&
+                     restoreShortestPathTree(treeVertices);
+
+    if (reuseTree) {
+        unsigned long treeSize = treeVertices.size();
+        for (i = 0; i < treeSize; i++) {
+            OSPF::RouterLSA* routerVertex = dynamic_cast<OSPF::RouterLSA*> (treeVertices[i]);
+            if ((routerVertex != NULL) && routerVertex->getV_VirtualLinkEndpoint()) {
                 transitCapability = true;
             }
-
-            unsigned int linkCount = routerVertex->getLinksArraySize();
-            for (i = 0; i < linkCount; i++) {
-                Link& link = routerVertex->getLinks(i);
-                LinkType linkType = static_cast<LinkType> (link.getType());
-                OSPFLSA* joiningVertex;
-                LSAType joiningVertexType;
-
-                if (linkType == STUB_LINK) {     // (2) (a)
-                    continue;
-                }
-
-                if (linkType == TRANSIT_LINK) {
-                    joiningVertex = findNetworkLSA(link.getLinkID());
-                    joiningVertexType = NETWORKLSA_TYPE;
-                } else {
-                    joiningVertex = findRouterLSA(link.getLinkID());
-                    joiningVertexType = ROUTERLSA_TYPE;
-                }
-
-                if ((joiningVertex == NULL) ||
-                    (joiningVertex->getHeader().getLsAge() == MAX_AGE) ||
-                    (!hasLink(joiningVertex, justAddedVertex)))  // (from, to)     (2) (b)
-                {
-                    continue;
+            if (i > 0) {
+                addShortestPathTreeVertexRoutes(treeVertices[i], treeVertices[i - 1], newRoutingTable, routeIndex);
+            }
+        }
+    } else {
+        spfTreeRoot->setDistance(0);
+        treeVertices.push_back(spfTreeRoot);
+        vertexStates[spfTreeRoot] = 0;
+        justAddedVertex = spfTreeRoot;          // (1)
+
+        while (true) {
+            LSAType vertexType = static_cast<LSAType> (justAddedVertex->getHeader().getLsType());
+
+            if ((vertexType == ROUTERLSA_TYPE)) {
+                OSPF::RouterLSA* routerVertex = check_and_cast<OSPF::RouterLSA*> (justAddedVertex);
+                if (routerVertex->getV_VirtualLinkEndpoint()) {    // (2)
+                    transitCapability = true;
                 }
 
-                unsigned int treeSize = treeVertices.size();
-                bool alreadyOnTree = false;
+                unsigned int linkCount = routerVertex->getLinksArraySize();
+                for (i = 0; i < linkCount; i++) {
+                    Link& link = routerVertex->getLinks(i);
+                    LinkType linkType = static_cast<LinkType> (link.getType());
+                    OSPFLSA* joiningVertex;
+                    LSAType joiningVertexType;
 
-                for (j = 0; j < treeSize; j++) {
-                    if (treeVertices[j] == joiningVertex) {
-                        alreadyOnTree = true;
-                        break;
+                    if (linkType == STUB_LINK) {     // (2) (a)
+                        continue;
                     }
-                }
-                if (alreadyOnTree) {    // (2) (c)
-                    continue;
-                }
-
-                unsigned long linkStateCost = routerVertex->getDistance() + link.getLinkCost();
-                unsigned int candidateCount = candidateVertices.size();
-                OSPFLSA* candidate = NULL;
 
-                for (j = 0; j < candidateCount; j++) {
-                    if (candidateVertices[j] == joiningVertex) {
-                        candidate = candidateVertices[j];
+                    if (linkType == TRANSIT_LINK) {
+                        joiningVertex = findNetworkLSA(link.getLinkID());
+                        joiningVertexType = NETWORKLSA_TYPE;
+                    } else {
+                        joiningVertex = findRouterLSA(link.getLinkID());
+                        joiningVertexType = ROUTERLSA_TYPE;
                     }
-                }
-                if (candidate != NULL) {    // (2) (d)
-                    OSPF::RoutingInfo* routingInfo = check_and_cast<OSPF::RoutingInfo*> (candidate);
-                    unsigned long candidateDistance = routingInfo->getDistance();
 
-                    if (linkStateCost > candidateDistance) {
+                    if ((joiningVertex == NULL) ||
+                        (joiningVertex->getHeader().getLsAge() == MAX_AGE) ||
+                        (!hasLink(joiningVertex, justAddedVertex)))  // (from, to)     (2) (b)
+                    {
                         continue;
                     }
-                    if (linkStateCost < candidateDistance) {
-                        routingInfo->setDistance(linkStateCost);
-                        routingInfo->clearNextHops();
-                    }
-                    std::vector<OSPF::NextHop>* newNextHops = calculateNextHops(joiningVertex, justAddedVertex); // (destination, parent)
-                    unsigned int nextHopCount = newNextHops->size();
-                    for (k = 0; k < nextHopCount; k++) {
-                        routingInfo->addNextHop((*newNextHops)[k]);
+
+                    std::map<OSPFLSA*, unsigned long>::iterator stateIt = vertexStates.find(joiningVertex);
+                    if ((stateIt != vertexStates.end()) && (stateIt->second == 0)) {    // (2) (c)
+                        continue;
                     }
-                    delete newNextHops;
-                } else {
-                    if (joiningVertexType == ROUTERLSA_TYPE) {
-                        OSPF::RouterLSA* joiningRouterVertex = check_and_cast<OSPF::RouterLSA*> (joiningVertex);
-                        joiningRouterVertex->setDistance(linkStateCost);
+
+                    unsigned long linkStateCost = routerVertex->getDistance() + link.getLinkCost();
+
+                    if (stateIt != vertexStates.end()) {    // (2) (d)
+                        OSPF::RoutingInfo* routingInfo = check_and_cast<OSPF::RoutingInfo*> (joiningVertex);
+                        unsigned long candidateDistance = routingInfo->getDistance();
+
+                        if (linkStateCost > candidateDistance) {
+                            continue;
+                        }
+                        if (linkStateCost < candidateDistance) {
+                            routingInfo->setDistance(linkStateCost);
+                            routingInfo->clearNextHops();
+                            SPFCandidate candidate = { linkStateCost, (joiningVertexType == NETWORKLSA_TYPE) ? 0 : 1, stateIt->second, joiningVertex };
+                            candidateVertices.push(candidate);
+                        }
                         std::vector<OSPF::NextHop>* newNextHops = calculateNextHops(joiningVertex, justAddedVertex); // (destination, parent)
                         unsigned int nextHopCount = newNextHops->size();
                         for (k = 0; k < nextHopCount; k++) {
-                            joiningRouterVertex->addNextHop((*newNextHops)[k]);
+                            routingInfo->addNextHop((*newNextHops)[k]);
                         }
                         delete newNextHops;
-                        OSPF::RoutingInfo* vertexRoutingInfo = check_and_cast<OSPF::RoutingInfo*> (joiningRouterVertex);
-                        vertexRoutingInfo->setParent(justAddedVertex);
-
-                        candidateVertices.push_back(joiningRouterVertex);
                     } else {
-                        OSPF::NetworkLSA* joiningNetworkVertex = check_and_cast<OSPF::NetworkLSA*> (joiningVertex);
-                        joiningNetworkVertex->setDistance(linkStateCost);
+                        OSPF::RoutingInfo* vertexRoutingInfo = check_and_cast<OSPF::RoutingInfo*> (joiningVertex);
+                        vertexRoutingInfo->setDistance(linkStateCost);
                         std::vector<OSPF::NextHop>* newNextHops = calculateNextHops(joiningVertex, justAddedVertex); // (destination, parent)
                         unsigned int nextHopCount = newNextHops->size();
                         for (k = 0; k < nextHopCount; k++) {
-                            joiningNetworkVertex->addNextHop((*newNextHops)[k]);
+                            vertexRoutingInfo->addNextHop((*newNextHops)[k]);
                         }
                         delete newNextHops;
-                        OSPF::RoutingInfo* vertexRoutingInfo = check_and_cast<OSPF::RoutingInfo*> (joiningNetworkVertex);
                         vertexRoutingInfo->setParent(justAddedVertex);
 
-                        candidateVertices.push_back(joiningNetworkVertex);
+                        vertexStates[joiningVertex] = ++candidateSequence;
+                        SPFCandidate candidate = { linkStateCost, (joiningVertexType == NETWORKLSA_TYPE) ? 0 : 1, candidateSequence, joiningVertex };
+                        candidateVertices.push(candidate);
                     }
                 }
             }
-        }
-
-        if ((vertexType == NETWORKLSA_TYPE)) {
-            OSPF::NetworkLSA* networkVertex = check_and_cast<OSPF::NetworkLSA*> (justAddedVertex);
-            unsigned int routerCount = networkVertex->getAttachedRoutersArraySize();
-
-            for (i = 0; i < routerCount; i++) {     // (2)
-                OSPF::RouterLSA* joiningVertex = findRouterLSA(networkVertex->getAttachedRouters(i));
-                if ((joiningVertex == NULL) ||
-                    (joiningVertex->getHeader().getLsAge() == MAX_AGE) ||
-                    (!hasLink(joiningVertex, justAddedVertex)))  // (from, to)     (2) (b)
-                {
-                    continue;
-                }
-
-                unsigned int treeSize = treeVertices.size();
-                bool alreadyOnTree = false;
-
-                for (j = 0; j < treeSize; j++) {
-                    if (treeVertices[j] == joiningVertex) {
-                        alreadyOnTree = true;
-                        break;
-                    }
-                }
-                if (alreadyOnTree) {    // (2) (c)
-                    continue;
-                }
 
-                unsigned long linkStateCost = networkVertex->getDistance();   // link cost from network to router is always 0
-                unsigned int candidateCount = candidateVertices.size();
-                OSPFLSA* candidate = NULL;
+            if ((vertexType == NETWORKLSA_TYPE)) {
+                OSPF::NetworkLSA* networkVertex = check_and_cast<OSPF::NetworkLSA*> (justAddedVertex);
+                unsigned int routerCount = networkVertex->getAttachedRoutersArraySize();
 
-                for (j = 0; j < candidateCount; j++) {
-                    if (candidateVertices[j] == joiningVertex) {
-                        candidate = candidateVertices[j];
+                for (i = 0; i < routerCount; i++) {     // (2)
+                    OSPF::RouterLSA* joiningVertex = findRouterLSA(networkVertex->getAttachedRouters(i));
+                    if ((joiningVertex == NULL) ||
+                        (joiningVertex->getHeader().getLsAge() == MAX_AGE) ||
+                        (!hasLink(joiningVertex, justAddedVertex)))  // (from, to)     (2) (b)
+                    {
+                        continue;
                     }
-                }
-                if (candidate != NULL) {    // (2) (d)
-                    OSPF::RoutingInfo* routingInfo = check_and_cast<OSPF::RoutingInfo*> (candidate);
-                    unsigned long candidateDistance = routingInfo->getDistance();
 
-                    if (linkStateCost > candidateDistance) {
+                    std::map<OSPFLSA*, unsigned long>::iterator stateIt = vertexStates.find(joiningVertex);
+                    if ((stateIt != vertexStates.end()) && (stateIt->second == 0)) {    // (2) (c)
                         continue;
                     }
-                    if (linkStateCost < candidateDistance) {
-                        routingInfo->setDistance(linkStateCost);
-                        routingInfo->clearNextHops();
-                    }
-                    std::vector<OSPF::NextHop>* newNextHops = calculateNextHops(joiningVertex, justAddedVertex); // (destination, parent)
-                    unsigned int nextHopCount = newNextHops->size();
-                    for (k = 0; k < nextHopCount; k++) {
-                        routingInfo->addNextHop((*newNextHops)[k]);
-                    }
-                    delete newNextHops;
-                } else {
-                    joiningVertex->setDistance(linkStateCost);
-                    std::vector<OSPF::NextHop>* newNextHops = calculateNextHops(joiningVertex, justAddedVertex); // (destination, parent)
-                    unsigned int nextHopCount = newNextHops->size();
-                    for (k = 0; k < nextHopCount; k++) {
-                        joiningVertex->addNextHop((*newNextHops)[k]);
-                    }
-                    delete newNextHops;
-                    OSPF::RoutingInfo* vertexRoutingInfo = check_and_cast<OSPF::RoutingInfo*> (joiningVertex);
-                    vertexRoutingInfo->setParent(justAddedVertex);
-
-                    candidateVertices.push_back(joiningVertex);
-                }
-            }
-        }
 
-        if (candidateVertices.empty()) {  // (3)
-            finished = true;
-        } else {
-            unsigned int candidateCount = candidateVertices.size();
-            unsigned long minDistance = LS_INFINITY;
-            OSPFLSA* closestVertex = candidateVertices[0];
+                    unsigned long linkStateCost = networkVertex->getDistance();   // link cost from network to router is always 0
 
-            for (i = 0; i < candidateCount; i++) {
-                OSPF::RoutingInfo* routingInfo = check_and_cast<OSPF::RoutingInfo*> (candidateVertices[i]);
-                unsigned long currentDistance = routingInfo->getDistance();
+                    if (stateIt != vertexStates.end()) {    // (2) (d)
+                        unsigned long candidateDistance = joiningVertex->getDistance();
 
-                if (currentDistance < minDistance) {
-                    closestVertex = candidateVertices[i];
-                    minDistance = currentDistance;
-                } else {
-                    if (currentDistance == minDistance) {
-                        if ((closestVertex->getHeader().getLsType() == ROUTERLSA_TYPE) &&
-                            (candidateVertices[i]->getHeader().getLsType() == NETWORKLSA_TYPE))
-                        {
-                            closestVertex = candidateVertices[i];
+                        if (linkStateCost > candidateDistance) {
+                            continue;
                         }
-                    }
-                }
-            }
-
-            treeVertices.push_back(closestVertex);
-
-            for (std::vector<OSPFLSA*>::iterator it = candidateVertices.begin(); it != candidateVertices.end(); it++) {
-                if ((*it) == closestVertex) {
-                    candidateVertices.erase(it);
-                    break;
-                }
-            }
-
-            if (closestVertex->getHeader().getLsType() == ROUTERLSA_TYPE) {
-                OSPF::RouterLSA* routerLSA = check_and_cast<OSPF::RouterLSA*> (closestVertex);
-                if (routerLSA->getB_AreaBorderRouter() || routerLSA->getE_ASBoundaryRouter()) {
-                    OSPF::RoutingTableEntry* entry = new OSPF::RoutingTableEntry;
-                    OSPF::RouterID destinationID = routerLSA->getHeader().getLinkStateID();
-                    unsigned int nextHopCount = routerLSA->getNextHopCount();
-                    OSPF::RoutingTableEntry::RoutingDestinationType destinationType = OSPF::RoutingTableEntry::NETWORK_DESTINATION;
-
-                    entry->setDestination(destinationID);
-                    entry->setLinkStateOrigin(routerLSA);
-                    entry->setArea(areaID);
-                    entry->setPathType(OSPF::RoutingTableEntry::INTRAAREA);
-                    entry->setCost(routerLSA->getDistance());
-                    if (routerLSA->getB_AreaBorderRouter()) {
-                        destinationType |= OSPF::RoutingTableEntry::AREA_BORDER_ROUTER_DESTINATION;
-                    }
-                    if (routerLSA->getE_ASBoundaryRouter()) {
-                        destinationType |= OSPF::RoutingTableEntry::AS_BOUNDARY_ROUTER_DESTINATION;
-                    }
-                    entry->setDestinationType(destinationType);
-                    entry->setOptionalCapabilities(routerLSA->getHeader().getLsOptions());
-                    for (i = 0; i < nextHopCount; i++) {
-                        entry->addNextHop(routerLSA->getNextHop(i));
-                    }
-
-                    newRoutingTable.push_back(entry);
-
-                    OSPF::Area* backbone;
-                    if (areaID != OSPF::BACKBONE_AREAID) {
-                        backbone = parentRouter->getAreaByID(OSPF::BACKBONE_AREAID);
+                        if (linkStateCost < candidateDistance) {
+                            joiningVertex->setDistance(linkStateCost);
+                            joiningVertex->clearNextHops();
+                            SPFCandidate candidate = { linkStateCost, 1, stateIt->second, joiningVertex };
+                            candidateVertices.push(candidate);
+                        }
+                        std::vector<OSPF::NextHop>* newNextHops = calculateNextHops(joiningVertex, justAddedVertex); // (destination, parent)
+                        unsigned int nextHopCount = newNextHops->size();
+                        for (k = 0; k < nextHopCount; k++) {
+                            joiningVertex->addNextHop((*newNextHops)[k]);
+                        }
+                        delete newNextHops;
                     } else {
-                        backbone = this;
-                    }
-                    if (backbone != NULL) {
-                        OSPF::Interface* virtualIntf = backbone->findVirtualLink(destinationID);
-                        if ((virtualIntf != NULL) && (virtualIntf->getTransitAreaID() == areaID)) {
-                            OSPF::IPv4AddressRange range;
-                            range.address = getInterface(routerLSA->getNextHop(0).ifIndex)->getAddressRange().address;
-                            range.mask = IPv4Address::ALLONES_ADDRESS;
-                            virtualIntf->setAddressRange(range);
-                            virtualIntf->setIfIndex(routerLSA->getNextHop(0).ifIndex);
-                            virtualIntf->setOutputCost(routerLSA->getDistance());
-                            OSPF::Neighbor* virtualNeighbor = virtualIntf->getNeighbor(0);
-                            if (virtualNeighbor != NULL) {
-                                unsigned int linkCount = routerLSA->getLinksArraySize();
-                                OSPF::RouterLSA* toRouterLSA = dynamic_cast<OSPF::RouterLSA*> (justAddedVertex);
-                                if (toRouterLSA != NULL) {
-                                    for (i = 0; i < linkCount; i++) {
-                                        Link& link = routerLSA->getLinks(i);
-
-                                        if ((link.getType() == POINTTOPOINT_LINK) &&
-                                            (link.getLinkID() == toRouterLSA->getHeader().getLinkStateID()) &&
-                                            (virtualIntf->getState() < OSPF::Interface::WAITING_STATE))
-                                        {
-                                            virtualNeighbor->setAddress(IPv4Address(link.getLinkData()));
-                                            virtualIntf->processEvent(OSPF::Interface::INTERFACE_UP);
-                                            break;
-                                        }
-                                    }
-                                } else {
-                                    OSPF::NetworkLSA* toNetworkLSA = dynamic_cast<OSPF::NetworkLSA*> (justAddedVertex);
-                                    if (toNetworkLSA != NULL) {
-                                        for (i = 0; i < linkCount; i++) {
-                                            Link& link = routerLSA->getLinks(i);
-
-                                            if ((link.getType() == TRANSIT_LINK) &&
-                                                (link.getLinkID() == toNetworkLSA->getHeader().getLinkStateID()) &&
-                                                (virtualIntf->getState() < OSPF::Interface::WAITING_STATE))
-                                            {
-                                                virtualNeighbor->setAddress(IPv4Address(link.getLinkData()));
-                                                virtualIntf->processEvent(OSPF::Interface::INTERFACE_UP);
-                                                break;
-                                            }
-                                        }
-                                    }
-                                }
-                            }
+                        joiningVertex->setDistance(linkStateCost);
+                        std::vector<OSPF::NextHop>* newNextHops = calculateNextHops(joiningVertex, justAddedVertex); // (destination, parent)
+                        unsigned int nextHopCount = newNextHops->size();
+                        for (k = 0; k < nextHopCount; k++) {
+                            joiningVertex->addNextHop((*newNextHops)[k]);
                         }
-                    }
-                }
-            }
+                        delete newNextHops;
+                        joiningVertex->setParent(justAddedVertex);
 
-            if (closestVertex->getHeader().getLsType() == NETWORKLSA_TYPE) {
-                OSPF::NetworkLSA* networkLSA = check_and_cast<OSPF::NetworkLSA*> (closestVertex);
-                IPv4Address destinationID = (networkLSA->getHeader().getLinkStateID() & networkLSA->getNetworkMask());
-                unsigned int nextHopCount = networkLSA->getNextHopCount();
-                bool overWrite = false;
-                OSPF::RoutingTableEntry* entry = NULL;
-                unsigned long routeCount = newRoutingTable.size();
-                IPv4Address longestMatch(0u);
-
-                for (i = 0; i < routeCount; i++) {
-                    if (newRoutingTable[i]->getDestinationType() == OSPF::RoutingTableEntry::NETWORK_DESTINATION) {
-                        OSPF::RoutingTableEntry* routingEntry = newRoutingTable[i];
-                        IPv4Address entryAddress = routingEntry->getDestination();
-                        IPv4Address entryMask = routingEntry->getNetmask();
-
-                        if ((entryAddress & entryMask) == (destinationID & entryMask)) {
-                            if ((destinationID & entryMask) > longestMatch) {
-                                longestMatch = (destinationID & entryMask);
-                                entry = routingEntry;
-                            }
-                        }
+                        vertexStates[joiningVertex] = ++candidateSequence;
+                        SPFCandidate candidate = { linkStateCost, 1, candidateSequence, joiningVertex };
+                        candidateVertices.push(candidate);
                     }
                 }
-                if (entry != NULL) {
-                    const OSPFLSA* entryOrigin = entry->getLinkStateOrigin();
-                    if ((entry->getCost() != networkLSA->getDistance()) ||
-                        (entryOrigin->getHeader().getLinkStateID() >= networkLSA->getHeader().getLinkStateID()))
-                    {
-                        overWrite = true;
-                    }
-                }
-
-                if ((entry == NULL) || (overWrite)) {
-                    if (entry == NULL) {
-                        entry = new OSPF::RoutingTableEntry;
-                    }
-
-                    entry->setDestination(IPv4Address(destinationID));
-                    entry->setNetmask(networkLSA->getNetworkMask());
-                    entry->setLinkStateOrigin(networkLSA);
-                    entry->setArea(areaID);
-                    entry->setPathType(OSPF::RoutingTableEntry::INTRAAREA);
-                    entry->setCost(networkLSA->getDistance());
-                    entry->setDestinationType(OSPF::RoutingTableEntry::NETWORK_DESTINATION);
-                    entry->setOptionalCapabilities(networkLSA->getHeader().getLsOptions());
-                    for (i = 0; i < nextHopCount; i++) {
-                        entry->addNextHop(networkLSA->getNextHop(i));
-                    }
+            }
 
-                    if (!overWrite) {
-                        newRoutingTable.push_back(entry);
-                    }
+            // (3) the heap may hold outdated entries of vertices whose distance decreased since
+            OSPFLSA* closestVertex = NULL;
+            while (!candidateVertices.empty() && (closestVertex == NULL)) {
+                SPFCandidate candidate = candidateVertices.top();
+                candidateVertices.pop();
+                unsigned long& state = vertexStates[candidate.vertex];
+                if ((state != 0) && (check_and_cast<OSPF::RoutingInfo*> (candidate.vertex)->getDistance() == candidate.distance)) {
+                    closestVertex = candidate.vertex;
+                    state = 0;
                 }
             }
+            if (closestVertex == NULL) {
+                break;
+            }
+
+            treeVertices.push_back(closestVertex);
+            addShortestPathTreeVertexRoutes(closestVertex, justAddedVertex, newRoutingTable, routeIndex);
 
             justAddedVertex = closestVertex;
         }
-    } while (!finished);
+
+        saveShortestPathTree(treeVertices);
+        spfTreeInputs.swap(treeInputs);
+    }
 
     unsigned int treeSize = treeVertices.size();
     for (i = 0; i < treeSize; i++) {
@@ -1749,25 +1926,10 @@ void OSPF::Area::calculateShortestPathTree(std::vector<OSPF::RoutingTableEntry*>
             unsigned long distance = routerVertex->getDistance() + link.getLinkCost();
             unsigned long destinationID = (link.getLinkID().getInt() & link.getLinkData());
             OSPF::RoutingTableEntry* entry = NULL;
-            unsigned long routeCount = newRoutingTable.size();
-            unsigned long longestMatch = 0;
-
-            for (k = 0; k < routeCount; k++) {
-                if (newRoutingTable[k]->getDestinationType() == OSPF::RoutingTableEntry::NETWORK_DESTINATION) {
-                    OSPF::RoutingTableEntry* routingEntry = newRoutingTable[k];
-                    unsigned long entryAddress = routingEntry->getDestination().getInt();
-                    unsigned long entryMask = routingEntry->getNetmask().getInt();
-
-                    if ((entryAddress & entryMask) == (destinationID & entryMask)) {
-                        if ((destinationID & entryMask) > longestMatch) {
-                            longestMatch = (destinationID & entryMask);
-                            entry = routingEntry;
-                        }
-                    }
-                }
-            }
+            long position = routeIndex.findLongestMatch(destinationID);
 
-            if (entry != NULL) {
+            if (position >= 0) {
+                entry = newRoutingTable[position];
                 Metric entryCost = entry->getCost();
 
                 if (distance > entryCost) {
@@ -1821,6 +1983,7 @@ void OSPF::Area::calculateShortestPathTree(std::vector<OSPF::RoutingTableEntry*>
                 }
                 delete newNextHops;
 
+                routeIndex.add(entry, newRoutingTable.size());
                 newRoutingTable.push_back(entry);
             }
         }
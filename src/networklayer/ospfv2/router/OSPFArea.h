@@ -20,6 +20,7 @@
 
 #include <vector>
 #include <map>
+#include <set>
 
 #include "LSA.h"
 #include "OSPFcommon.h"
@@ -33,6 +34,52 @@ class Router;
 
 class Area : public cObject {
 private:
+    /**
+     * A vertex of the shortest path tree, as saved after a full calculation.
+     */
+    struct SPFTreeVertex {
+        LSAType              type;
+        LinkStateID          linkStateID;
+        unsigned long        distance;
+        std::vector<NextHop> nextHops;
+        long                 parentIndex;   // index of the parent in the saved tree, -1 for the root
+    };
+
+    /**
+     * Entry of the candidate list of the shortest path calculation. Candidates
+     * are ordered by distance; on a tie network vertices come before router
+     * vertices, and then the one that became a candidate first.
+     */
+    struct SPFCandidate {
+        unsigned long distance;
+        int           typeRank;     // 0: network vertex, 1: router vertex
+        unsigned long sequence;
+        OSPFLSA*      vertex;
+
+        bool operator>(const SPFCandidate& other) const {
+            if (distance != other.distance)
+                return distance > other.distance;
+            if (typeRank != other.typeRank)
+                return typeRank > other.typeRank;
+            return sequence > other.sequence;
+        }
+    };
+
+    /**
+     * Index over the network destinations of a routing table under construction,
+     * for the longest match searches of calculateShortestPathTree().
+     */
+    class NetworkRouteIndex {
+    private:
+        typedef std::map<uint32, std::set<unsigned long> > PositionsByAddress;
+        std::map<uint32, PositionsByAddress> entriesByNetmask;  // netmask -> masked address -> positions in the table
+
+    public:
+        void add(const RoutingTableEntry* entry, unsigned long position);
+        void remove(const RoutingTableEntry* entry, unsigned long position);
+        long findLongestMatch(uint32 destination) const;
+    };
+
     AreaID                                                  areaID;
     std::map<IPv4AddressRange, bool>                        advertiseAddressRanges;
     std::vector<IPv4AddressRange>                           areaAddressRanges;
@@ -48,6 +95,8 @@ private:
     bool                                                    externalRoutingCapability;
     Metric                                                  stubDefaultCost;
     RouterLSA*                                              spfTreeRoot;
+    std::vector<SPFTreeVertex>                              spfTree;        // tree of the last full calculation, in the order the vertices were added
+    std::vector<unsigned long>                              spfTreeInputs;  // the parts of the database the tree was calculated from
 
     Router*                                                 parentRouter;
 public:
@@ -120,9 +169,15 @@ public:
     std::string       info() const;
     std::string       detailedInfo() const;
 
-private:
+protected:
     SummaryLSA*           originateSummaryLSA(const OSPF::SummaryLSA* summaryLSA);
     bool                  hasLink(OSPFLSA* fromLSA, OSPFLSA* toLSA) const;
+    void                  collectShortestPathTreeInputs(std::vector<unsigned long>& inputs);
+    void                  saveShortestPathTree(const std::vector<OSPFLSA*>& treeVertices);
+    bool                  restoreShortestPathTree(std::vector<OSPFLSA*>& treeVertices);
+    void                  addShortestPathTreeVertexRoutes(OSPFLSA* vertex, OSPFLSA* previousVertex,
+                                                          std::vector<RoutingTableEntry*>& newRoutingTable,
+                                                          NetworkRouteIndex& routeIndex);
     std::vector<NextHop>* calculateNextHops(OSPFLSA* destination, OSPFLSA* parent) const;
     std::vector<NextHop>* calculateNextHops(Link& destination, OSPFLSA* parent) const;
 
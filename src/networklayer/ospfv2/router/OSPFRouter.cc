@@ -745,32 +745,68 @@ void OSPF::Router::rebuildRoutingTable()
     routingTable.clear();
     routingTable.assign(newTable.begin(), newTable.end());
 
+    // update the IPv4 routing table: only the routes inserted by the OSPF module that
+    // changed are removed, and only the new or changed routes are added
     RoutingTableAccess routingTableAccess;
-    std::vector<IPv4Route*> eraseEntries;
     IRoutingTable* simRoutingTable = routingTableAccess.get();
+    typedef std::pair<uint32, uint32> RouteKey;
+    std::map<RouteKey, std::vector<OSPF::RoutingTableEntry*> > installedEntries;
     unsigned long routingEntryNumber = simRoutingTable->getNumRoutes();
-    // remove entries from the IPv4 routing table inserted by the OSPF module
     for (i = 0; i < routingEntryNumber; i++) {
         IPv4Route *entry = simRoutingTable->getRoute(i);
         OSPF::RoutingTableEntry* ospfEntry = dynamic_cast<OSPF::RoutingTableEntry*>(entry);
         if (ospfEntry != NULL) {
-            eraseEntries.push_back(entry);
+            installedEntries[RouteKey(ospfEntry->getDestination().getInt(), ospfEntry->getNetmask().getInt())].push_back(ospfEntry);
         }
     }
 
-    unsigned int eraseCount = eraseEntries.size();
-    for (i = 0; i < eraseCount; i++) {
-        simRoutingTable->deleteRoute(eraseEntries[i]);
-    }
-
-    // add the new routing entries
+    std::vector<OSPF::RoutingTableEntry*> addEntries;
     routeCount = routingTable.size();
     for (i = 0; i < routeCount; i++) {
-        if (routingTable[i]->getDestinationType() == OSPF::RoutingTableEntry::NETWORK_DESTINATION) {
-            simRoutingTable->addRoute(new OSPF::RoutingTableEntry(*(routingTable[i])));
+        OSPF::RoutingTableEntry* entry = routingTable[i];
+        if (entry->getDestinationType() != OSPF::RoutingTableEntry::NETWORK_DESTINATION) {
+            continue;
+        }
+
+        bool installed = false;
+        std::map<RouteKey, std::vector<OSPF::RoutingTableEntry*> >::iterator it = installedEntries.find(RouteKey(entry->getDestination().getInt(), entry->getNetmask().getInt()));
+        if (it != installedEntries.end()) {
+            std::vector<OSPF::RoutingTableEntry*>& candidates = it->second;
+            for (std::vector<OSPF::RoutingTableEntry*>::iterator candidateIt = candidates.begin(); candidateIt != candidates.end(); candidateIt++) {
+                OSPF::RoutingTableEntry* installedEntry = *candidateIt;
+                // the LSA the route originates from does not make it a different route,
+                // but the installed route has to refer to the current one
+                const OSPFLSA* installedOrigin = installedEntry->getLinkStateOrigin();
+                installedEntry->setLinkStateOrigin(entry->getLinkStateOrigin());
+                if ((*installedEntry == *entry) &&
+                    (installedEntry->getMetric() == entry->getMetric()) &&
+                    (installedEntry->getGateway() == entry->getGateway()) &&
+                    (installedEntry->getInterface() == entry->getInterface()))
+                {
+                    candidates.erase(candidateIt);
+                    installed = true;
+                    break;
+                }
+                installedEntry->setLinkStateOrigin(installedOrigin);
+            }
+        }
+        if (!installed) {
+            addEntries.push_back(entry);
+        }
+    }
+
+    for (std::map<RouteKey, std::vector<OSPF::RoutingTableEntry*> >::iterator it = installedEntries.begin(); it != installedEntries.end(); it++) {
+        unsigned int eraseCount = it->second.size();
+        for (i = 0; i < eraseCount; i++) {
+            simRoutingTable->deleteRoute(it->second[i]);
         }
     }
 
+    routeCount = addEntries.size();
+    for (i = 0; i < routeCount; i++) {
+        simRoutingTable->addRoute(new OSPF::RoutingTableEntry(*(addEntries[i])));
+    }
+
     notifyAboutRoutingTableChanges(oldTable);
 
     routeCount = oldTable.size();
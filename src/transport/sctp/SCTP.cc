@@ -870,12 +870,9 @@ void SCTP::removeAssociation(SCTPAssociation *assoc)
 
     // Chunks may be in the transmission and retransmission queues simultaneously.
     // Remove entry from transmission queue if it is already in the retransmission queue.
-    for (SCTPQueue::PayloadQueue::iterator i = assoc->getRetransmissionQueue()->payloadQueue.begin();
-          i != assoc->getRetransmissionQueue()->payloadQueue.end(); i++) {
-        SCTPQueue::PayloadQueue::iterator j = assoc->getTransmissionQueue()->payloadQueue.find(i->second->tsn);
-        if (j != assoc->getTransmissionQueue()->payloadQueue.end()) {
-            assoc->getTransmissionQueue()->payloadQueue.erase(j);
-        }
+    for (SCTPQueue::PayloadQueue::const_iterator i = assoc->getRetransmissionQueue()->getPayloadQueue().begin();
+          i != assoc->getRetransmissionQueue()->getPayloadQueue().end(); i++) {
+        assoc->getTransmissionQueue()->removeMsg(i->second->tsn);
     }
      // Now, both queues can be safely deleted.
     delete assoc->getRetransmissionQueue();
@@ -1299,6 +1299,9 @@ class INET_API SCTPAssociation : public cObject
                                           SCTPPathVariables*    sackPath);
         void moveChunkToOtherPath(SCTPDataVariables* chunk,
                                           SCTPPathVariables* newPath);
+        /** Sets the destination of the chunk, keeping the indices of the queues up to date */
+        void setChunkLastDestination(SCTPDataVariables* chunk, SCTPPathVariables* path);
+        void setChunkNextDestination(SCTPDataVariables* chunk, SCTPPathVariables* path);
         void decreaseOutstandingBytes(SCTPDataVariables* chunk);
         void increaseOutstandingBytes(SCTPDataVariables* chunk,
                                                 SCTPPathVariables* path);
@@ -1197,6 +1197,17 @@ void SCTPAssociation::stateEntered(int32 status)
                         (const char*)sctpMain->par("gapListOptimizationVariant"));
             }
 
+            if(strcmp((const char*)sctpMain->par("gapListImplementation"), "simple") == 0) {
+               state->gapList.setImplementation(SCTPGapList::GLI_Simple);
+            }
+            else if(strcmp((const char*)sctpMain->par("gapListImplementation"), "interval") == 0) {
+               state->gapList.setImplementation(SCTPGapList::GLI_Interval);
+            }
+            else {
+               throw cRuntimeError("Bad setting for gapListImplementation: %s\n",
+                        (const char*)sctpMain->par("gapListImplementation"));
+            }
+
             state->cmtUseSFR                     = (bool)sctpMain->par("cmtUseSFR");
             state->cmtUseDAC                     = (bool)sctpMain->par("cmtUseDAC");
             state->cmtUseFRC                     = (bool)sctpMain->par("cmtUseFRC");
@@ -987,6 +987,7 @@ SCTPEventCode SCTPAssociation::processSackArrived(SCTPSackChunk* sackChunk)
 
     // ====== Put information from SACK into GapList =========================
     SCTPGapList sackGapList;
+    sackGapList.setImplementation(state->gapList.getImplementation());
     sackGapList.setInitialCumAckTSN(sackChunk->getCumTsnAck());
     uint32 lastTSN = sackChunk->getCumTsnAck();
     for (uint32 i = 0; i < sackChunk->getNumGaps(); i++) {
@@ -1224,12 +1225,12 @@ SCTPEventCode SCTPAssociation::processSackArrived(SCTPSackChunk* sackChunk)
     // #### Processing of GapAcks                                         ####
     // #######################################################################
 
-    if ((numGaps > 0) && (!retransmissionQ->payloadQueue.empty()) ) {
+    if ((numGaps > 0) && (!retransmissionQ->getPayloadQueue().empty()) ) {
         sctpEV3 << "===== Handling GapAcks after CumTSNAck " << tsna << " =====" << endl;
         sctpEV3 << "We got " << numGaps << " gap reports" << endl;
 
         // We got fragment reports... check for newly acked chunks.
-        const uint32 queuedChunks = retransmissionQ->payloadQueue.size();
+        const uint32 queuedChunks = retransmissionQ->getPayloadQueue().size();
         sctpEV3 << "Number of chunks in retransmissionQ: " << queuedChunks
                   <<" highestGapStop: " << sackGapList.getGapStop(SCTPGapList::GT_Any, numGaps-1)
                   <<" highestTsnAcked: " << state->highestTsnAcked << endl;
@@ -1493,8 +1494,8 @@ SCTPEventCode SCTPAssociation::processSackArrived(SCTPSackChunk* sackChunk)
     if ((state->allowCMT == true) &&
         (state->cmtSmartT3Reset == true) ) {
         // ====== Find oldest unacked chunk on each path ======================
-        for(SCTPQueue::PayloadQueue::const_iterator iterator = retransmissionQ->payloadQueue.begin();
-            iterator != retransmissionQ->payloadQueue.end(); ++iterator) {
+        for(SCTPQueue::PayloadQueue::const_iterator iterator = retransmissionQ->getPayloadQueue().begin();
+            iterator != retransmissionQ->getPayloadQueue().end(); ++iterator) {
             const SCTPDataVariables* myChunk         = iterator->second;
             SCTPPathVariables*       myChunkLastPath = myChunk->getLastDestinationPath();
             if(!chunkHasBeenAcked(myChunk)) {
@@ -1792,7 +1793,7 @@ void SCTPAssociation::handleChunkReportedAsMissing(const SCTPSackChunk* sackChun
                                   << myChunk->tsn << " on path " << myChunk->getLastDestination() << endl;
                         myChunkLastPath->numberOfFastRetransmissions++;
 
-                        myChunk->setNextDestination(getNextDestination(myChunk));
+                        setChunkNextDestination(myChunk, getNextDestination(myChunk));
                         SCTPPathVariables* myChunkNextPath = myChunk->getNextDestinationPath();
                         assert(myChunkNextPath != NULL);
 
@@ -2018,8 +2019,8 @@ void SCTPAssociation::dequeueAckedChunks(const uint32       tsna,
     rttEstimation = MAXTIME;
 
     // Are there chunks in the retransmission queue ? If Yes -> check for dequeue.
-    SCTPQueue::PayloadQueue::iterator iterator = retransmissionQ->payloadQueue.begin();
-    while (iterator != retransmissionQ->payloadQueue.end()) {
+    SCTPQueue::PayloadQueue::const_iterator iterator = retransmissionQ->getPayloadQueue().begin();
+    while (iterator != retransmissionQ->getPayloadQueue().end()) {
         SCTPDataVariables* chunk = iterator->second;
         if (tsnGe(tsna, chunk->tsn)) {
             sctpEV3 << simTime() << ": CumAcked TSN " << chunk->tsn
@@ -2042,7 +2043,7 @@ void SCTPAssociation::dequeueAckedChunks(const uint32       tsna,
         else {
             break;
         }
-        iterator = retransmissionQ->payloadQueue.begin();
+        iterator = retransmissionQ->getPayloadQueue().begin();
     }
 
     sctpEV3 << "dequeueAckedChunks(): rttEstimation=" << rttEstimation << endl;
@@ -2808,9 +2809,9 @@ bool SCTPAssociation::processPacketDropArrived(SCTPPacketDropChunk* packetDropCh
                     {
                         SCTPDataChunk* dataChunk = check_and_cast<SCTPDataChunk*>(chunk);
                         const uint32   tsn = dataChunk->getTsn();
-                        SCTPQueue::PayloadQueue::iterator pq;
-                        pq = retransmissionQ->payloadQueue.find(tsn);
-                        if ( (pq != retransmissionQ->payloadQueue.end()) &&
+                        SCTPQueue::PayloadQueue::const_iterator pq;
+                        pq = retransmissionQ->getPayloadQueue().find(tsn);
+                        if ( (pq != retransmissionQ->getPayloadQueue().end()) &&
                                 (!chunkHasBeenAcked(pq->second)) ) {
                             sctpEV3 << simTime() << ": Packet Drop for TSN "
                                     << pq->second->tsn << " on path "
@@ -3166,8 +3167,8 @@ void SCTPAssociation::process_TIMEOUT_RTX(SCTPPathVariables* path)
             << " (TSN " << path->oldestChunkTSN << ")" << endl;
     if (SCTP::testing) {
         sctpEV3 << "Unacked chunks in Retransmission Queue:" << endl;
-        for (SCTPQueue::PayloadQueue::const_iterator iterator = retransmissionQ->payloadQueue.begin();
-                iterator != retransmissionQ->payloadQueue.end(); ++iterator) {
+        for (SCTPQueue::PayloadQueue::const_iterator iterator = retransmissionQ->getPayloadQueue().begin();
+                iterator != retransmissionQ->getPayloadQueue().end(); ++iterator) {
             const SCTPDataVariables* myChunk = iterator->second;
             if (!myChunk->hasBeenAcked) {
                 const SCTPPathVariables* myChunkLastPath = myChunk->getLastDestinationPath();
@@ -3240,12 +3241,12 @@ void SCTPAssociation::process_TIMEOUT_RTX(SCTPPathVariables* path)
 
     // ====== Do Retransmission ==============================================
     // dequeue all chunks not acked so far and put them in the TransmissionQ
-    if (!retransmissionQ->payloadQueue.empty()) {
-        sctpEV3 << "Still " << retransmissionQ->payloadQueue.size()
+    if (!retransmissionQ->getPayloadQueue().empty()) {
+        sctpEV3 << "Still " << retransmissionQ->getPayloadQueue().size()
                   << " chunks in retransmissionQ" << endl;
 
-        for (SCTPQueue::PayloadQueue::iterator iterator = retransmissionQ->payloadQueue.begin();
-            iterator != retransmissionQ->payloadQueue.end(); iterator++) {
+        for (SCTPQueue::PayloadQueue::const_iterator iterator = retransmissionQ->getPayloadQueue().begin();
+            iterator != retransmissionQ->getPayloadQueue().end(); iterator++) {
             SCTPDataVariables* chunk = iterator->second;
             assert(chunk != NULL);
 
@@ -3302,7 +3303,7 @@ void SCTPAssociation::moveChunkToOtherPath(SCTPDataVariables* chunk,
     // ====== Prepare next destination =======================================
     chunk->hasBeenFastRetransmitted = false;
     chunk->gapReports = 0;
-    chunk->setNextDestination(newPath);
+    setChunkNextDestination(chunk, newPath);
 
     // ====== Rebook chunk on new path =======================================
     assert(chunk->queuedOnPath->queuedBytes >= chunk->booksize);
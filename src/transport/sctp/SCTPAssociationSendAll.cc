@@ -54,7 +54,7 @@ void SCTPAssociation::storePacket(SCTPPathVariables* pathVar,
         SCTPDataChunk* dataChunk = dynamic_cast<SCTPDataChunk*>(chunkPtr);
         if(dataChunk != NULL) {
             const uint32_t tsn = dataChunk->getTsn();
-            SCTPDataVariables* chunk = retransmissionQ->payloadQueue.find(tsn)->second;
+            SCTPDataVariables* chunk = retransmissionQ->getPayloadQueue().find(tsn)->second;
             assert(chunk != NULL);
             decreaseOutstandingBytes(chunk);
             chunk->queuedOnPath->queuedBytes -= chunk->booksize;
@@ -105,11 +105,11 @@ void SCTPAssociation::loadPacket(SCTPPathVariables* pathVar,
         SCTPDataChunk* dataChunk = dynamic_cast<SCTPDataChunk*>(chunkPtr);
         if(dataChunk != NULL) {
             const uint32_t tsn = dataChunk->getTsn();
-            SCTPDataVariables* chunk = retransmissionQ->payloadQueue.find(tsn)->second;
+            SCTPDataVariables* chunk = retransmissionQ->getPayloadQueue().find(tsn)->second;
             assert(chunk != NULL);
             chunk->queuedOnPath = pathVar;
             chunk->queuedOnPath->queuedBytes += chunk->booksize;
-            chunk->setLastDestination(pathVar);
+            setChunkLastDestination(chunk, pathVar);
             increaseOutstandingBytes(chunk, pathVar);
             chunk->countsAsOutstanding = true;
         }
@@ -412,8 +412,8 @@ void SCTPAssociation::chunkReschedulingControl(SCTPPathVariables* path)
                 (simTime() >= path->blockingTimeout) ) ) {
 
                 // ====== Rescheduling of chunk from other path to current path ====
-                SCTPQueue::PayloadQueue::iterator iterator = retransmissionQ->payloadQueue.begin();
-                if(iterator != retransmissionQ->payloadQueue.end()) {
+                SCTPQueue::PayloadQueue::const_iterator iterator = retransmissionQ->getPayloadQueue().begin();
+                if(iterator != retransmissionQ->getPayloadQueue().end()) {
                     SCTPDataVariables* chunk    = iterator->second;
                     SCTPPathVariables* lastPath = chunk->getLastDestinationPath();
 
@@ -1231,7 +1231,7 @@ void SCTPAssociation::sendOnPath(SCTPPathVariables* pathId, bool firstPass)
                     SCTP::AssocStatMap::iterator iterator = sctpMain->assocStatMap.find(assocId);
                     iterator->second.transmittedBytes += datVar->len / 8;
 
-                    datVar->setLastDestination(path);
+                    setChunkLastDestination(datVar, path);
                     datVar->countsAsOutstanding = true;
                     datVar->hasBeenReneged = false;
                     datVar->sendTime = simTime(); //I.R. to send Fast RTX just once a RTT
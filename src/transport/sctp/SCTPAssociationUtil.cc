@@ -1266,11 +1266,12 @@ SCTPForwardTsnChunk* SCTPAssociation::createForwardTsnChunk(const IPvXAddress& p
     forwChunk->setChunkType(FORWARD_TSN);
     advancePeerTsn();
     forwChunk->setNewCumTsn(state->advancedPeerAckPoint);
-    for (SCTPQueue::PayloadQueue::iterator it=retransmissionQ->payloadQueue.begin(); it!=retransmissionQ->payloadQueue.end(); it++)
+    const SCTPQueue::PayloadQueue& pathQueue = retransmissionQ->getChunksByLastDestination(pid);
+    for (SCTPQueue::PayloadQueue::const_iterator it=pathQueue.begin(); it!=pathQueue.end(); it++)
     {
         chunk = it->second;
         sctpEV3 << "tsn=" << chunk->tsn << " lastDestination=" << chunk->getLastDestination() << " abandoned=" << chunk->hasBeenAbandoned << "\n";
-        if (chunk->getLastDestination() == pid && chunk->hasBeenAbandoned && chunk->tsn <= forwChunk->getNewCumTsn())
+        if (chunk->hasBeenAbandoned && chunk->tsn <= forwChunk->getNewCumTsn())
         {
             if (chunk->ordered)
             {
@@ -1288,9 +1289,8 @@ SCTPForwardTsnChunk* SCTPAssociation::createForwardTsnChunk(const IPvXAddress& p
                 chunk->numberOfRetransmissions++;
                 chunk->sendForwardIfAbandoned = false;
 
-                SCTPQueue::PayloadQueue::iterator itt = transmissionQ->payloadQueue.find(chunk->tsn);
-                if (itt != transmissionQ->payloadQueue.end()) {
-                    transmissionQ->payloadQueue.erase(itt);
+                if (transmissionQ->getChunk(chunk->tsn)) {
+                    transmissionQ->removeMsg(chunk->tsn);
                     chunk->enqueuedInTransmissionQ = false;
                     CounterMap::iterator i = qCounter.roomTransQ.find(pid);
                     i->second -= ADD_PADDING(chunk->len/8+SCTP_DATA_CHUNK_LENGTH);
@@ -1857,7 +1857,7 @@ void SCTPAssociation::pushUlp()
         sctpEV3 << "Size of stream " << iter->first << ": "
                   << rStream->getDeliveryQ()->getQueueSize() << endl;
 
-        while ( (!rStream->getDeliveryQ()->payloadQueue.empty()) &&
+        while ( (!rStream->getDeliveryQ()->getPayloadQueue().empty()) &&
                   (!restrict || (restrict && state->pushMessagesLeft>0)) ) {
             SCTPDataVariables* chunk = rStream->getDeliveryQ()->extractMessage();
             qCounter.roomSumRcvStreams -= ADD_PADDING(chunk->len/8 + SCTP_DATA_CHUNK_LENGTH);
@@ -2149,8 +2149,8 @@ void SCTPAssociation::advancePeerTsn()
 {
     // Rewrote code for efficiency, it consomed >40% of total CPU time before!
     // Find the highest TSN to advance to, not just the first one.
-    SCTPQueue::PayloadQueue::iterator iterator = retransmissionQ->payloadQueue.find(state->advancedPeerAckPoint + 1);
-    while (iterator != retransmissionQ->payloadQueue.end()) {
+    SCTPQueue::PayloadQueue::const_iterator iterator = retransmissionQ->getPayloadQueue().find(state->advancedPeerAckPoint + 1);
+    while (iterator != retransmissionQ->getPayloadQueue().end()) {
         if (iterator->second->hasBeenAbandoned) {
             state->advancedPeerAckPoint = iterator->second->tsn;
             state->ackPointAdvanced = true;
@@ -2176,12 +2176,12 @@ SCTPDataVariables* SCTPAssociation::getOutboundDataChunk(const SCTPPathVariables
               << " availableSpace=" << availableSpace
               << " availableCwnd="  << availableCwnd
               << endl;
-    if (!transmissionQ->payloadQueue.empty()) {
-        for (SCTPQueue::PayloadQueue::iterator it = transmissionQ->payloadQueue.begin();
-             it != transmissionQ->payloadQueue.end(); it++) {
+    const SCTPQueue::PayloadQueue& pathQueue = transmissionQ->getChunksByNextDestination(path->remoteAddress);
+    if (!pathQueue.empty()) {
+        for (SCTPQueue::PayloadQueue::const_iterator it = pathQueue.begin();
+             it != pathQueue.end(); it++) {
             SCTPDataVariables* chunk = it->second;
-            if ( (chunkHasBeenAcked(chunk) == false) && !chunk->hasBeenAbandoned &&
-                 (chunk->getNextDestinationPath() == path) ) {
+            if ( (chunkHasBeenAcked(chunk) == false) && !chunk->hasBeenAbandoned) {
                 const int32 len = ADD_PADDING(chunk->len/8+SCTP_DATA_CHUNK_LENGTH);
                 sctpEV3 << "getOutboundDataChunk() found chunk " << chunk->tsn
                           <<" in the transmission queue, length=" << len << endl;
@@ -2191,7 +2191,7 @@ SCTPDataVariables* SCTPAssociation::getOutboundDataChunk(const SCTPPathVariables
                     //                        this chunk is actually dequeued. Therefore, the check
                     //                        for "chunkHasBeenAcked==false" has been moved into the
                     //                        "if" statement above!
-                    transmissionQ->payloadQueue.erase(it);
+                    transmissionQ->removeMsg(chunk->tsn);   // invalidates it
                     chunk->enqueuedInTransmissionQ = false;
                     CounterMap::iterator i = qCounter.roomTransQ.find(path->remoteAddress);
                     i->second -= ADD_PADDING(chunk->len/8+SCTP_DATA_CHUNK_LENGTH);
@@ -2248,10 +2248,10 @@ SCTPDataVariables* SCTPAssociation::peekAbandonedChunk(const SCTPPathVariables*
 {
     SCTPDataVariables* retChunk = NULL;
 
-    if (state->prMethod != 0 && !retransmissionQ->payloadQueue.empty())
+    if (state->prMethod != 0 && !retransmissionQ->getPayloadQueue().empty())
     {
-        for (SCTPQueue::PayloadQueue::iterator it = retransmissionQ->payloadQueue.begin();
-             it != retransmissionQ->payloadQueue.end(); it++) {
+        for (SCTPQueue::PayloadQueue::const_iterator it = retransmissionQ->getPayloadQueue().begin();
+             it != retransmissionQ->getPayloadQueue().end(); it++) {
             SCTPDataVariables* chunk = it->second;
 
             if (chunk->getLastDestinationPath() == path) {
@@ -2836,18 +2836,34 @@ int SCTPAssociation::getAddressLevel(const IPvXAddress& addr)
     }
 }
 
+void SCTPAssociation::setChunkLastDestination(SCTPDataVariables* chunk, SCTPPathVariables* path)
+{
+    const IPvXAddress oldAddress = chunk->getLastDestination();
+    chunk->setLastDestination(path);
+    transmissionQ->lastDestinationChanged(chunk, oldAddress);
+    retransmissionQ->lastDestinationChanged(chunk, oldAddress);
+}
+
+void SCTPAssociation::setChunkNextDestination(SCTPDataVariables* chunk, SCTPPathVariables* path)
+{
+    const IPvXAddress oldAddress = chunk->getNextDestination();
+    chunk->setNextDestination(path);
+    transmissionQ->nextDestinationChanged(chunk, oldAddress);
+    retransmissionQ->nextDestinationChanged(chunk, oldAddress);
+}
+
 void SCTPAssociation::putInTransmissionQ(const uint32 tsn, SCTPDataVariables* chunk)
 {
     if (chunk->countsAsOutstanding) {
         decreaseOutstandingBytes(chunk);
     }
-    SCTPQueue::PayloadQueue::iterator it = transmissionQ->payloadQueue.find(tsn);
-    if (it == transmissionQ->payloadQueue.end()) {
+    SCTPQueue::PayloadQueue::const_iterator it = transmissionQ->getPayloadQueue().find(tsn);
+    if (it == transmissionQ->getPayloadQueue().end()) {
         sctpEV3 << "putInTransmissionQ: insert tsn=" << tsn << endl;
         chunk->wasDropped = true;
         chunk->wasPktDropped = true;
         chunk->hasBeenFastRetransmitted = true;
-        chunk->setNextDestination(chunk->getLastDestinationPath());
+        setChunkNextDestination(chunk, chunk->getLastDestinationPath());
         if (!transmissionQ->checkAndInsertChunk(chunk->tsn, chunk)) {
             sctpEV3 << "putInTransmissionQ: cannot add message/chunk (TSN="
                     << tsn << ") to the transmissionQ" << endl;
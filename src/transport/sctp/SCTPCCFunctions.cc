@@ -525,18 +525,17 @@ void SCTPAssociation::cwndUpdateAfterSack()
                 if (state->fastRecoverySupported) {
                     uint32 highestAckOnPath = state->lastTsnAck;
                     uint32 highestOutstanding = state->lastTsnAck;
-                    for (SCTPQueue::PayloadQueue::const_iterator chunkIterator = retransmissionQ->payloadQueue.begin();
-                            chunkIterator != retransmissionQ->payloadQueue.end(); chunkIterator++) {
+                    const SCTPQueue::PayloadQueue& pathQueue = retransmissionQ->getChunksByLastDestination(path->remoteAddress);
+                    for (SCTPQueue::PayloadQueue::const_iterator chunkIterator = pathQueue.begin();
+                            chunkIterator != pathQueue.end(); chunkIterator++) {
                         const SCTPDataVariables* chunk = chunkIterator->second;
-                        if (chunk->getLastDestinationPath() == path) {
-                            if (chunkHasBeenAcked(chunk)) {
-                                if (tsnGt(chunk->tsn, highestAckOnPath)) {
-                                    highestAckOnPath = chunk->tsn;
-                                }
-                            } else {
-                                if (tsnGt(chunk->tsn, highestOutstanding)) {
-                                    highestOutstanding = chunk->tsn;
-                                }
+                        if (chunkHasBeenAcked(chunk)) {
+                            if (tsnGt(chunk->tsn, highestAckOnPath)) {
+                                highestAckOnPath = chunk->tsn;
+                            }
+                        } else {
+                            if (tsnGt(chunk->tsn, highestOutstanding)) {
+                                highestOutstanding = chunk->tsn;
                             }
                         }
                     }
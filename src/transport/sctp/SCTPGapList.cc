@@ -86,10 +86,14 @@ void SCTPSimpleGapList::forwardCumAckTSN(const uint32 cTsnAck)
         uint32 advance = 0;
         while (counter < NumGaps) {
             // Check whether CumAckTSN can be advanced.
-            if (SCTPAssociation::tsnGe(cTsnAck, GapStartList[counter])) {   // Yes!
+            if (SCTPAssociation::tsnGe(cTsnAck, GapStopList[counter])) {   // Yes!
                 advance++;
             }
             else {   // No -> end of search.
+                if (SCTPAssociation::tsnGe(cTsnAck, GapStartList[counter])) {
+                    // Block partly covered -> keep the rest.
+                    GapStartList[counter] = cTsnAck + 1;
+                }
                 break;
             }
             counter++;
@@ -111,22 +115,16 @@ void SCTPSimpleGapList::forwardCumAckTSN(const uint32 cTsnAck)
 bool SCTPSimpleGapList::tryToAdvanceCumAckTSN(uint32& cTsnAck)
 {
     bool progress = false;
-    if (NumGaps > 0) {
-        // It is only possible to advance CumAckTSN when there are gaps.
-        uint32 counter = 0;
-        while (counter < NumGaps) {
-            // Check whether CumAckTSN can be advanced.
-            if (cTsnAck + 1 == GapStartList[0]) {   // Yes!
-                cTsnAck = GapStopList[0];
-                // We can take out all fragments of this block
-                for (uint32 i = 1; i < NumGaps; i++) {
-                    GapStartList[i-1] = GapStartList[i];
-                    GapStopList[i-1] = GapStopList[i];
-                }
-                progress = true;
-            }
-            counter++;
+    // It is only possible to advance CumAckTSN when there are gaps.
+    while ((NumGaps > 0) && (cTsnAck + 1 == GapStartList[0])) {   // Yes!
+        cTsnAck = GapStopList[0];
+        // We can take out all fragments of this block
+        for (uint32 i = 1; i < NumGaps; i++) {
+            GapStartList[i-1] = GapStartList[i];
+            GapStopList[i-1] = GapStopList[i];
         }
+        NumGaps--;
+        progress = true;
     }
     return (progress);
 }
@@ -163,7 +161,7 @@ void SCTPSimpleGapList::removeFromGapList(const uint32 removedTSN)
 
             // ====== Just a single TSN in the gap block (start==stop) =========
             else {
-                for (int32 j = i; j <= initialNumGaps - 1; j++) {
+                for (int32 j = i; j < initialNumGaps - 1; j++) {
                     GapStopList[j] = GapStopList[j + 1];
                     GapStartList[j] = GapStartList[j + 1];
                 }
@@ -178,6 +176,20 @@ void SCTPSimpleGapList::removeFromGapList(const uint32 removedTSN)
 }
 
 
+// ###### Remove TSNs after given TSN ######################################
+void SCTPSimpleGapList::removeAfter(const uint32 highestTSN)
+{
+    while ((NumGaps > 0) && (SCTPAssociation::tsnGt(GapStartList[NumGaps - 1], highestTSN))) {
+        NumGaps--;
+        GapStartList[NumGaps] = 0;
+        GapStopList[NumGaps] = 0;
+    }
+    if ((NumGaps > 0) && (SCTPAssociation::tsnGt(GapStopList[NumGaps - 1], highestTSN))) {
+        GapStopList[NumGaps - 1] = highestTSN;
+    }
+}
+
+
 // ###### Add TSN to gap list ###############################################
 bool SCTPSimpleGapList::updateGapList(const uint32 receivedTSN,
         uint32&      cTsnAck,
@@ -305,74 +317,412 @@ bool SCTPSimpleGapList::updateGapList(const uint32 receivedTSN,
 
 
 
+// ###### Constructor #######################################################
+SCTPIntervalGapList::SCTPIntervalGapList()
+{
+    GapIndexValid = true;
+}
+
+
+// ###### Destructor ########################################################
+SCTPIntervalGapList::~SCTPIntervalGapList()
+{
+}
+
+
+// ###### Check gap list ####################################################
+void SCTPIntervalGapList::check(const uint32 cTsnAck) const
+{
+    uint32 lastStop = cTsnAck;
+    for (GapMap::const_iterator gap = Gaps.begin(); gap != Gaps.end(); gap++) {
+        assert(SCTPAssociation::tsnGt(gap->first, lastStop + 1));
+        assert(SCTPAssociation::tsnLe(gap->first, gap->second));
+        lastStop = gap->second;
+    }
+    assert(Gaps.size() <= MAX_GAP_COUNT);
+}
+
+
+// ###### Print gap list ####################################################
+void SCTPIntervalGapList::print(std::ostream& os) const
+{
+    os << "{";
+    for (GapMap::const_iterator gap = Gaps.begin(); gap != Gaps.end(); gap++) {
+        if (gap != Gaps.begin()) {
+            os << ",";
+        }
+        os << " " << gap->first << "-" << gap->second;
+    }
+    os << " }";
+}
+
+
+// ###### Get gap block by index ############################################
+SCTPIntervalGapList::GapMap::const_iterator SCTPIntervalGapList::getGap(const uint32 index) const
+{
+    assert(index < Gaps.size());
+    // The first and the last block are needed most often
+    if (index == 0) {
+        return (Gaps.begin());
+    }
+    else if (index == Gaps.size() - 1) {
+        return (--Gaps.end());
+    }
+    if (!GapIndexValid) {
+        GapIndex.clear();
+        for (GapMap::const_iterator gap = Gaps.begin(); gap != Gaps.end(); gap++) {
+            GapIndex.push_back(gap);
+        }
+        GapIndexValid = true;
+    }
+    return (GapIndex[index]);
+}
+
+uint32 SCTPIntervalGapList::getGapStart(const uint32 index) const
+{
+    return (getGap(index)->first);
+}
+
+uint32 SCTPIntervalGapList::getGapStop(const uint32 index) const
+{
+    return (getGap(index)->second);
+}
+
+
+// ###### Find gap block containing TSN #####################################
+SCTPIntervalGapList::GapMap::iterator SCTPIntervalGapList::findGap(const uint32 tsn)
+{
+    GapMap::iterator gap = Gaps.upper_bound(tsn);   // first block starting after tsn
+    if (gap != Gaps.begin()) {
+        gap--;
+        if (SCTPAssociation::tsnLe(tsn, gap->second)) {
+            return (gap);
+        }
+    }
+    return (Gaps.end());
+}
+
+
+// ###### Insert/erase gap block ############################################
+SCTPIntervalGapList::GapMap::iterator SCTPIntervalGapList::insertGap(const uint32 start, const uint32 stop)
+{
+    GapIndexValid = false;
+    return (Gaps.insert(std::make_pair(start, stop)).first);
+}
+
+void SCTPIntervalGapList::eraseGap(GapMap::iterator gap)
+{
+    GapIndexValid = false;
+    Gaps.erase(gap);
+}
+
+
+// ###### Is TSN in gap list? ###############################################
+bool SCTPIntervalGapList::tsnInGapList(const uint32 tsn) const
+{
+    GapMap::const_iterator gap = Gaps.upper_bound(tsn);
+    if (gap != Gaps.begin()) {
+        gap--;
+        return (SCTPAssociation::tsnLe(tsn, gap->second));
+    }
+    return false;
+}
+
+
+// ###### Forward CumAckTSN #################################################
+void SCTPIntervalGapList::forwardCumAckTSN(const uint32 cTsnAck)
+{
+    while ((!Gaps.empty()) && (SCTPAssociation::tsnGe(cTsnAck, Gaps.begin()->second))) {
+        eraseGap(Gaps.begin());
+    }
+    if ((!Gaps.empty()) && (SCTPAssociation::tsnGe(cTsnAck, Gaps.begin()->first))) {
+        // Block partly covered -> keep the rest.
+        const uint32 stop = Gaps.begin()->second;
+        eraseGap(Gaps.begin());
+        insertGap(cTsnAck + 1, stop);
+    }
+}
+
+
+// ###### Try to advance CumAckTSN ##########################################
+bool SCTPIntervalGapList::tryToAdvanceCumAckTSN(uint32& cTsnAck)
+{
+    bool progress = false;
+    while ((!Gaps.empty()) && (cTsnAck + 1 == Gaps.begin()->first)) {
+        cTsnAck = Gaps.begin()->second;
+        eraseGap(Gaps.begin());
+        progress = true;
+    }
+    return (progress);
+}
+
+
+// ###### Remove TSN from gap list ##########################################
+void SCTPIntervalGapList::removeFromGapList(const uint32 removedTSN)
+{
+    GapMap::iterator gap = findGap(removedTSN);
+    if (gap == Gaps.end()) {
+        return;
+    }
+    const uint32 start = gap->first;
+    const uint32 stop = gap->second;
+    if (start == stop) {   // Just a single TSN in the gap block
+        eraseGap(gap);
+    }
+    else if (stop == removedTSN) {   // Remove stop TSN
+        gap->second--;
+    }
+    else if (start == removedTSN) {   // Remove start TSN
+        eraseGap(gap);
+        insertGap(start + 1, stop);
+    }
+    else {   // Block has to be splitted up
+        gap->second = removedTSN - 1;
+        insertGap(removedTSN + 1, stop);
+        if (Gaps.size() > MAX_GAP_COUNT) {   // Enforce upper limit by dropping the last block!
+            eraseGap(--Gaps.end());
+        }
+    }
+}
+
+
+// ###### Remove TSNs after given TSN ######################################
+void SCTPIntervalGapList::removeAfter(const uint32 highestTSN)
+{
+    while ((!Gaps.empty()) && (SCTPAssociation::tsnGt(Gaps.rbegin()->first, highestTSN))) {
+        GapMap::iterator last = Gaps.end();
+        eraseGap(--last);
+    }
+    if ((!Gaps.empty()) && (SCTPAssociation::tsnGt(Gaps.rbegin()->second, highestTSN))) {
+        Gaps.rbegin()->second = highestTSN;
+    }
+}
+
+
+// ###### Add TSN to gap list ###############################################
+bool SCTPIntervalGapList::updateGapList(const uint32 receivedTSN,
+        uint32&      cTsnAck,
+        bool&        newChunkReceived)
+{
+    if (SCTPAssociation::tsnLe(receivedTSN, cTsnAck)) {
+        // Received TSN covered by CumAckTSN -> nothing to do.
+        return (false);
+    }
+
+    GapMap::iterator next = Gaps.upper_bound(receivedTSN);   // first block after the TSN
+    if (receivedTSN == cTsnAck + 1) {
+        // Increase CumAckTSN, possibly up to the end of the first block.
+        if ((!Gaps.empty()) && (Gaps.begin()->first == receivedTSN + 1)) {
+            cTsnAck = Gaps.begin()->second;
+            eraseGap(Gaps.begin());
+        }
+        else {
+            cTsnAck = receivedTSN;
+        }
+        newChunkReceived = true;
+        return true;
+    }
+
+    GapMap::iterator previous = next;
+    if (previous != Gaps.begin()) {
+        previous--;
+        if (SCTPAssociation::tsnLe(receivedTSN, previous->second)) {
+            // TSN has already been received.
+            return true;
+        }
+        if (previous->second + 1 == receivedTSN) {
+            if ((next != Gaps.end()) && (next->first == receivedTSN + 1)) {
+                // TSN closes the gap between two blocks
+                previous->second = next->second;
+                eraseGap(next);
+            }
+            else {
+                // TSN extends the previous block
+                previous->second = receivedTSN;
+            }
+            newChunkReceived = true;
+            return true;
+        }
+    }
+    if ((next != Gaps.end()) && (next->first == receivedTSN + 1)) {
+        // TSN extends the next block
+        const uint32 stop = next->second;
+        eraseGap(next);
+        insertGap(receivedTSN, stop);
+        newChunkReceived = true;
+        return true;
+    }
+
+    // A new block
+    if (next == Gaps.end()) {
+        // past the end of the list
+        if (Gaps.size() < MAX_GAP_COUNT) {   // Enforce upper limit!
+            insertGap(receivedTSN, receivedTSN);
+            newChunkReceived = true;
+        }
+    }
+    else {
+        // in between two blocks
+        insertGap(receivedTSN, receivedTSN);
+        if (Gaps.size() > MAX_GAP_COUNT) {   // Enforce upper limit by dropping the last block!
+            eraseGap(--Gaps.end());
+        }
+        newChunkReceived = true;
+    }
+    return true;
+}
+
+
+
 // ###### Constructor #######################################################
 SCTPGapList::SCTPGapList()
 {
     CumAckTSN = 0;
+    GapListImplementation = GLI_Simple;
 }
 
 
-// ###### DestruSCTPGapListctor ########################################################
+// ###### Destructor ########################################################
 SCTPGapList::~SCTPGapList()
 {
 }
 
 
+// ###### Set implementation ################################################
+void SCTPGapList::setImplementation(const Implementation implementation)
+{
+    assert(getNumGaps(GT_Any) == 0);
+    GapListImplementation = implementation;
+}
+
+
 // ###### Check gap list ####################################################
+template <class GapListType>
+void SCTPGapList::check(const GapListType* lists) const
+{
+    lists[GT_Any].check(CumAckTSN);
+    lists[GT_Revokable].check(CumAckTSN);
+    lists[GT_NonRevokable].check(CumAckTSN);
+}
+
 void SCTPGapList::check() const
 {
-    CombinedGapList.check(CumAckTSN);
-    RevokableGapList.check(CumAckTSN);
-    NonRevokableGapList.check(CumAckTSN);
+    if (GapListImplementation == GLI_Interval) {
+        check(IntervalGapLists);
+    }
+    else {
+        check(SimpleGapLists);
+    }
 }
 
 
 // ###### Print gap list ####################################################
-void SCTPGapList::print(std::ostream& os) const
+template <class GapListType>
+void SCTPGapList::print(const GapListType* lists, std::ostream& os) const
 {
     os << "CumAck=" << CumAckTSN;
     os << "   Combined-Gaps=";
-    CombinedGapList.print(os);
+    lists[GT_Any].print(os);
     os << "   R-Gaps=";
-    RevokableGapList.print(os);
+    lists[GT_Revokable].print(os);
     os << "   NR-Gaps=";
-    NonRevokableGapList.print(os);
+    lists[GT_NonRevokable].print(os);
+}
+
+void SCTPGapList::print(std::ostream& os) const
+{
+    if (GapListImplementation == GLI_Interval) {
+        print(IntervalGapLists, os);
+    }
+    else {
+        print(SimpleGapLists, os);
+    }
 }
 
 
 // ###### Forward CumAckTSN #################################################
-void SCTPGapList::forwardCumAckTSN(const uint32 cumAckTSN)
+template <class GapListType>
+void SCTPGapList::forwardCumAckTSN(GapListType* lists, const uint32 cumAckTSN)
 {
     CumAckTSN = cumAckTSN;
-    CombinedGapList.forwardCumAckTSN(CumAckTSN);
-    RevokableGapList.forwardCumAckTSN(CumAckTSN);
-    NonRevokableGapList.forwardCumAckTSN(CumAckTSN);
+    lists[GT_Any].forwardCumAckTSN(CumAckTSN);
+    lists[GT_Revokable].forwardCumAckTSN(CumAckTSN);
+    lists[GT_NonRevokable].forwardCumAckTSN(CumAckTSN);
+    // A block may now start right after CumAckTSN. The gap lists
+    // expect the first block to start after a gap, so take it over.
+    tryToAdvanceCumAckTSN(lists);
+}
+
+void SCTPGapList::forwardCumAckTSN(const uint32 cumAckTSN)
+{
+    if (GapListImplementation == GLI_Interval) {
+        forwardCumAckTSN(IntervalGapLists, cumAckTSN);
+    }
+    else {
+        forwardCumAckTSN(SimpleGapLists, cumAckTSN);
+    }
 }
 
 
 // ###### Advance CumAckTSN #################################################
-bool SCTPGapList::tryToAdvanceCumAckTSN()
+template <class GapListType>
+bool SCTPGapList::tryToAdvanceCumAckTSN(GapListType* lists)
 {
-    if (CombinedGapList.tryToAdvanceCumAckTSN(CumAckTSN)) {
-        RevokableGapList.forwardCumAckTSN(CumAckTSN);
-        NonRevokableGapList.forwardCumAckTSN(CumAckTSN);
+    if (lists[GT_Any].tryToAdvanceCumAckTSN(CumAckTSN)) {
+        lists[GT_Revokable].forwardCumAckTSN(CumAckTSN);
+        lists[GT_NonRevokable].forwardCumAckTSN(CumAckTSN);
         return (true);
     }
     return (false);
 }
 
+bool SCTPGapList::tryToAdvanceCumAckTSN()
+{
+    if (GapListImplementation == GLI_Interval) {
+        return (tryToAdvanceCumAckTSN(IntervalGapLists));
+    }
+    return (tryToAdvanceCumAckTSN(SimpleGapLists));
+}
+
 
 // ###### Remove TSN from gap list ##########################################
+template <class GapListType>
+void SCTPGapList::removeFromGapList(GapListType* lists, const uint32 removedTSN)
+{
+    lists[GT_Revokable].removeFromGapList(removedTSN);
+    lists[GT_NonRevokable].removeFromGapList(removedTSN);
+    lists[GT_Any].removeFromGapList(removedTSN);
+    limitToCombinedList(lists);
+}
+
 void SCTPGapList::removeFromGapList(const uint32 removedTSN)
 {
-    RevokableGapList.removeFromGapList(removedTSN);
-    NonRevokableGapList.removeFromGapList(removedTSN);
-    CombinedGapList.removeFromGapList(removedTSN);
+    if (GapListImplementation == GLI_Interval) {
+        removeFromGapList(IntervalGapLists, removedTSN);
+    }
+    else {
+        removeFromGapList(SimpleGapLists, removedTSN);
+    }
+}
+
+
+// ###### Keep R- and NR-lists within combined list ########################
+template <class GapListType>
+void SCTPGapList::limitToCombinedList(GapListType* lists)
+{
+    // With MAX_GAP_COUNT gaps, the combined list drops the TSNs after its
+    // last block. They must not remain in the R- and NR-lists.
+    const uint32 numGaps = lists[GT_Any].getNumGaps();
+    const uint32 highestTSN = (numGaps > 0) ? lists[GT_Any].getGapStop(numGaps - 1) : CumAckTSN;
+    lists[GT_Revokable].removeAfter(highestTSN);
+    lists[GT_NonRevokable].removeAfter(highestTSN);
 }
 
 
 // ###### Add TSN to gap list ###############################################
-bool SCTPGapList::updateGapList(const uint32 receivedTSN,
+template <class GapListType>
+bool SCTPGapList::updateGapList(GapListType* lists,
+        const uint32 receivedTSN,
         bool&        newChunkReceived,
         bool         tsnIsRevokable)
 {
@@ -381,22 +731,32 @@ bool SCTPGapList::updateGapList(const uint32 receivedTSN,
         // Once a TSN become non-revokable, it cannot become revokable again!
         // However, if the list became too long, updateGapList() may be called
         // again when the chunk is received again.
-        RevokableGapList.updateGapList(receivedTSN, oldCumAckTSN, newChunkReceived);
+        lists[GT_Revokable].updateGapList(receivedTSN, oldCumAckTSN, newChunkReceived);
     }
     else {
-        if (NonRevokableGapList.updateGapList(receivedTSN, oldCumAckTSN, newChunkReceived) == true) {
+        if (lists[GT_NonRevokable].updateGapList(receivedTSN, oldCumAckTSN, newChunkReceived) == true) {
             // TSN has moved from revokable to non-revokable!
-            RevokableGapList.removeFromGapList(receivedTSN);
+            lists[GT_Revokable].removeFromGapList(receivedTSN);
         }
     }
 
     // Finally, add TSN to combined list and set CumAckTSN.
     oldCumAckTSN = CumAckTSN;
-    const bool newChunk = CombinedGapList.updateGapList(receivedTSN, CumAckTSN, newChunkReceived);
+    const bool newChunk = lists[GT_Any].updateGapList(receivedTSN, CumAckTSN, newChunkReceived);
     if (oldCumAckTSN != CumAckTSN) {
-        RevokableGapList.forwardCumAckTSN(CumAckTSN);
-        NonRevokableGapList.forwardCumAckTSN(CumAckTSN);
+        lists[GT_Revokable].forwardCumAckTSN(CumAckTSN);
+        lists[GT_NonRevokable].forwardCumAckTSN(CumAckTSN);
     }
+    limitToCombinedList(lists);
     return (newChunk);
 }
 
+bool SCTPGapList::updateGapList(const uint32 receivedTSN,
+        bool&        newChunkReceived,
+        bool         tsnIsRevokable)
+{
+    if (GapListImplementation == GLI_Interval) {
+        return (updateGapList(IntervalGapLists, receivedTSN, newChunkReceived, tsnIsRevokable));
+    }
+    return (updateGapList(SimpleGapLists, receivedTSN, newChunkReceived, tsnIsRevokable));
+}
@@ -20,6 +20,8 @@
 #define SCTPGAPLIST_H
 
 #include <assert.h>
+#include <map>
+#include <vector>
 
 #include "INETDefs.h"
 
@@ -53,6 +55,7 @@ class SCTPSimpleGapList
     void forwardCumAckTSN(const uint32 cTsnAck);
     bool tryToAdvanceCumAckTSN(uint32& cTsnAck);
     void removeFromGapList(const uint32 removedTSN);
+    void removeAfter(const uint32 highestTSN);
     bool updateGapList(const uint32 receivedTSN,
                        uint32&      cTsnAck,
                        bool&        newChunkReceived);
@@ -66,77 +69,127 @@ class SCTPSimpleGapList
 };
 
 
+/**
+ * Gap list with the same behaviour as SCTPSimpleGapList (including the
+ * MAX_GAP_COUNT limit), but storing the gap blocks in a balanced tree,
+ * so that adding, removing and looking up a TSN takes O(log n) time
+ * instead of O(n).
+ */
+class SCTPIntervalGapList
+{
+  public:
+    SCTPIntervalGapList();
+    ~SCTPIntervalGapList();
+
+    void check(const uint32 cTsnAck) const;
+    void print(std::ostream& os) const;
+
+    inline uint32 getNumGaps() const {
+        return (Gaps.size());
+    }
+    uint32 getGapStart(const uint32 index) const;
+    uint32 getGapStop(const uint32 index) const;
+
+    bool tsnInGapList(const uint32 tsn) const;
+    void forwardCumAckTSN(const uint32 cTsnAck);
+    bool tryToAdvanceCumAckTSN(uint32& cTsnAck);
+    void removeFromGapList(const uint32 removedTSN);
+    void removeAfter(const uint32 highestTSN);
+    bool updateGapList(const uint32 receivedTSN,
+                       uint32&      cTsnAck,
+                       bool&        newChunkReceived);
+
+
+    // ====== Private data ===================================================
+  private:
+    // TSN order by serial number arithmetic, like SCTPAssociation::tsnLt()
+    struct TSNLess {
+        inline bool operator()(const uint32 tsn1, const uint32 tsn2) const {
+            return ((int32)(tsn1 - tsn2) < 0);
+        }
+    };
+    typedef std::map<uint32, uint32, TSNLess> GapMap;   // start TSN -> stop TSN
+
+    GapMap Gaps;
+    mutable std::vector<GapMap::const_iterator> GapIndex;   // for access by index, rebuilt on demand
+    mutable bool GapIndexValid;
+
+    GapMap::const_iterator getGap(const uint32 index) const;
+    GapMap::iterator findGap(const uint32 tsn);
+    GapMap::iterator insertGap(const uint32 start, const uint32 stop);
+    void eraseGap(GapMap::iterator gap);
+};
+
+
 class SCTPGapList
 {
   public:
     SCTPGapList();
     ~SCTPGapList();
 
+    enum GapType {
+        GT_Any = 0,
+        GT_Revokable = 1,
+        GT_NonRevokable = 2
+    };
+
+    // Storage of the gap blocks; both give identical results
+    enum Implementation {
+        GLI_Simple   = 0,   // SCTPSimpleGapList: arrays, O(n) updates
+        GLI_Interval = 1    // SCTPIntervalGapList: balanced tree, O(log n) updates
+    };
+
+    void setImplementation(const Implementation implementation);
+    inline Implementation getImplementation() const {
+        return (GapListImplementation);
+    }
+
     inline void setInitialCumAckTSN(const uint32 cumAckTSN) {
-        assert(CombinedGapList.getNumGaps() == 0);
+        assert(getNumGaps(GT_Any) == 0);
         CumAckTSN = cumAckTSN;
     }
     inline uint32 getCumAckTSN() const {
         return (CumAckTSN);
     }
     inline uint32 getHighestTSNReceived() const {
-        if (CombinedGapList.getNumGaps() > 0) {
-            return (CombinedGapList.getGapStop(CombinedGapList.getNumGaps() - 1));
+        const uint32 numGaps = getNumGaps(GT_Any);
+        if (numGaps > 0) {
+            return (getGapStop(GT_Any, numGaps - 1));
         }
         else {
             return (CumAckTSN);
         }
     }
 
-    enum GapType {
-        GT_Any = 0,
-        GT_Revokable = 1,
-        GT_NonRevokable = 2
-    };
-
+    // The lists are indexed by GapType: combined (GT_Any), revokable, non-revokable
     inline uint32 getNumGaps(const GapType type) const {
-        if (type == GT_Revokable) {
-            return (RevokableGapList.getNumGaps());
-        }
-        else if (type == GT_NonRevokable) {
-            return (NonRevokableGapList.getNumGaps());
-        }
-        else {
-            return (CombinedGapList.getNumGaps());
+        if (GapListImplementation == GLI_Interval) {
+            return (IntervalGapLists[type].getNumGaps());
         }
+        return (SimpleGapLists[type].getNumGaps());
     }
 
     inline bool tsnInGapList(const uint32 tsn) const {
-        return (CombinedGapList.tsnInGapList(tsn));
+        return (tsnInGapList(GT_Any, tsn));
     }
     inline bool tsnIsRevokable(const uint32 tsn) const {
-        return (RevokableGapList.tsnInGapList(tsn));
+        return (tsnInGapList(GT_Revokable, tsn));
     }
     inline bool tsnIsNonRevokable(const uint32 tsn) const {
-        return (NonRevokableGapList.tsnInGapList(tsn));
+        return (tsnInGapList(GT_NonRevokable, tsn));
     }
 
     inline uint32 getGapStart(const GapType type, const uint32 index) const {
-        if (type == GT_Revokable) {
-            return (RevokableGapList.getGapStart(index));
-        }
-        else if (type == GT_NonRevokable) {
-            return (NonRevokableGapList.getGapStart(index));
-        }
-        else {
-            return (CombinedGapList.getGapStart(index));
+        if (GapListImplementation == GLI_Interval) {
+            return (IntervalGapLists[type].getGapStart(index));
         }
+        return (SimpleGapLists[type].getGapStart(index));
     }
     inline uint32 getGapStop(const GapType type, const uint32 index) const {
-        if (type == GT_Revokable) {
-            return (RevokableGapList.getGapStop(index));
-        }
-        else if (type == GT_NonRevokable) {
-            return (NonRevokableGapList.getGapStop(index));
-        }
-        else {
-            return (CombinedGapList.getGapStop(index));
+        if (GapListImplementation == GLI_Interval) {
+            return (IntervalGapLists[type].getGapStop(index));
         }
+        return (SimpleGapLists[type].getGapStop(index));
     }
 
     void check() const;
@@ -151,10 +204,29 @@ class SCTPGapList
 
     // ====== Private data ===================================================
   private:
-    uint32        CumAckTSN;
-    SCTPSimpleGapList RevokableGapList;
-    SCTPSimpleGapList NonRevokableGapList;
-    SCTPSimpleGapList CombinedGapList;
+    uint32              CumAckTSN;
+    Implementation      GapListImplementation;
+    SCTPSimpleGapList   SimpleGapLists[3];
+    SCTPIntervalGapList IntervalGapLists[3];
+
+    inline bool tsnInGapList(const GapType type, const uint32 tsn) const {
+        if (GapListImplementation == GLI_Interval) {
+            return (IntervalGapLists[type].tsnInGapList(tsn));
+        }
+        return (SimpleGapLists[type].tsnInGapList(tsn));
+    }
+
+    // the algorithms, for SCTPSimpleGapList or SCTPIntervalGapList lists
+    template <class GapListType> void check(const GapListType* lists) const;
+    template <class GapListType> void print(const GapListType* lists, std::ostream& os) const;
+    template <class GapListType> void forwardCumAckTSN(GapListType* lists, const uint32 cumAckTSN);
+    template <class GapListType> bool tryToAdvanceCumAckTSN(GapListType* lists);
+    template <class GapListType> void removeFromGapList(GapListType* lists, const uint32 removedTSN);
+    template <class GapListType> void limitToCombinedList(GapListType* lists);
+    template <class GapListType> bool updateGapList(GapListType* lists,
+                                                    const uint32 receivedTSN,
+                                                    bool&        newChunkReceived,
+                                                    bool         tsnIsRevokable);
 };
 
 #endif
@@ -43,6 +43,10 @@ INetfilter::IHook::Result SCTPNatHook::datagramForwardHook(IPv4Datagram* datagra
     if (SCTPAssociation::getAddressLevel(dgram->getSrcAddress())!=3) {
         return INetfilter::IHook::ACCEPT;
     }
+    if (dgram->getFragmentOffset() != 0 || !dgram->getEncapsulatedPacket()) {
+        // only the first fragment carries the SCTP packet, the others pass untranslated
+        return INetfilter::IHook::ACCEPT;
+    }
     natTable->printNatTable();
     SCTPMessage* sctpMsg = check_and_cast<SCTPMessage*>(dgram->getEncapsulatedPacket());
     unsigned int numberOfChunks=sctpMsg->getChunksArraySize();
@@ -129,6 +133,10 @@ INetfilter::IHook::Result SCTPNatHook::datagramPreRoutingHook(IPv4Datagram* data
     if (SCTPAssociation::getAddressLevel(dgram->getSrcAddress())==3) {
         return INetfilter::IHook::ACCEPT;
     }
+    if (dgram->getFragmentOffset() != 0 || !dgram->getEncapsulatedPacket()) {
+        // only the first fragment carries the SCTP packet, the others pass untranslated
+        return INetfilter::IHook::ACCEPT;
+    }
     natTable->printNatTable();
     bool local = ((rt->isLocalAddress(dgram->getDestAddress()) & SCTPAssociation::getAddressLevel(dgram->getSrcAddress()))==3);
     SCTPMessage* sctpMsg = check_and_cast<SCTPMessage*>(dgram->getEncapsulatedPacket());
@@ -26,6 +26,7 @@ Register_Class(SCTPQueue);
 SCTPQueue::SCTPQueue()
 {
     assoc = NULL;
+    numBytes = 0;
 }
 
 SCTPQueue::~SCTPQueue()
@@ -46,10 +47,54 @@ bool SCTPQueue::checkAndInsertChunk(const uint32 key, SCTPDataVariables* chunk)
     if (found != payloadQueue.end()) {
         return false;
     }
-    payloadQueue[key] = chunk;
+    insertChunk(key, chunk);
     return true;
 }
 
+void SCTPQueue::insertChunk(const uint32 key, SCTPDataVariables* chunk)
+{
+    payloadQueue[key] = chunk;
+    numBytes += chunk->len / 8;
+    if (chunk->bbit && chunk->ebit) {
+        ssnIndex.insert(std::make_pair(chunk->ssn, key));
+    }
+    addToIndex(lastDestinationIndex, chunk->getLastDestination(), key, chunk);
+    addToIndex(nextDestinationIndex, chunk->getNextDestination(), key, chunk);
+}
+
+void SCTPQueue::eraseChunk(PayloadQueue::iterator iterator)
+{
+    const uint32 key = iterator->first;
+    SCTPDataVariables* chunk = iterator->second;
+    numBytes -= chunk->len / 8;
+    ssnIndex.erase(std::make_pair(chunk->ssn, key));
+    removeFromIndex(lastDestinationIndex, chunk->getLastDestination(), key);
+    removeFromIndex(nextDestinationIndex, chunk->getNextDestination(), key);
+    payloadQueue.erase(iterator);
+}
+
+void SCTPQueue::addToIndex(DestinationIndex& index, const IPvXAddress& address,
+                           const uint32 key, SCTPDataVariables* chunk)
+{
+    if (!address.isUnspecified()) {
+        index[address][key] = chunk;
+    }
+}
+
+void SCTPQueue::removeFromIndex(DestinationIndex& index, const IPvXAddress& address, const uint32 key)
+{
+    if (address.isUnspecified()) {
+        return;
+    }
+    DestinationIndex::iterator found = index.find(address);
+    if (found != index.end()) {
+        found->second.erase(key);
+        if (found->second.empty()) {
+            index.erase(found);
+        }
+    }
+}
+
 uint32 SCTPQueue::getQueueSize() const
 {
     return payloadQueue.size();
@@ -60,7 +105,7 @@ SCTPDataVariables* SCTPQueue::extractMessage()
     if (!payloadQueue.empty()) {
         PayloadQueue::iterator iterator = payloadQueue.begin();
         SCTPDataVariables*    chunk = iterator->second;
-        payloadQueue.erase(iterator);
+        eraseChunk(iterator);
         return chunk;
     }
     return NULL;
@@ -68,10 +113,10 @@ SCTPDataVariables* SCTPQueue::extractMessage()
 
 SCTPDataVariables* SCTPQueue::getAndExtractChunk(const uint32 tsn)
 {
-    if (!payloadQueue.empty()) {
-        PayloadQueue::iterator iterator = payloadQueue.find(tsn);
+    PayloadQueue::iterator iterator = payloadQueue.find(tsn);
+    if (iterator != payloadQueue.end()) {
         SCTPDataVariables*    chunk = iterator->second;
-        payloadQueue.erase(iterator);
+        eraseChunk(iterator);
         return chunk;
     }
     return NULL;
@@ -151,7 +196,9 @@ SCTPDataVariables* SCTPQueue::getChunkFast(const uint32 tsn, bool& firstTime)
 void SCTPQueue::removeMsg(const uint32 tsn)
 {
     PayloadQueue::iterator iterator = payloadQueue.find(tsn);
-    payloadQueue.erase(iterator);
+    if (iterator != payloadQueue.end()) {
+        eraseChunk(iterator);
+    }
 }
 
 bool SCTPQueue::deleteMsg(const uint32 tsn)
@@ -162,7 +209,7 @@ bool SCTPQueue::deleteMsg(const uint32 tsn)
         SCTPDataVariables* chunk = iterator->second;
         cMessage* msg = check_and_cast<cMessage*>(chunk->userData);
         delete msg;
-        payloadQueue.erase(iterator);
+        eraseChunk(iterator);
         return true;
     }
     return false;
@@ -170,29 +217,83 @@ bool SCTPQueue::deleteMsg(const uint32 tsn)
 
 int32 SCTPQueue::getNumBytes() const
 {
-    int32 qb = 0;
-    for (PayloadQueue::const_iterator iterator = payloadQueue.begin();
-          iterator != payloadQueue.end(); iterator++) {
-        qb += (iterator->second->len / 8);
-    }
-    return qb;
+    return numBytes;
 }
 
 SCTPDataVariables* SCTPQueue::dequeueChunkBySSN(const uint16 ssn)
 {
-    for (PayloadQueue::iterator iterator = payloadQueue.begin();
-          iterator != payloadQueue.end(); iterator++) {
+    // the complete message with this SSN and the lowest key
+    SSNIndex::iterator found = ssnIndex.lower_bound(std::make_pair(ssn, (uint32)0));
+    if ((found != ssnIndex.end()) && (found->first == ssn)) {
+        PayloadQueue::iterator iterator = payloadQueue.find(found->second);
         SCTPDataVariables* chunk = iterator->second;
-        if ((iterator->second->ssn == ssn) &&
-             (iterator->second->bbit) &&
-             (iterator->second->ebit) ) {
-            payloadQueue.erase(iterator);
-            return chunk;
-        }
+        eraseChunk(iterator);
+        return chunk;
     }
     return NULL;
 }
 
+void SCTPQueue::lastDestinationChanged(SCTPDataVariables* chunk, const IPvXAddress& oldAddress)
+{
+    PayloadQueue::iterator iterator = payloadQueue.find(chunk->tsn);
+    if (iterator != payloadQueue.end()) {
+        // another chunk with the same TSN means that the indexes went out of sync
+        ASSERT(iterator->second == chunk);
+        removeFromIndex(lastDestinationIndex, oldAddress, iterator->first);
+        addToIndex(lastDestinationIndex, chunk->getLastDestination(), iterator->first, chunk);
+    }
+}
+
+void SCTPQueue::nextDestinationChanged(SCTPDataVariables* chunk, const IPvXAddress& oldAddress)
+{
+    PayloadQueue::iterator iterator = payloadQueue.find(chunk->tsn);
+    if (iterator != payloadQueue.end()) {
+        ASSERT(iterator->second == chunk);
+        removeFromIndex(nextDestinationIndex, oldAddress, iterator->first);
+        addToIndex(nextDestinationIndex, chunk->getNextDestination(), iterator->first, chunk);
+    }
+}
+
+const SCTPQueue::PayloadQueue& SCTPQueue::getChunksByDestination(const DestinationIndex& index,
+                                                                  const IPvXAddress& address) const
+{
+    DestinationIndex::const_iterator found = index.find(address);
+    return (found != index.end()) ? found->second : emptyQueue;
+}
+
+const SCTPQueue::PayloadQueue& SCTPQueue::getChunksByLastDestination(const IPvXAddress& remoteAddress) const
+{
+    return getChunksByDestination(lastDestinationIndex, remoteAddress);
+}
+
+const SCTPQueue::PayloadQueue& SCTPQueue::getChunksByNextDestination(const IPvXAddress& remoteAddress) const
+{
+    return getChunksByDestination(nextDestinationIndex, remoteAddress);
+}
+
+void SCTPQueue::check() const
+{
+    int32 bytes = 0;
+    SSNIndex ssns;
+    DestinationIndex lastDestinations;
+    DestinationIndex nextDestinations;
+    for (PayloadQueue::const_iterator iterator = payloadQueue.begin();
+          iterator != payloadQueue.end(); ++iterator) {
+        const uint32 key = iterator->first;
+        SCTPDataVariables* chunk = iterator->second;
+        bytes += chunk->len / 8;
+        if (chunk->bbit && chunk->ebit) {
+            ssns.insert(std::make_pair(chunk->ssn, key));
+        }
+        addToIndex(lastDestinations, chunk->getLastDestination(), key, chunk);
+        addToIndex(nextDestinations, chunk->getNextDestination(), key, chunk);
+    }
+    ASSERT(bytes == numBytes);
+    ASSERT(ssns == ssnIndex);
+    ASSERT(lastDestinations == lastDestinationIndex);
+    ASSERT(nextDestinations == nextDestinationIndex);
+}
+
 uint16 SCTPQueue::getFirstSsnInQueue(const uint16 sid)
 {
     return payloadQueue.begin()->second->ssn;
@@ -202,26 +303,20 @@ void SCTPQueue::findEarliestOutstandingTSNsForPath(const IPvXAddress& remoteAddr
         uint32&            earliestOutstandingTSN,
         uint32&            rtxEarliestOutstandingTSN) const
 {
-    bool findEarliestOutstandingTSN = true;
-    bool findRTXEarliestOutstandingTSN = true;
-
-    for (PayloadQueue::const_iterator iterator = payloadQueue.begin();
-            iterator != payloadQueue.end(); ++iterator) {
+    // only the first unacked chunk on the path is relevant
+    const PayloadQueue& pathQueue = getChunksByLastDestination(remoteAddress);
+    for (PayloadQueue::const_iterator iterator = pathQueue.begin();
+            iterator != pathQueue.end(); ++iterator) {
         const SCTPDataVariables* chunk = iterator->second;
-        if (chunk->getLastDestination() == remoteAddress) {
-            // ====== Find earliest outstanding TSNs ===========================
-            if (chunk->hasBeenAcked == false) {
-                if ( (findEarliestOutstandingTSN) &&
-                        (chunk->numberOfRetransmissions == 0) ) {
-                    earliestOutstandingTSN = chunk->tsn;
-                }
-                findEarliestOutstandingTSN = false;
-                if ( (findRTXEarliestOutstandingTSN) &&
-                        (chunk->numberOfRetransmissions > 0) ) {
-                    rtxEarliestOutstandingTSN = chunk->tsn;
-                }
-                findRTXEarliestOutstandingTSN = false;
+        // ====== Find earliest outstanding TSNs ===============================
+        if (chunk->hasBeenAcked == false) {
+            if (chunk->numberOfRetransmissions == 0) {
+                earliestOutstandingTSN = chunk->tsn;
             }
+            else {
+                rtxEarliestOutstandingTSN = chunk->tsn;
+            }
+            return;
         }
     }
 }
@@ -229,12 +324,9 @@ void SCTPQueue::findEarliestOutstandingTSNsForPath(const IPvXAddress& remoteAddr
 
 uint32 SCTPQueue::getSizeOfFirstChunk(const IPvXAddress& remoteAddress)
 {
-    for (PayloadQueue::const_iterator iterator = payloadQueue.begin();
-            iterator != payloadQueue.end(); ++iterator) {
-        const SCTPDataVariables* chunk = iterator->second;
-        if (chunk->getNextDestination() == remoteAddress) {
-            return chunk->booksize;
-        }
+    const PayloadQueue& pathQueue = getChunksByNextDestination(remoteAddress);
+    if (!pathQueue.empty()) {
+        return pathQueue.begin()->second->booksize;
     }
     return (0);
 }
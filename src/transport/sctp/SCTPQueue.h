@@ -19,6 +19,8 @@
 #ifndef __SCTPQUEUE_H
 #define __SCTPQUEUE_H
 
+#include <set>
+
 #include "INETDefs.h"
 
 #include "IPvXAddress.h"
@@ -44,6 +46,15 @@ class SCTPAssociation;
  * at SCTPSendQueue. Different subclasses can be written to accomodate
  * different needs.
  *
+ * Besides the chunks ordered by TSN, the queue maintains the number of
+ * bytes queued, an index of complete messages by SSN (for ordered delivery)
+ * and, for every destination address, the chunks whose last or next
+ * destination it is (for per-path processing on the sender side). Therefore,
+ * the chunks are only accessible read-only (getPayloadQueue()), and changes
+ * of the destinations of queued chunks must be reported with
+ * lastDestinationChanged() and nextDestinationChanged(). check() verifies
+ * the indexes against the chunks.
+ *
  * @see SCTPSendQueue
  */
 class INET_API SCTPQueue : public cObject
@@ -85,6 +96,10 @@ class INET_API SCTPQueue : public cObject
 
     SCTPDataVariables* dequeueChunkBySSN(const uint16 ssn);
 
+    /* to be called after changing the last (next) destination of a chunk that may be in the queue */
+    void lastDestinationChanged(SCTPDataVariables* chunk, const IPvXAddress& oldAddress);
+    void nextDestinationChanged(SCTPDataVariables* chunk, const IPvXAddress& oldAddress);
+
     uint32 getSizeOfFirstChunk(const IPvXAddress& remoteAddress);
 
     uint16 getFirstSsnInQueue(const uint16 sid);
@@ -95,10 +110,34 @@ class INET_API SCTPQueue : public cObject
 
   public:
      typedef std::map<uint32, SCTPDataVariables*> PayloadQueue;
-     PayloadQueue payloadQueue;
+
+    /* the chunks in the queue by key (TSN) */
+    const PayloadQueue& getPayloadQueue() const { return payloadQueue; }
+
+    /* chunks in the queue whose last (next) destination is remoteAddress, ordered like payloadQueue */
+    const PayloadQueue& getChunksByLastDestination(const IPvXAddress& remoteAddress) const;
+    const PayloadQueue& getChunksByNextDestination(const IPvXAddress& remoteAddress) const;
+
+    /* rebuilds the byte count, SSN and destination indexes from the chunks and asserts that they are up to date */
+    void check() const;
 
   protected:
+     typedef std::map<IPvXAddress, PayloadQueue> DestinationIndex;
+     typedef std::set<std::pair<uint16, uint32> > SSNIndex;    // (ssn, key) of complete messages
+
+     PayloadQueue payloadQueue;
      SCTPAssociation* assoc;    // SCTP connection object
+     int32 numBytes;            // sum of len/8 of the chunks
+     SSNIndex ssnIndex;
+     DestinationIndex lastDestinationIndex;
+     DestinationIndex nextDestinationIndex;
+     PayloadQueue emptyQueue;   // returned for destinations without chunks
+
+     void insertChunk(const uint32 key, SCTPDataVariables* chunk);
+     void eraseChunk(PayloadQueue::iterator iterator);
+     static void addToIndex(DestinationIndex& index, const IPvXAddress& address, const uint32 key, SCTPDataVariables* chunk);
+     static void removeFromIndex(DestinationIndex& index, const IPvXAddress& address, const uint32 key);
+     const PayloadQueue& getChunksByDestination(const DestinationIndex& index, const IPvXAddress& address) const;
 
   private:
      PayloadQueue::iterator GetChunkFastIterator;
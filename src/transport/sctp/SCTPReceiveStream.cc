@@ -63,6 +63,9 @@ uint32 SCTPReceiveStream::reassemble(SCTPQueue* queue, uint32 tsn)
 
             sctpEV3 << "First fragment has " << firstVar->len / 8 << " bytes." << endl;
 
+            // len and ebit are indexed by the queue: take the chunk out while changing them
+            queue->removeMsg(firstVar->tsn);
+
             while (++begintsn <= endtsn)
             {
                 processVar = queue->getAndExtractChunk(begintsn);
@@ -87,6 +90,7 @@ uint32 SCTPReceiveStream::reassemble(SCTPQueue* queue, uint32 tsn)
             }
 
             firstVar->ebit = 1;
+            queue->checkAndInsertChunk(firstVar->tsn, firstVar);
 
             sctpEV3 << "Reassembly done. Length=" << firstVar->len<<"\n";
             return firstVar->tsn;
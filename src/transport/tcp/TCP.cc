@@ -302,45 +302,54 @@ void TCP::updateDisplayString()
 
 TCPConnection *TCP::findConnForSegment(TCPSegment *tcpseg, IPvXAddress srcAddr, IPvXAddress destAddr)
 {
-    SockPair key;
-    key.localAddr = destAddr;
-    key.remoteAddr = srcAddr;
-    key.localPort = tcpseg->getDestPort();
-    key.remotePort = tcpseg->getSrcPort();
-    SockPair save = key;
-
-    // try with fully qualified SockPair
-    TcpConnMap::iterator i;
-    i = tcpConnMap.find(key);
-
-    if (i != tcpConnMap.end())
-        return i->second;
-
-    // try with localAddr missing (only localPort specified in passive/active open)
-    key.localAddr = IPvXAddress();
-    i = tcpConnMap.find(key);
-
-    if (i != tcpConnMap.end())
-        return i->second;
-
-    // try fully qualified local socket + blank remote socket (for incoming SYN)
-    key = save;
-    key.remoteAddr = IPvXAddress();
-    key.remotePort = -1;
-    i = tcpConnMap.find(key);
-
-    if (i != tcpConnMap.end())
-        return i->second;
-
-    // try with blank remote socket, and localAddr missing (for incoming SYN)
-    key.localAddr = IPvXAddress();
-    i = tcpConnMap.find(key);
+    int localPort = tcpseg->getDestPort();
+    int remotePort = tcpseg->getSrcPort();
 
-    if (i != tcpConnMap.end())
-        return i->second;
+    // try with fully qualified socket pair
+    if (connectedTable.size() > 0)
+    {
+        unsigned int hash = hashSocketPair(destAddr, srcAddr, localPort, remotePort);
+        const DemuxTable::Bucket& bucket = connectedTable.getBucket(hash);
+        for (DemuxTable::Bucket::const_iterator it = bucket.begin(); it != bucket.end(); ++it)
+        {
+            TCPConnection *conn = it->value;
+            if (it->hash == hash && conn->localPort == localPort && conn->remotePort == remotePort
+                    && conn->remoteAddr == srcAddr && conn->localAddr == destAddr)
+                return conn;
+        }
+    }
 
-    // given up
-    return NULL;
+    // Look among the connections that have unspecified fields and are bound to
+    // the same local port. In order of preference, accept:
+    //  1. the fully qualified socket pair (only if some address is unspecified in the segment)
+    //  2. localAddr missing (only localPort specified in passive/active open)
+    //  3. fully qualified local socket + blank remote socket (for incoming SYN)
+    //  4. blank remote socket, and localAddr missing (for incoming SYN)
+    if (listenerTable.size() == 0)
+        return NULL;
+
+    TCPConnection *best = NULL;
+    int bestRank = 5;
+    const DemuxTable::Bucket& bucket = listenerTable.getBucket(hashInt(localPort));
+    for (DemuxTable::Bucket::const_iterator it = bucket.begin(); it != bucket.end(); ++it)
+    {
+        TCPConnection *conn = it->value;
+        if (conn->localPort != localPort)
+            continue;
+
+        bool localMatches = conn->localAddr == destAddr;
+        bool localBlank = conn->localAddr.isUnspecified();
+        bool remoteMatches = conn->remoteAddr == srcAddr && conn->remotePort == remotePort;
+        bool remoteBlank = conn->remoteAddr.isUnspecified() && conn->remotePort == -1;
+        int rank = (localMatches && remoteMatches) ? 1 : (localBlank && remoteMatches) ? 2 :
+                   (localMatches && remoteBlank) ? 3 : (localBlank && remoteBlank) ? 4 : 5;
+        if (rank < bestRank)
+        {
+            best = conn;
+            bestRank = rank;
+        }
+    }
+    return best;
 }
 
 TCPConnection *TCP::findConnForApp(int appGateIndex, int connId)
@@ -375,6 +384,27 @@ ushort TCP::getEphemeralPort()
     return lastEphemeralPort;
 }
 
+bool TCP::isFullySpecified(const TCPConnection *conn)
+{
+    return !conn->localAddr.isUnspecified() && !conn->remoteAddr.isUnspecified() && conn->localPort != -1 && conn->remotePort != -1;
+}
+
+void TCP::addToDemuxTables(TCPConnection *conn)
+{
+    if (isFullySpecified(conn))
+        connectedTable.insert(hashSocketPair(conn->localAddr, conn->remoteAddr, conn->localPort, conn->remotePort), conn);
+    else
+        listenerTable.insert(hashInt(conn->localPort), conn);
+}
+
+void TCP::removeFromDemuxTables(TCPConnection *conn)
+{
+    if (isFullySpecified(conn))
+        connectedTable.remove(hashSocketPair(conn->localAddr, conn->remoteAddr, conn->localPort, conn->remotePort), conn);
+    else
+        listenerTable.remove(hashInt(conn->localPort), conn);
+}
+
 void TCP::addSockPair(TCPConnection *conn, IPvXAddress localAddr, IPvXAddress remoteAddr, int localPort, int remotePort)
 {
     // update addresses/ports in TCPConnection
@@ -399,6 +429,7 @@ void TCP::addSockPair(TCPConnection *conn, IPvXAddress localAddr, IPvXAddress re
 
     // then insert it into tcpConnMap
     tcpConnMap[key] = conn;
+    addToDemuxTables(conn);
 
     // mark port as used
     if (localPort >= EPHEMERAL_PORTRANGE_START && localPort < EPHEMERAL_PORTRANGE_END)
@@ -419,6 +450,7 @@ void TCP::updateSockPair(TCPConnection *conn, IPvXAddress localAddr, IPvXAddress
 
     // ...and remove from the old place in tcpConnMap
     tcpConnMap.erase(it);
+    removeFromDemuxTables(conn);
 
     // then update addresses/ports, and re-insert it with new key into tcpConnMap
     key.localAddr = conn->localAddr = localAddr;
@@ -426,6 +458,7 @@ void TCP::updateSockPair(TCPConnection *conn, IPvXAddress localAddr, IPvXAddress
     ASSERT(conn->localPort == localPort);
     key.remotePort = conn->remotePort = remotePort;
     tcpConnMap[key] = conn;
+    addToDemuxTables(conn);
 
     // localPort doesn't change (see ASSERT above), so there's no need to update usedEphemeralPorts[].
 }
@@ -464,7 +497,12 @@ void TCP::removeConnection(TCPConnection *conn)
     key2.remoteAddr = conn->remoteAddr;
     key2.localPort = conn->localPort;
     key2.remotePort = conn->remotePort;
-    tcpConnMap.erase(key2);
+    TcpConnMap::iterator it2 = tcpConnMap.find(key2);
+    if (it2 != tcpConnMap.end() && it2->second == conn)
+    {
+        tcpConnMap.erase(it2);
+        removeFromDemuxTables(conn);
+    }
 
     // IMPORTANT: usedEphemeralPorts.erase(conn->localPort) is NOT GOOD because it
     // deletes ALL occurrences of the port from the multiset.
@@ -547,6 +585,8 @@ void TCP::reset()
         delete it->second;
     tcpAppConnMap.clear();
     tcpConnMap.clear();
+    connectedTable.clear();
+    listenerTable.clear();
     usedEphemeralPorts.clear();
     lastEphemeralPort = EPHEMERAL_PORTRANGE_START;
 }
@@ -24,6 +24,7 @@
 
 #include "INETDefs.h"
 
+#include "HashIndex.h"
 #include "ILifecycle.h"
 #include "IPvXAddress.h"
 #include "TCPCommand_m.h"
@@ -141,9 +142,17 @@ class INET_API TCP : public cSimpleModule, public ILifecycle
     typedef std::map<AppConnKey, TCPConnection*> TcpAppConnMap;
     typedef std::map<SockPair, TCPConnection*> TcpConnMap;
 
+    typedef HashIndex<TCPConnection *> DemuxTable;
+
     TcpAppConnMap tcpAppConnMap;
     TcpConnMap tcpConnMap;
 
+    // index of tcpConnMap for findConnForSegment(): fully specified socket
+    // pairs are hashed by the socket pair, all others (listening sockets and
+    // half-specified ones) by the local port
+    DemuxTable connectedTable;
+    DemuxTable listenerTable;
+
     ushort lastEphemeralPort;
     std::multiset<ushort> usedEphemeralPorts;
 
@@ -158,6 +167,11 @@ class INET_API TCP : public cSimpleModule, public ILifecycle
     virtual void removeConnection(TCPConnection *conn);
     virtual void updateDisplayString();
 
+    // demultiplexing tables
+    static bool isFullySpecified(const TCPConnection *conn);
+    virtual void addToDemuxTables(TCPConnection *conn);
+    virtual void removeFromDemuxTables(TCPConnection *conn);
+
   public:
     static bool testing;    // switches between tcpEV and testingEV
     static bool logverbose; // if !testing, turns on more verbose logging
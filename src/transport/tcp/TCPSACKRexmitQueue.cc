@@ -23,17 +23,22 @@
 TCPSACKRexmitQueue::TCPSACKRexmitQueue()
 {
     conn = NULL;
+    root = NULL;
+    numRegions = 0;
+    randomState = 2463534242u;
     begin = end = 0;
 }
 
 TCPSACKRexmitQueue::~TCPSACKRexmitQueue()
 {
-    while (!rexmitQueue.empty())
-        rexmitQueue.pop_front();
+    deleteSubtree(root);
 }
 
 void TCPSACKRexmitQueue::init(uint32 seqNum)
 {
+    deleteSubtree(root);
+    root = NULL;
+    numRegions = 0;
     begin = seqNum;
     end = seqNum;
 }
@@ -51,119 +56,299 @@ void TCPSACKRexmitQueue::info() const
     tcpEV << str() << endl;
 
     uint j = 1;
+    info(root, begin, j);
+}
 
-    for (RexmitQueue::const_iterator i = rexmitQueue.begin(); i != rexmitQueue.end(); i++)
-    {
-        tcpEV << j << ". region: [" << i->beginSeqNum << ".." << i->endSeqNum
-              << ") \t sacked=" << i->sacked << "\t rexmitted=" << i->rexmitted
-              << endl;
-        j++;
-    }
+void TCPSACKRexmitQueue::info(const Node *node, uint32 regionBegin, uint& j) const
+{
+    if (!node)
+        return;
+
+    pushDown(const_cast<Node *>(node));
+    info(node->left, regionBegin, j);
+    regionBegin += node->left ? node->left->totalLength : 0;
+    tcpEV << j << ". region: [" << regionBegin << ".." << regionBegin + node->length
+          << ") \t sacked=" << node->sacked << "\t rexmitted=" << node->rexmitted
+          << endl;
+    j++;
+    info(node->right, regionBegin + node->length, j);
 }
 
-void TCPSACKRexmitQueue::discardUpTo(uint32 seqNum)
+/****************************************************************
+ * Treap helpers. Queries push the lazy tags down on their way as well;
+ * this doesn't change the contents of the queue, hence the const_casts.
+ */
+TCPSACKRexmitQueue::Node *TCPSACKRexmitQueue::createNode(uint32 length, bool sacked, bool rexmitted)
 {
-    ASSERT(seqLE(begin, seqNum) && seqLE(seqNum, end));
+    // xorshift32
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+
+    Node *node = new Node();
+    node->length = length;
+    node->sacked = sacked;
+    node->rexmitted = rexmitted;
+    node->priority = randomState;
+    node->left = node->right = NULL;
+    node->sackedTag = node->rexmittedTag = -1;
+    update(node);
+    numRegions++;
+    return node;
+}
 
-    if (!rexmitQueue.empty())
+void TCPSACKRexmitQueue::deleteSubtree(Node *node)
+{
+    if (node)
     {
-        RexmitQueue::iterator i = rexmitQueue.begin();
-
-        while ((i != rexmitQueue.end()) && seqLE(i->endSeqNum, seqNum)) // discard/delete regions from rexmit queue, which have been acked
-            i = rexmitQueue.erase(i);
+        deleteSubtree(node->left);
+        deleteSubtree(node->right);
+        delete node;
+        numRegions--;
+    }
+}
 
-        if (i != rexmitQueue.end())
+void TCPSACKRexmitQueue::update(Node *node)
+{
+    node->totalLength = node->length;
+    node->sackedBytes = node->sacked ? node->length : 0;
+    node->rexmittedBytes = node->rexmitted ? node->length : 0;
+    node->unmarkedBytes = (node->sacked || node->rexmitted) ? 0 : node->length;
+
+    RunInfo self;
+    self.empty = false;
+    self.runs = node->sacked ? 1 : 0;
+    self.firstSacked = self.lastSacked = node->sacked;
+    RunInfo runs = combine(combine(runInfo(node->left), self), runInfo(node->right));
+    node->sackedRuns = runs.runs;
+    node->firstSacked = runs.firstSacked;
+    node->lastSacked = runs.lastSacked;
+
+    for (int k = 0; k < 2; k++)
+    {
+        Node *child = k == 0 ? node->left : node->right;
+        if (child)
         {
-            ASSERT(seqLE(i->beginSeqNum, seqNum) && seqLess(seqNum, i->endSeqNum));
-            i->beginSeqNum = seqNum;
+            node->totalLength += child->totalLength;
+            node->sackedBytes += child->sackedBytes;
+            node->rexmittedBytes += child->rexmittedBytes;
+            node->unmarkedBytes += child->unmarkedBytes;
         }
     }
+}
 
-    begin = seqNum;
+void TCPSACKRexmitQueue::applySackedTag(Node *node, bool sacked)
+{
+    if (!node)
+        return;
+
+    node->sacked = sacked;
+    node->sackedTag = sacked;
+    node->sackedBytes = sacked ? node->totalLength : 0;
+    node->unmarkedBytes = sacked ? 0 : node->totalLength - node->rexmittedBytes;
+    node->sackedRuns = sacked ? 1 : 0;
+    node->firstSacked = node->lastSacked = sacked;
+}
 
-    // TESTING queue:
-    ASSERT(checkQueue());
+void TCPSACKRexmitQueue::applyRexmittedTag(Node *node, bool rexmitted)
+{
+    if (!node)
+        return;
+
+    node->rexmitted = rexmitted;
+    node->rexmittedTag = rexmitted;
+    node->rexmittedBytes = rexmitted ? node->totalLength : 0;
+    node->unmarkedBytes = rexmitted ? 0 : node->totalLength - node->sackedBytes;
 }
 
-void TCPSACKRexmitQueue::enqueueSentData(uint32 fromSeqNum, uint32 toSeqNum)
+void TCPSACKRexmitQueue::pushDown(Node *node)
 {
-    ASSERT(seqLE(begin, fromSeqNum) && seqLE(fromSeqNum, end));
+    if (node->sackedTag != -1)
+    {
+        applySackedTag(node->left, node->sackedTag);
+        applySackedTag(node->right, node->sackedTag);
+        node->sackedTag = -1;
+    }
 
-    bool found = false;
-    Region region;
+    if (node->rexmittedTag != -1)
+    {
+        applyRexmittedTag(node->left, node->rexmittedTag);
+        applyRexmittedTag(node->right, node->rexmittedTag);
+        node->rexmittedTag = -1;
+    }
+}
 
-    tcpEV << "rexmitQ: " << str() << " enqueueSentData [" << fromSeqNum << ".." << toSeqNum << ")\n";
+TCPSACKRexmitQueue::RunInfo TCPSACKRexmitQueue::combine(const RunInfo& a, const RunInfo& b)
+{
+    if (a.empty)
+        return b;
+
+    if (b.empty)
+        return a;
+
+    RunInfo result;
+    result.empty = false;
+    result.runs = a.runs + b.runs - ((a.lastSacked && b.firstSacked) ? 1 : 0);
+    result.firstSacked = a.firstSacked;
+    result.lastSacked = b.lastSacked;
+    return result;
+}
 
-    ASSERT(seqLess(fromSeqNum, toSeqNum));
+TCPSACKRexmitQueue::RunInfo TCPSACKRexmitQueue::runInfo(const Node *node)
+{
+    RunInfo result;
 
-    if (rexmitQueue.empty() || (end == fromSeqNum))
+    if (node)
     {
-        region.beginSeqNum = fromSeqNum;
-        region.endSeqNum = toSeqNum;
-        region.sacked = false;
-        region.rexmitted = false;
-        rexmitQueue.push_back(region);
-        found = true;
-        fromSeqNum = toSeqNum;
+        result.empty = false;
+        result.runs = node->sackedRuns;
+        result.firstSacked = node->firstSacked;
+        result.lastSacked = node->lastSacked;
+    }
+
+    return result;
+}
+
+TCPSACKRexmitQueue::Node *TCPSACKRexmitQueue::merge(Node *a, Node *b)
+{
+    if (!a)
+        return b;
+
+    if (!b)
+        return a;
+
+    if (a->priority > b->priority)
+    {
+        pushDown(a);
+        a->right = merge(a->right, b);
+        update(a);
+        return a;
     }
     else
     {
-        RexmitQueue::iterator i = rexmitQueue.begin();
+        pushDown(b);
+        b->left = merge(a, b->left);
+        update(b);
+        return b;
+    }
+}
+
+/**
+ * Splits the regions into the first 'offset' bytes and the rest; the
+ * region containing the boundary is cut in two.
+ */
+void TCPSACKRexmitQueue::split(Node *node, uint32 offset, Node *&left, Node *&right)
+{
+    if (!node)
+    {
+        left = right = NULL;
+        return;
+    }
 
-        while (i != rexmitQueue.end() && seqLE(i->endSeqNum, fromSeqNum))
-            i++;
+    pushDown(node);
+    uint32 leftLength = node->left ? node->left->totalLength : 0;
 
-        ASSERT(i != rexmitQueue.end());
-        ASSERT(seqLE(i->beginSeqNum, fromSeqNum) && seqLess(fromSeqNum, i->endSeqNum));
+    if (offset <= leftLength)
+    {
+        split(node->left, offset, left, node->left);
+        update(node);
+        right = node;
+    }
+    else if (offset >= leftLength + node->length)
+    {
+        split(node->right, offset - leftLength - node->length, node->right, right);
+        update(node);
+        left = node;
+    }
+    else
+    {
+        Node *tail = createNode(leftLength + node->length - offset, node->sacked, node->rexmitted);
+        node->length = offset - leftLength;
+        right = merge(tail, node->right);
+        node->right = NULL;
+        update(node);
+        left = node;
+    }
+}
+
+/**
+ * Returns the region containing the given offset, and the offset of its first byte.
+ */
+const TCPSACKRexmitQueue::Node *TCPSACKRexmitQueue::findRegion(uint32 offset, uint32& regionBegin) const
+{
+    ASSERT(root && offset < root->totalLength);
 
-        if (i->beginSeqNum != fromSeqNum)
+    Node *node = root;
+    regionBegin = 0;
+
+    while (true)
+    {
+        pushDown(node);
+        uint32 leftLength = node->left ? node->left->totalLength : 0;
+
+        if (offset < leftLength)
+            node = node->left;
+        else if (offset < leftLength + node->length)
         {
-            // chunk item
-            region = *i;
-            region.endSeqNum = fromSeqNum;
-            rexmitQueue.insert(i, region);
-            i->beginSeqNum = fromSeqNum;
+            regionBegin += leftLength;
+            return node;
         }
-
-        while (i != rexmitQueue.end() && seqLE(i->endSeqNum, toSeqNum))
+        else
         {
-            i->rexmitted = true;
-            fromSeqNum = i->endSeqNum;
-            found = true;
-            i++;
+            offset -= leftLength + node->length;
+            regionBegin += leftLength + node->length;
+            node = node->right;
         }
+    }
+}
 
-        if (fromSeqNum != toSeqNum)
-        {
-            bool beforeEnd = (i != rexmitQueue.end());
+/****************************************************************/
+
+void TCPSACKRexmitQueue::discardUpTo(uint32 seqNum)
+{
+    ASSERT(seqLE(begin, seqNum) && seqLE(seqNum, end));
 
-            ASSERT(i == rexmitQueue.end() || seqLess(i->beginSeqNum, toSeqNum));
+    // discard/delete regions from rexmit queue, which have been acked
+    Node *acked;
+    split(root, seqNum - begin, acked, root);
+    deleteSubtree(acked);
 
-            region.beginSeqNum = fromSeqNum;
-            region.endSeqNum = toSeqNum;
-            region.sacked = beforeEnd ? i->sacked : false;
-            region.rexmitted = beforeEnd;
-            rexmitQueue.insert(i, region);
-            found = true;
-            fromSeqNum = toSeqNum;
+    begin = seqNum;
 
-            if (beforeEnd)
-                i->beginSeqNum = toSeqNum;
-        }
-    }
+    // TESTING queue:
+    ASSERT(checkQueue());
+}
+
+void TCPSACKRexmitQueue::enqueueSentData(uint32 fromSeqNum, uint32 toSeqNum)
+{
+    ASSERT(seqLE(begin, fromSeqNum) && seqLE(fromSeqNum, end));
+
+    tcpEV << "rexmitQ: " << str() << " enqueueSentData [" << fromSeqNum << ".." << toSeqNum << ")\n";
 
-    ASSERT(fromSeqNum == toSeqNum);
+    ASSERT(seqLess(fromSeqNum, toSeqNum));
+
+    if (!root)
+        begin = end = fromSeqNum;
 
-    if (!found)
+    if (fromSeqNum != end)
     {
-        EV << "Not found enqueueSentData(" << fromSeqNum << ", " << toSeqNum << ")\nThe Queue is:\n";
-        info();
+        // retransmission: set the rexmitted bit of the stored part of the range
+        uint32 toStored = seqLess(toSeqNum, end) ? toSeqNum : end;
+        Node *before, *range, *after;
+        split(root, fromSeqNum - begin, before, range);
+        split(range, toStored - fromSeqNum, range, after);
+        applyRexmittedTag(range, true);
+        root = merge(merge(before, range), after);
+        fromSeqNum = toStored;
     }
 
-    ASSERT(found);
-
-    begin = rexmitQueue.front().beginSeqNum;
-    end = rexmitQueue.back().endSeqNum;
+    if (fromSeqNum != toSeqNum)
+    {
+        // new data
+        ASSERT(fromSeqNum == end);
+        root = merge(root, createNode(toSeqNum - fromSeqNum, false, false));
+        end = toSeqNum;
+    }
 
     // TESTING queue:
     ASSERT(checkQueue());
@@ -173,17 +358,8 @@ void TCPSACKRexmitQueue::enqueueSentData(uint32 fromSeqNum, uint32 toSeqNum)
 
 bool TCPSACKRexmitQueue::checkQueue() const
 {
-    uint32 b = begin;
-    bool f = true;
-
-    for (RexmitQueue::const_iterator i = rexmitQueue.begin(); i != rexmitQueue.end(); i++)
-    {
-        f = f && (b == i->beginSeqNum);
-        f = f && seqLess(i->beginSeqNum, i->endSeqNum);
-        b = i->endSeqNum;
-    }
-
-    f = f && (b == end);
+    // the regions are contiguous by construction, only the total length needs checking
+    bool f = (root ? root->totalLength : 0) == end - begin;
 
     if (!f)
     {
@@ -203,50 +379,11 @@ void TCPSACKRexmitQueue::setSackedBit(uint32 fromSeqNum, uint32 toSeqNum)
     ASSERT(seqLess(begin, toSeqNum) && seqLE(toSeqNum, end));
     ASSERT(seqLess(fromSeqNum, toSeqNum));
 
-    bool found = false;
-
-    if (!rexmitQueue.empty())
-    {
-        RexmitQueue::iterator i = rexmitQueue.begin();
-
-        while (i != rexmitQueue.end() && seqLE(i->endSeqNum, fromSeqNum))
-            i++;
-
-        ASSERT(i != rexmitQueue.end() && seqLE(i->beginSeqNum, fromSeqNum) && seqLess(fromSeqNum, i->endSeqNum));
-
-        if (i->beginSeqNum != fromSeqNum)
-        {
-            Region region = *i;
-
-            region.endSeqNum = fromSeqNum;
-            rexmitQueue.insert(i, region);
-            i->beginSeqNum = fromSeqNum;
-        }
-
-        while (i != rexmitQueue.end() && seqLE(i->endSeqNum, toSeqNum))
-        {
-            if (seqGE(i->beginSeqNum, fromSeqNum)) // Search region in queue!
-            {
-                found = true;
-                i->sacked = true; // set sacked bit
-            }
-
-            i++;
-        }
-
-        if (i != rexmitQueue.end() && seqLess(i->beginSeqNum, toSeqNum) && seqLess(toSeqNum, i->endSeqNum))
-        {
-            Region region = *i;
-
-            region.endSeqNum = toSeqNum;
-            region.sacked = true;
-            rexmitQueue.insert(i, region);
-            i->beginSeqNum = toSeqNum;
-        }
-    }
-
-    if (!found)
-        tcpEV << "FAILED to set sacked bit for region: [" << fromSeqNum << ".." << toSeqNum << "). Not found in retransmission queue.\n";
+    Node *before, *range, *after;
+    split(root, fromSeqNum - begin, before, range);
+    split(range, toSeqNum - fromSeqNum, range, after);
+    applySackedTag(range, true);
+    root = merge(merge(before, range), after);
 
     ASSERT(checkQueue());
 }
@@ -255,25 +392,33 @@ bool TCPSACKRexmitQueue::getSackedBit(uint32 seqNum) const
 {
     ASSERT(seqLE(begin, seqNum) && seqLE(seqNum, end));
 
-    RexmitQueue::const_iterator i = rexmitQueue.begin();
-
     if (end == seqNum)
         return false;
 
-    while (i != rexmitQueue.end() && seqLE(i->endSeqNum, seqNum))
-        i++;
-
-    ASSERT((i != rexmitQueue.end()) && seqLE(i->beginSeqNum, seqNum) && seqLess(seqNum, i->endSeqNum));
-
-    return i->sacked;
+    uint32 regionBegin;
+    return findRegion(seqNum - begin, regionBegin)->sacked;
 }
 
 uint32 TCPSACKRexmitQueue::getHighestSackedSeqNum() const
 {
-    for (RexmitQueue::const_reverse_iterator i = rexmitQueue.rbegin(); i != rexmitQueue.rend(); i++)
+    // the end of the last sacked region
+    Node *node = root;
+    uint32 offset = 0;
+
+    while (node && node->sackedBytes > 0)
     {
-        if (i->sacked)
-            return i->endSeqNum;
+        pushDown(node);
+        uint32 leftLength = node->left ? node->left->totalLength : 0;
+
+        if (node->right && node->right->sackedBytes > 0)
+        {
+            offset += leftLength + node->length;
+            node = node->right;
+        }
+        else if (node->sacked)
+            return begin + offset + leftLength + node->length;
+        else
+            node = node->left;
     }
 
     return begin;
@@ -281,10 +426,24 @@ uint32 TCPSACKRexmitQueue::getHighestSackedSeqNum() const
 
 uint32 TCPSACKRexmitQueue::getHighestRexmittedSeqNum() const
 {
-    for (RexmitQueue::const_reverse_iterator i = rexmitQueue.rbegin(); i != rexmitQueue.rend(); i++)
+    // the end of the last rexmitted region
+    Node *node = root;
+    uint32 offset = 0;
+
+    while (node && node->rexmittedBytes > 0)
     {
-        if (i->rexmitted)
-            return i->endSeqNum;
+        pushDown(node);
+        uint32 leftLength = node->left ? node->left->totalLength : 0;
+
+        if (node->right && node->right->rexmittedBytes > 0)
+        {
+            offset += leftLength + node->length;
+            node = node->right;
+        }
+        else if (node->rexmitted)
+            return begin + offset + leftLength + node->length;
+        else
+            node = node->left;
     }
 
     return begin;
@@ -294,115 +453,144 @@ uint32 TCPSACKRexmitQueue::checkRexmitQueueForSackedOrRexmittedSegments(uint32 f
 {
     ASSERT(seqLE(begin, fromSeqNum) && seqLE(fromSeqNum, end));
 
-    if (rexmitQueue.empty() || (end == fromSeqNum))
+    if (!root || (end == fromSeqNum))
         return 0;
 
-    RexmitQueue::const_iterator i = rexmitQueue.begin();
-    uint32 bytes = 0;
+    // the contiguous sacked or rexmitted bytes end at the first region that is neither
+    uint32 fromOffset = fromSeqNum - begin;
+    uint32 unmarkedOffset;
 
-    while (i != rexmitQueue.end() && seqLE(i->endSeqNum, fromSeqNum))
-        i++;
+    if (!findUnmarkedRegion(root, 0, fromOffset, unmarkedOffset))
+        unmarkedOffset = root->totalLength;
 
-    while (i != rexmitQueue.end() && ((i->sacked || i->rexmitted)))
-    {
-        ASSERT(seqLE(i->beginSeqNum, fromSeqNum) && seqLess(fromSeqNum, i->endSeqNum));
+    return (fromOffset < unmarkedOffset) ? unmarkedOffset - fromOffset : 0;
+}
 
-        bytes += (i->endSeqNum - fromSeqNum);
-        fromSeqNum = i->endSeqNum;
-        i++;
+/**
+ * Finds the first region of the subtree that is neither sacked nor rexmitted
+ * and ends after fromOffset. 'offset' is the offset of the subtree's first byte.
+ */
+bool TCPSACKRexmitQueue::findUnmarkedRegion(const Node *node, uint32 offset, uint32 fromOffset, uint32& regionBegin) const
+{
+    if (!node || node->unmarkedBytes == 0 || offset + node->totalLength <= fromOffset)
+        return false;
+
+    pushDown(const_cast<Node *>(node));
+
+    if (findUnmarkedRegion(node->left, offset, fromOffset, regionBegin))
+        return true;
+
+    uint32 nodeBegin = offset + (node->left ? node->left->totalLength : 0);
+    uint32 nodeEnd = nodeBegin + node->length;
+
+    if (!node->sacked && !node->rexmitted && fromOffset < nodeEnd)
+    {
+        regionBegin = nodeBegin;
+        return true;
     }
 
-    return bytes;
+    return findUnmarkedRegion(node->right, nodeEnd, fromOffset, regionBegin);
 }
 
 void TCPSACKRexmitQueue::resetSackedBit()
 {
-    for (RexmitQueue::iterator i = rexmitQueue.begin(); i != rexmitQueue.end(); i++)
-        i->sacked = false; // reset sacked bit
+    applySackedTag(root, false); // reset sacked bit
 }
 
 void TCPSACKRexmitQueue::resetRexmittedBit()
 {
-    for (RexmitQueue::iterator i = rexmitQueue.begin(); i != rexmitQueue.end(); i++)
-        i->rexmitted = false; // reset rexmitted bit
+    applyRexmittedTag(root, false); // reset rexmitted bit
 }
 
 uint32 TCPSACKRexmitQueue::getTotalAmountOfSackedBytes() const
 {
-    uint32 bytes = 0;
-
-    for (RexmitQueue::const_iterator i = rexmitQueue.begin(); i != rexmitQueue.end(); i++)
-    {
-        if (i->sacked)
-            bytes += (i->endSeqNum - i->beginSeqNum);
-    }
-
-    return bytes;
+    return root ? root->sackedBytes : 0;
 }
 
 uint32 TCPSACKRexmitQueue::getAmountOfSackedBytes(uint32 fromSeqNum) const
 {
     ASSERT(seqLE(begin, fromSeqNum) && seqLE(fromSeqNum, end));
 
-    uint32 bytes = 0;
-    RexmitQueue::const_reverse_iterator i = rexmitQueue.rbegin();
+    // total minus the sacked bytes below fromSeqNum
+    uint32 offset = fromSeqNum - begin;
+    uint32 bytesBelow = 0;
+    const Node *node = root;
 
-    for (; i != rexmitQueue.rend() && seqLE(fromSeqNum, i->beginSeqNum); i++)
+    while (node)
     {
-        if (i->sacked)
-            bytes += (i->endSeqNum - i->beginSeqNum);
-    }
+        pushDown(const_cast<Node *>(node));
+        uint32 leftLength = node->left ? node->left->totalLength : 0;
 
-    if ( i != rexmitQueue.rend()
-            && seqLess(i->beginSeqNum, fromSeqNum) && seqLess(fromSeqNum, i->endSeqNum) && i->sacked)
-    {
-        bytes += (i->endSeqNum - fromSeqNum);
+        if (offset <= leftLength)
+            node = node->left;
+        else
+        {
+            uint32 leftSacked = node->left ? node->left->sackedBytes : 0;
+
+            if (offset < leftLength + node->length)
+            {
+                bytesBelow += leftSacked + (node->sacked ? offset - leftLength : 0);
+                break;
+            }
+
+            bytesBelow += leftSacked + (node->sacked ? node->length : 0);
+            offset -= leftLength + node->length;
+            node = node->right;
+        }
     }
 
-    return bytes;
+    return getTotalAmountOfSackedBytes() - bytesBelow;
 }
 
 uint32 TCPSACKRexmitQueue::getNumOfDiscontiguousSacks(uint32 fromSeqNum) const
 {
     ASSERT(seqLE(begin, fromSeqNum) && seqLE(fromSeqNum, end));
 
-    if (rexmitQueue.empty() || (fromSeqNum == end))
+    if (!root || (fromSeqNum == end))
         return 0;
 
-    RexmitQueue::const_iterator i = rexmitQueue.begin();
-    uint32 counter = 0;
-
-    while (i != rexmitQueue.end() && seqLE(i->endSeqNum, fromSeqNum)) // search for seqNum
-        i++;
-
-    // search for discontiguous sacked regions
-    bool prevSacked = false;
+    // count the sacked runs in the regions before the one containing fromSeqNum
+    uint32 offset = fromSeqNum - begin;
+    RunInfo before;
+    const Node *node = root;
 
-    while (i != rexmitQueue.end())
+    while (true)
     {
-        if (i->sacked && !prevSacked)
-            counter++;
-
-        prevSacked = i->sacked;
-        i++;
+        pushDown(const_cast<Node *>(node));
+        uint32 leftLength = node->left ? node->left->totalLength : 0;
+
+        if (offset < leftLength)
+            node = node->left;
+        else if (offset < leftLength + node->length)
+            break;
+        else
+        {
+            RunInfo self;
+            self.empty = false;
+            self.runs = node->sacked ? 1 : 0;
+            self.firstSacked = self.lastSacked = node->sacked;
+            before = combine(combine(before, runInfo(node->left)), self);
+            offset -= leftLength + node->length;
+            node = node->right;
+        }
     }
 
-    return counter;
+    before = combine(before, runInfo(node->left));
+
+    // a run crossing the boundary is counted in both parts
+    bool joined = !before.empty && before.lastSacked && node->sacked;
+    return root->sackedRuns - before.runs + (joined ? 1 : 0);
 }
 
 void TCPSACKRexmitQueue::checkSackBlock(uint32 fromSeqNum, uint32 &length, bool &sacked, bool &rexmitted) const
 {
     ASSERT(seqLE(begin, fromSeqNum) && seqLess(fromSeqNum, end));
 
-    RexmitQueue::const_iterator i = rexmitQueue.begin();
-
-    while (i != rexmitQueue.end() && seqLE(i->endSeqNum, fromSeqNum)) // search for seqNum
-        i++;
-
-    ASSERT(i != rexmitQueue.end());
-    ASSERT(seqLE(i->beginSeqNum, fromSeqNum) && seqLess(fromSeqNum, i->endSeqNum));
+    uint32 offset = fromSeqNum - begin;
+    uint32 regionBegin;
+    const Node *region = findRegion(offset, regionBegin);
 
-    length = (i->endSeqNum - fromSeqNum);
-    sacked = i->sacked;
-    rexmitted = i->rexmitted;
+    length = (regionBegin + region->length - offset);
+    sacked = region->sacked;
+    rexmitted = region->rexmitted;
 }
@@ -26,22 +26,57 @@
 
 /**
  * Retransmission data for SACK.
+ *
+ * The queue is a sequence of contiguous, non-overlapping regions covering
+ * [begin..end), each with a sacked and a rexmitted bit. The regions are
+ * stored in a treap ordered by sequence number, where every node caches
+ * aggregates of its subtree (length, sacked and rexmitted byte counts,
+ * number of sacked runs). Setting or resetting the bits of a sequence
+ * range is done with lazy tags, so every operation that is invoked per
+ * ACK runs in O(log n) time, n being the number of regions.
  */
 class INET_API TCPSACKRexmitQueue
 {
   public:
     TCPConnection *conn;  // the connection that owns this queue
 
-    struct Region
+  protected:
+    struct Node
     {
-        uint32 beginSeqNum;
-        uint32 endSeqNum;
-        bool sacked;      // indicates whether region has already been sacked by data receiver
-        bool rexmitted;   // indicates whether region has already been retransmitted by data sender
+        uint32 length;     // number of bytes in the region
+        bool sacked;       // indicates whether region has already been sacked by data receiver
+        bool rexmitted;    // indicates whether region has already been retransmitted by data sender
+        uint32 priority;   // treap priority
+        Node *left;
+        Node *right;
+
+        // aggregates of the subtree, including this node
+        uint32 totalLength;
+        uint32 sackedBytes;
+        uint32 rexmittedBytes;
+        uint32 unmarkedBytes;  // neither sacked nor rexmitted
+        uint32 sackedRuns;     // number of maximal runs of sacked regions
+        bool firstSacked;      // the sacked bit of the first region of the subtree
+        bool lastSacked;       // the sacked bit of the last region of the subtree
+
+        // pending assignment of the bits in the subtrees (-1: none)
+        signed char sackedTag;
+        signed char rexmittedTag;
     };
 
-    typedef std::list<Region> RexmitQueue;
-    RexmitQueue rexmitQueue; // rexmitQueue is ordered by seqnum, and doesn't have overlapped Regions
+    // number of sacked runs in a sequence of regions, see combine()
+    struct RunInfo
+    {
+        bool empty;
+        uint32 runs;
+        bool firstSacked;
+        bool lastSacked;
+        RunInfo() : empty(true), runs(0), firstSacked(false), lastSacked(false) {}
+    };
+
+    Node *root;          // regions ordered by sequence number, NULL if empty
+    uint32 numRegions;
+    uint32 randomState;  // for the treap priorities; does not use the simulation RNGs
 
     uint32 begin;  // 1st sequence number stored
     uint32 end;    // last sequence number stored + 1
@@ -120,7 +155,7 @@ class INET_API TCPSACKRexmitQueue
     /**
      * Returns the number of blocks currently buffered in queue.
      */
-    virtual uint32 getQueueLength() const { return rexmitQueue.size(); }
+    virtual uint32 getQueueLength() const { return numRegions; }
 
     /**
      * Returns the highest sequence number sacked by data receiver.
@@ -177,6 +212,21 @@ class INET_API TCPSACKRexmitQueue
      * Returns if TCPSACKRexmitQueue is valid or not.
      */
     bool checkQueue() const;
+
+    // treap helpers, sequence numbers are represented by their offset from 'begin'
+    Node *createNode(uint32 length, bool sacked, bool rexmitted);
+    void deleteSubtree(Node *node);
+    static void update(Node *node);
+    static void applySackedTag(Node *node, bool sacked);
+    static void applyRexmittedTag(Node *node, bool rexmitted);
+    static void pushDown(Node *node);
+    static RunInfo combine(const RunInfo& a, const RunInfo& b);
+    static RunInfo runInfo(const Node *node);
+    Node *merge(Node *a, Node *b);
+    void split(Node *node, uint32 offset, Node *&left, Node *&right);
+    const Node *findRegion(uint32 offset, uint32& regionBegin) const;
+    bool findUnmarkedRegion(const Node *node, uint32 offset, uint32 fromOffset, uint32& regionBegin) const;
+    void info(const Node *node, uint32 regionBegin, uint& j) const;
 };
 
 #endif
@@ -43,19 +43,20 @@ bool TCPByteStreamRcvQueue::Region::merge(const TCPVirtualDataRcvQueue::Region*
 
     if (nbegin != begin || nend != end)
     {
-        char *buff = new char[nend-nbegin];
+        // own bytes first, the other's bytes only outside of them
+        ByteArray ndata;
 
         if (nbegin != begin)
-            other->data.copyDataToBuffer(buff, begin - nbegin);
+            ndata.setDataFromByteArray(other->data, 0, begin - nbegin);
 
-        data.copyDataToBuffer(buff + begin - nbegin, end - begin);
+        ndata.addDataFromByteArray(data, 0, end - begin);
 
         if (nend != end)
-            other->data.copyDataToBuffer(buff + end - nbegin, nend - end);
+            ndata.addDataFromByteArray(other->data, end - other->begin, nend - end);
 
         begin = nbegin;
         end = nend;
-        data.assignBuffer(buff, end - begin);
+        data = ndata;
     }
 
     return true;
@@ -93,12 +94,12 @@ std::string TCPByteStreamRcvQueue::info() const
 
     os << "rcv_nxt=" << rcv_nxt;
 
-    for (RegionList::const_iterator i=regionList.begin(); i!=regionList.end(); ++i)
+    for (RegionMap::const_iterator i=regionMap.begin(); i!=regionMap.end(); ++i)
     {
-        os << " [" << (*i)->getBegin() << ".." << (*i)->getEnd() <<")";
+        os << " [" << i->second->getBegin() << ".." << i->second->getEnd() <<")";
     }
 
-    os << " " << regionList.size() << "msgs";
+    os << " " << regionMap.size() << "msgs";
 
     return os.str();
 }
@@ -31,13 +31,12 @@ TCPMsgBasedRcvQueue::TCPMsgBasedRcvQueue() : TCPVirtualDataRcvQueue()
 
 TCPMsgBasedRcvQueue::~TCPMsgBasedRcvQueue()
 {
-    while (! payloadList.empty())
+    for (PayloadMap::iterator i = payloadMap.begin(); i != payloadMap.end(); ++i)
     {
         EV << "SendQueue Destructor: Drop msg from " << this->getFullPath() <<
-                " Queue: offset=" << payloadList.front().seqNo <<
-                ", length=" << payloadList.front().packet->getByteLength() << endl;
-        delete payloadList.front().packet;
-        payloadList.pop_front();
+                " Queue: offset=" << i->first <<
+                ", length=" << i->second->getByteLength() << endl;
+        delete i->second;
     }
 }
 
@@ -52,12 +51,12 @@ std::string TCPMsgBasedRcvQueue::info() const
 
     os << "rcv_nxt=" << rcv_nxt;
 
-    for (RegionList::const_iterator i = regionList.begin(); i != regionList.end(); ++i)
+    for (RegionMap::const_iterator i = regionMap.begin(); i != regionMap.end(); ++i)
     {
-        os << " [" << (*i)->getBegin() << ".." << (*i)->getEnd() << ")";
+        os << " [" << i->second->getBegin() << ".." << i->second->getEnd() << ")";
     }
 
-    os << " " << payloadList.size() << " msgs";
+    os << " " << payloadMap.size() << " msgs";
 
     return os.str();
 }
@@ -68,20 +67,11 @@ uint32 TCPMsgBasedRcvQueue::insertBytesFromSegment(TCPSegment *tcpseg)
 
     cPacket *msg;
     uint32 endSeqNo;
-    PayloadList::iterator i = payloadList.begin();
     while (NULL != (msg = tcpseg->removeFirstPayloadMessage(endSeqNo)))
     {
-        while (i != payloadList.end() && seqLess(i->seqNo, endSeqNo))
-            ++i;
-
         // insert, avoiding duplicates
-        if (i != payloadList.end() && i->seqNo == endSeqNo)
+        if (!payloadMap.insert(std::make_pair(endSeqNo, msg)).second)
             delete msg;
-        else
-        {
-            i = payloadList.insert(i,PayloadItem(endSeqNo, msg));
-            ASSERT(seqLE(payloadList.front().seqNo, payloadList.back().seqNo));
-        }
     }
 
     return rcv_nxt;
@@ -90,16 +80,16 @@ uint32 TCPMsgBasedRcvQueue::insertBytesFromSegment(TCPSegment *tcpseg)
 cPacket *TCPMsgBasedRcvQueue::extractBytesUpTo(uint32 seq)
 {
     cPacket *msg = NULL;
-    if (!payloadList.empty() && seqLess(payloadList.begin()->seqNo, seq))
-        seq = payloadList.begin()->seqNo;
+    if (!payloadMap.empty() && seqLess(payloadMap.begin()->first, seq))
+        seq = payloadMap.begin()->first;
 
     Region *reg = extractTo(seq);
     if (reg)
     {
-        if (!payloadList.empty() && payloadList.begin()->seqNo == reg->getEnd())
+        if (!payloadMap.empty() && payloadMap.begin()->first == reg->getEnd())
         {
-            msg = payloadList.begin()->packet;
-            payloadList.erase(payloadList.begin());
+            msg = payloadMap.begin()->second;
+            payloadMap.erase(payloadMap.begin());
         }
         delete reg;
     }
@@ -32,14 +32,8 @@
 class INET_API TCPMsgBasedRcvQueue : public TCPVirtualDataRcvQueue
 {
   protected:
-    struct PayloadItem
-    {
-        uint32  seqNo;
-        cPacket *packet;
-        PayloadItem(uint32  _seqNo, cPacket *_packet) : seqNo(_seqNo), packet(_packet) {}
-    };
-    typedef std::list<PayloadItem> PayloadList;
-    PayloadList payloadList;    // sorted list, used the sequence number comparators
+    typedef std::map<uint32, cPacket *, SeqLess> PayloadMap;
+    PayloadMap payloadMap;    // packets indexed by their end sequence number
 
   public:
     /**
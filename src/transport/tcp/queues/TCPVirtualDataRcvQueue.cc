@@ -76,26 +76,26 @@ ulong TCPVirtualDataRcvQueue::Region::getLengthTo(uint32 seq) const
 
 TCPVirtualDataRcvQueue::TCPVirtualDataRcvQueue() : TCPReceiveQueue()
 {
+    bufferedBytes = 0;
 }
 
 TCPVirtualDataRcvQueue::~TCPVirtualDataRcvQueue()
 {
-    while (!regionList.empty())
-    {
-        delete regionList.front();
-        regionList.pop_front();
-    }
+    clear();
 }
 
 void TCPVirtualDataRcvQueue::init(uint32 startSeq)
 {
     rcv_nxt = startSeq;
+    clear();
+}
 
-    while (!regionList.empty())
-    {
-        delete regionList.front();
-        regionList.pop_front();
-    }
+void TCPVirtualDataRcvQueue::clear()
+{
+    for (RegionMap::iterator i = regionMap.begin(); i != regionMap.end(); ++i)
+        delete i->second;
+    regionMap.clear();
+    bufferedBytes = 0;
 }
 
 std::string TCPVirtualDataRcvQueue::info() const
@@ -105,9 +105,9 @@ std::string TCPVirtualDataRcvQueue::info() const
     sprintf(buf, "rcv_nxt=%u", rcv_nxt);
     res = buf;
 
-    for (RegionList::const_iterator i=regionList.begin(); i!=regionList.end(); ++i)
+    for (RegionMap::const_iterator i=regionMap.begin(); i!=regionMap.end(); ++i)
     {
-        sprintf(buf, " [%u..%u)", (*i)->getBegin(), (*i)->getEnd());
+        sprintf(buf, " [%u..%u)", i->second->getBegin(), i->second->getEnd());
         res += buf;
     }
     return res;
@@ -123,10 +123,10 @@ uint32 TCPVirtualDataRcvQueue::insertBytesFromSegment(TCPSegment *tcpseg)
     Region *region = createRegionFromSegment(tcpseg);
 
 #ifndef NDEBUG
-    if (!regionList.empty())
+    if (!regionMap.empty())
     {
-        uint32 ob = regionList.front()->getBegin();
-        uint32 oe = regionList.back()->getEnd();
+        uint32 ob = regionMap.begin()->second->getBegin();
+        uint32 oe = regionMap.rbegin()->second->getEnd();
         uint32 nb = region->getBegin();
         uint32 ne = region->getEnd();
         uint32 minb = seqMin(ob, nb);
@@ -139,8 +139,9 @@ uint32 TCPVirtualDataRcvQueue::insertBytesFromSegment(TCPSegment *tcpseg)
 
     merge(region);
 
-    if (seqGE(rcv_nxt, regionList.front()->getBegin()))
-        rcv_nxt = regionList.front()->getEnd();
+    Region *first = regionMap.begin()->second;
+    if (seqGE(rcv_nxt, first->getBegin()))
+        rcv_nxt = first->getEnd();
 
     return rcv_nxt;
 }
@@ -153,26 +154,22 @@ void TCPVirtualDataRcvQueue::merge(TCPVirtualDataRcvQueue::Region *seg)
     // existing regions; we also may have to merge existing regions if
     // they become overlapping (or touching) after adding tcpseg.
 
-    RegionList::reverse_iterator i = regionList.rbegin();
-    Region::CompareStatus cmp;
+    // the first region that ends at or after the start of seg, and the
+    // following ones up to the end of seg overlap or touch it
+    RegionMap::iterator i = regionMap.lower_bound(seg->getBegin());
 
-    while (i != regionList.rend() && Region::BEFORE != (cmp = (*i)->compare(*seg)))
+    while (i != regionMap.end() && seqLE(i->second->getBegin(), seg->getEnd()))
     {
-        if (cmp != Region::AFTER)
-        {
-            if (seg->merge(*i))
-            {
-                delete *i;
-                i = (RegionList::reverse_iterator)(regionList.erase((++i).base()));
-                continue;
-            }
-            else
-                throw cRuntimeError("Model error: merge of region [%u,%u) with [%u,%u) unsuccessful", (*i)->getBegin(), (*i)->getEnd(), seg->getBegin(), seg->getEnd());
-        }
-        ++i;
+        Region *reg = i->second;
+        if (!seg->merge(reg))
+            throw cRuntimeError("Model error: merge of region [%u,%u) with [%u,%u) unsuccessful", reg->getBegin(), reg->getEnd(), seg->getBegin(), seg->getEnd());
+        bufferedBytes -= reg->getLength();
+        delete reg;
+        regionMap.erase(i++);
     }
 
-    regionList.insert(i.base(), seg);
+    regionMap.insert(i, std::make_pair(seg->getEnd(), seg));
+    bufferedBytes += seg->getLength();
 }
 
 cPacket *TCPVirtualDataRcvQueue::extractBytesUpTo(uint32 seq)
@@ -193,10 +190,10 @@ TCPVirtualDataRcvQueue::Region* TCPVirtualDataRcvQueue::extractTo(uint32 seq)
 {
     ASSERT(seqLE(seq, rcv_nxt));
 
-    if (regionList.empty())
+    if (regionMap.empty())
         return NULL;
 
-    Region *reg = regionList.front();
+    Region *reg = regionMap.begin()->second;
     uint32 beg = reg->getBegin();
 
     if (seqLE(seq, beg))
@@ -204,21 +201,20 @@ TCPVirtualDataRcvQueue::Region* TCPVirtualDataRcvQueue::extractTo(uint32 seq)
 
     if (seqGE(seq, reg->getEnd()))
     {
-        regionList.pop_front();
+        regionMap.erase(regionMap.begin());
+        bufferedBytes -= reg->getLength();
         return reg;
     }
 
-    return reg->split(seq);
+    // the end of the region, i.e. its key, does not change
+    Region *head = reg->split(seq);
+    bufferedBytes -= head->getLength();
+    return head;
 }
 
 uint32 TCPVirtualDataRcvQueue::getAmountOfBufferedBytes()
 {
-    uint32 bytes = 0;
-
-    for (RegionList::iterator i = regionList.begin(); i != regionList.end(); i++)
-        bytes += (*i)->getLength();
-
-    return bytes;
+    return bufferedBytes;
 }
 
 uint32 TCPVirtualDataRcvQueue::getAmountOfFreeBytes(uint32 maxRcvBuffer)
@@ -230,28 +226,24 @@ uint32 TCPVirtualDataRcvQueue::getAmountOfFreeBytes(uint32 maxRcvBuffer)
 
 uint32 TCPVirtualDataRcvQueue::getQueueLength()
 {
-    return regionList.size();
+    return regionMap.size();
 }
 
 void TCPVirtualDataRcvQueue::getQueueStatus()
 {
-    tcpEV << "receiveQLength=" << regionList.size() << " " << info() << "\n";
+    tcpEV << "receiveQLength=" << regionMap.size() << " " << info() << "\n";
 }
 
 
 uint32 TCPVirtualDataRcvQueue::getLE(uint32 fromSeqNum)
 {
-    RegionList::iterator i = regionList.begin();
+    // the first region that ends after fromSeqNum
+    RegionMap::iterator i = regionMap.upper_bound(fromSeqNum);
 
-    while (i != regionList.end())
+    if (i != regionMap.end() && seqLE(i->second->getBegin(), fromSeqNum))
     {
-        if (seqLE((*i)->getBegin(), fromSeqNum) && seqLess(fromSeqNum, (*i)->getEnd()))
-        {
-//            tcpEV << "Enqueued region: [" << i->begin << ".." << i->end << ")\n";
-            return (*i)->getBegin();
-        }
-
-        i++;
+//        tcpEV << "Enqueued region: [" << i->second->getBegin() << ".." << i->second->getEnd() << ")\n";
+        return i->second->getBegin();
     }
 
     return fromSeqNum;
@@ -259,17 +251,13 @@ uint32 TCPVirtualDataRcvQueue::getLE(uint32 fromSeqNum)
 
 uint32 TCPVirtualDataRcvQueue::getRE(uint32 toSeqNum)
 {
-    RegionList::iterator i = regionList.begin();
+    // the first region that ends at or after toSeqNum
+    RegionMap::iterator i = regionMap.lower_bound(toSeqNum);
 
-    while (i != regionList.end())
+    if (i != regionMap.end() && seqLess(i->second->getBegin(), toSeqNum))
     {
-        if (seqLess((*i)->getBegin(), toSeqNum) && seqLE(toSeqNum, (*i)->getEnd()))
-        {
-//            tcpEV << "Enqueued region: [" << i->begin << ".." << i->end << ")\n";
-            return (*i)->getEnd();
-        }
-
-        i++;
+//        tcpEV << "Enqueued region: [" << i->second->getBegin() << ".." << i->second->getEnd() << ")\n";
+        return i->second->getEnd();
     }
 
     return toSeqNum;
@@ -277,7 +265,7 @@ uint32 TCPVirtualDataRcvQueue::getRE(uint32 toSeqNum)
 
 uint32 TCPVirtualDataRcvQueue::getFirstSeqNo()
 {
-    if (regionList.empty())
+    if (regionMap.empty())
         return rcv_nxt;
-    return seqMin(regionList.front()->getBegin(), rcv_nxt);
+    return seqMin(regionMap.begin()->second->getBegin(), rcv_nxt);
 }
@@ -21,7 +21,7 @@
 #define __INET_TCPVIRTUALDATARCVQUEUE_H
 
 
-#include <list>
+#include <map>
 #include <string>
 
 #include "TCPSegment.h"
@@ -70,13 +70,24 @@ class INET_API TCPVirtualDataRcvQueue : public TCPReceiveQueue
         virtual TCPVirtualDataRcvQueue::Region* split(uint32 seq);
     };
 
-    typedef std::list<Region*> RegionList;
+    /** Orders sequence numbers of the receive window, see seqLess() */
+    struct SeqLess
+    {
+        bool operator()(uint32 a, uint32 b) const { return seqLess(a, b); }
+    };
 
-    RegionList regionList;
+    /** Non-overlapping, non-touching regions, indexed by their end sequence number */
+    typedef std::map<uint32, Region*, SeqLess> RegionMap;
 
-    /** Merge segment byte range into regionList, the parameter region must created by 'new' operator. */
+    RegionMap regionMap;
+    uint32 bufferedBytes;   // total length of the regions
+
+    /** Merge segment byte range into regionMap, the parameter region must created by 'new' operator. */
     void merge(TCPVirtualDataRcvQueue::Region *region);
 
+    /** Delete all regions */
+    void clear();
+
     // Returns number of bytes extracted
     TCPVirtualDataRcvQueue::Region* extractTo(uint32 toSeq);
 
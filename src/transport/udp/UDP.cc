@@ -100,12 +100,14 @@ UDP::SockDesc::SockDesc(int sockId_, int appGateIndex_) {
     multicastLoop = DEFAULT_MULTICAST_LOOP;
     ttl = -1;
     typeOfService = 0;
+    portSeq = 0;
 }
 
 //--------
 UDP::UDP()
 {
     isOperational = false;
+    lastPortSeq = 0;
     icmp = NULL;
     icmpv6 = NULL;
 }
@@ -125,6 +127,7 @@ void UDP::initialize(int stage)
         WATCH_MAP(socketsByPortMap);
 
         lastEphemeralPort = EPHEMERAL_PORTRANGE_START;
+        lastPortSeq = 0;
         icmp = NULL;
         icmpv6 = NULL;
 
@@ -501,6 +504,7 @@ void UDP::bind(int sockId, int gateIndex, const IPvXAddress& localAddr, int loca
         if (sd->isBound)
             error("bind: socket is already bound (sockId=%d)", sockId);
 
+        removeFromDemuxTables(sd);
         sd->isBound = true;
         sd->localAddr = localAddr;
         if (localPort != -1 && sd->localPort != localPort)
@@ -508,7 +512,9 @@ void UDP::bind(int sockId, int gateIndex, const IPvXAddress& localAddr, int loca
             socketsByPortMap[sd->localPort].remove(sd);
             sd->localPort = localPort;
             socketsByPortMap[sd->localPort].push_back(sd);
+            sd->portSeq = ++lastPortSeq;
         }
+        addToDemuxTables(sd);
     }
     else
     {
@@ -525,9 +531,11 @@ void UDP::connect(int sockId, int gateIndex, const IPvXAddress& remoteAddr, int
         error("connect: invalid remote port number %d", remotePort);
 
     SockDesc *sd = getOrCreateSocket(sockId, gateIndex);
+    removeFromDemuxTables(sd);
     sd->remoteAddr = remoteAddr;
     sd->remotePort = remotePort;
     sd->onlyLocalPortIsSet = false;
+    addToDemuxTables(sd);
 
     EV << "Socket connected: " << *sd << "\n";
 }
@@ -547,6 +555,8 @@ UDP::SockDesc *UDP::createSocket(int sockId, int gateIndex, const IPvXAddress& l
     // add to socketsByPortMap
     SockDescList& list = socketsByPortMap[sd->localPort]; // create if doesn't exist
     list.push_back(sd);
+    sd->portSeq = ++lastPortSeq;
+    addToDemuxTables(sd);
 
     EV << "Socket created: " << *sd << "\n";
     return sd;
@@ -564,6 +574,7 @@ void UDP::close(int sockId)
     EV << "Closing socket: " << *sd << "\n";
 
     // remove from socketsByPortMap
+    removeFromDemuxTables(sd);
     SockDescList& list = socketsByPortMap[sd->localPort];
     for (SockDescList::iterator it = list.begin(); it != list.end(); ++it)
         if (*it == sd)
@@ -582,6 +593,8 @@ void UDP::clearAllSockets()
         it->second.clear();
     }
     socketsByPortMap.clear();
+    connectedTable.clear();
+    wildcardTable.clear();
     for (SocketsByIdMap::iterator it = socketsByIdMap.begin(); it != socketsByIdMap.end(); ++it)
         delete it->second;
     socketsByIdMap.clear();
@@ -607,6 +620,27 @@ ushort UDP::getEphemeralPort()
     return lastEphemeralPort;
 }
 
+bool UDP::isFullySpecified(const SockDesc *sd)
+{
+    return !sd->onlyLocalPortIsSet && !sd->localAddr.isUnspecified() && !sd->remoteAddr.isUnspecified() && sd->remotePort != -1;
+}
+
+void UDP::addToDemuxTables(SockDesc *sd)
+{
+    if (isFullySpecified(sd))
+        connectedTable.insert(hashSocketPair(sd->localAddr, sd->remoteAddr, sd->localPort, sd->remotePort), sd);
+    else
+        wildcardTable.insert(hashInt(sd->localPort), sd);
+}
+
+void UDP::removeFromDemuxTables(SockDesc *sd)
+{
+    if (isFullySpecified(sd))
+        connectedTable.remove(hashSocketPair(sd->localAddr, sd->remoteAddr, sd->localPort, sd->remotePort), sd);
+    else
+        wildcardTable.remove(hashInt(sd->localPort), sd);
+}
+
 UDP::SockDesc *UDP::findFirstSocketByLocalAddress(const IPvXAddress& localAddr, ushort localPort)
 {
     SocketsByPortMap::iterator it = socketsByPortMap.find(localPort);
@@ -625,28 +659,55 @@ UDP::SockDesc *UDP::findFirstSocketByLocalAddress(const IPvXAddress& localAddr,
 
 UDP::SockDesc *UDP::findSocketForUnicastPacket(const IPvXAddress& localAddr, ushort localPort, const IPvXAddress& remoteAddr, ushort remotePort)
 {
-    SocketsByPortMap::iterator it = socketsByPortMap.find(localPort);
-    if (it == socketsByPortMap.end())
-        return NULL;
-
-    // select the socket bound to ANY_ADDR only if there is no socket bound to localAddr
-    SockDescList& list = it->second;
+    // Select the socket bound to ANY_ADDR only if there is no socket bound to localAddr.
+    // Of the sockets bound to localAddr, the one added last to the port's list wins;
+    // of those bound to ANY_ADDR, the one added first.
+    SockDesc *socketBoundToLocalAddress = NULL;
     SockDesc *socketBoundToAnyAddress = NULL;
-    for (SockDescList::reverse_iterator it = list.rbegin(); it != list.rend(); ++it)
+
+    // connected sockets bound to localAddr
+    if (connectedTable.size() > 0)
     {
-        SockDesc *sd = *it;
-        if (sd->onlyLocalPortIsSet || (
-                (sd->remotePort == -1 || sd->remotePort == remotePort) &&
-                (sd->localAddr.isUnspecified() || sd->localAddr == localAddr) &&
-                (sd->remoteAddr.isUnspecified() || sd->remoteAddr == remoteAddr) ))
+        unsigned int hash = hashSocketPair(localAddr, remoteAddr, localPort, remotePort);
+        const DemuxTable::Bucket& bucket = connectedTable.getBucket(hash);
+        for (DemuxTable::Bucket::const_iterator it = bucket.begin(); it != bucket.end(); ++it)
         {
-            if (sd->localAddr.isUnspecified())
-                socketBoundToAnyAddress = sd;
-            else
-                return sd;
+            SockDesc *sd = it->value;
+            if (it->hash == hash && sd->localPort == localPort && sd->remotePort == remotePort
+                    && sd->remoteAddr == remoteAddr && sd->localAddr == localAddr
+                    && (!socketBoundToLocalAddress || sd->portSeq > socketBoundToLocalAddress->portSeq))
+                socketBoundToLocalAddress = sd;
+        }
+    }
+
+    // all other sockets on the local port
+    if (wildcardTable.size() > 0)
+    {
+        const DemuxTable::Bucket& bucket = wildcardTable.getBucket(hashInt(localPort));
+        for (DemuxTable::Bucket::const_iterator it = bucket.begin(); it != bucket.end(); ++it)
+        {
+            SockDesc *sd = it->value;
+            if (sd->localPort != localPort)
+                continue;
+            if (sd->onlyLocalPortIsSet || (
+                    (sd->remotePort == -1 || sd->remotePort == remotePort) &&
+                    (sd->localAddr.isUnspecified() || sd->localAddr == localAddr) &&
+                    (sd->remoteAddr.isUnspecified() || sd->remoteAddr == remoteAddr) ))
+            {
+                if (sd->localAddr.isUnspecified())
+                {
+                    if (!socketBoundToAnyAddress || sd->portSeq < socketBoundToAnyAddress->portSeq)
+                        socketBoundToAnyAddress = sd;
+                }
+                else
+                {
+                    if (!socketBoundToLocalAddress || sd->portSeq > socketBoundToLocalAddress->portSeq)
+                        socketBoundToLocalAddress = sd;
+                }
+            }
         }
     }
-    return socketBoundToAnyAddress;
+    return socketBoundToLocalAddress ? socketBoundToLocalAddress : socketBoundToAnyAddress;
 }
 
 std::vector<UDP::SockDesc*> UDP::findSocketsForMcastBcastPacket(const IPvXAddress& localAddr, ushort localPort, const IPvXAddress& remoteAddr, ushort remotePort, bool isMulticast, bool isBroadcast)
@@ -23,6 +23,7 @@
 #include <map>
 #include <list>
 
+#include "HashIndex.h"
 #include "ILifecycle.h"
 #include "UDPControlInfo.h"
 
@@ -63,17 +64,26 @@ class INET_API UDP : public cSimpleModule, public ILifecycle
         int ttl;
         unsigned char typeOfService;
         std::map<IPvXAddress,int> multicastAddrs; // key: multicast address; value: output interface Id or -1
+        long portSeq;   // order of insertion into the list of the local port (see findSocketForUnicastPacket())
     };
 
     typedef std::list<SockDesc *> SockDescList;   // might contain duplicated local addresses if their reuseAddr flag is set
     typedef std::map<int,SockDesc *> SocketsByIdMap;
     typedef std::map<int,SockDescList> SocketsByPortMap;
 
+    typedef HashIndex<SockDesc *> DemuxTable;
+
   protected:
     // sockets
     SocketsByIdMap socketsByIdMap;
     SocketsByPortMap socketsByPortMap;
 
+    // index of socketsByPortMap for unicast packets: connected sockets bound to
+    // a local address are hashed by the socket pair, all others by the local port
+    DemuxTable connectedTable;
+    DemuxTable wildcardTable;
+    long lastPortSeq;
+
     // other state vars
     ushort lastEphemeralPort;
     ICMP *icmp;
@@ -121,6 +131,11 @@ class INET_API UDP : public cSimpleModule, public ILifecycle
     virtual SockDesc *findSocketForUnicastPacket(const IPvXAddress& localAddr, ushort localPort, const IPvXAddress& remoteAddr, ushort remotePort);
     virtual std::vector<SockDesc*> findSocketsForMcastBcastPacket(const IPvXAddress& localAddr, ushort localPort, const IPvXAddress& remoteAddr, ushort remotePort, bool isMulticast, bool isBroadcast);
     virtual SockDesc *findFirstSocketByLocalAddress(const IPvXAddress& localAddr, ushort localPort);
+
+    // demultiplexing tables
+    static bool isFullySpecified(const SockDesc *sd);
+    virtual void addToDemuxTables(SockDesc *sd);
+    virtual void removeFromDemuxTables(SockDesc *sd);
     virtual void sendUp(cPacket *payload, SockDesc *sd, const IPvXAddress& srcAddr, ushort srcPort, const IPvXAddress& destAddr, ushort destPort, int interfaceId, int ttl, unsigned char tos);
     virtual void sendDown(cPacket *appData, const IPvXAddress& srcAddr, ushort srcPort, const IPvXAddress& destAddr, ushort destPort, int interfaceId, bool multicastLoop, int ttl, unsigned char tos);
     virtual void processUndeliverablePacket(UDPPacket *udpPacket, cObject *ctrl);
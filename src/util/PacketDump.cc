@@ -554,8 +554,11 @@ void PacketDump::dumpIPv4(bool l2r, const char *label, IPv4Datagram *dgram, cons
          sprintf(buf, "[%.3f%s] ", SIMTIME_DBL(simTime()), label);
          out << buf;
 
-         // packet class and name
-         out << "? " << encapmsg->getClassName() << " \"" << encapmsg->getName() << "\"";
+         // packet class and name; non-first fragments carry no payload packet
+         if (encapmsg)
+             out << "? " << encapmsg->getClassName() << " \"" << encapmsg->getName() << "\"";
+         else
+             out << dgram->getSrcAddress() << " > " << dgram->getDestAddress() << ": fragment at offset " << dgram->getFragmentOffset();
 
          // comment
          if (comment)
@@ -16,27 +16,93 @@
 // along with this program; if not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <string.h>
+
 #include "TCPIPchecksum.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 //#if !defined(_WIN32) && !defined(__WIN32__) && !defined(WIN32) && !defined(__CYGWIN__) && !defined(_WIN64)
 //#include <netinet/in.h>  // htonl, ntohl, ...
 //#endif
 
 uint16_t TCPIPchecksum::_checksum(const void *addr, unsigned int count)
 {
-    uint32_t sum = 0;
+    // As 0x10000 == 1 (mod 0xFFFF), a 32 bit word adds the same to the one's
+    // complement sum as its two 16 bit halves. So the data is summed in 32 bit
+    // words into a 64 bit accumulator, which needs no carry handling inside
+    // the loops, and folded to 16 bits at the end.
+    const uint8_t *p = (const uint8_t *)addr;
+    uint64_t sum = 0;
 
-    while (count > 1)
+#ifdef __SSE2__
+    if (count >= 64)
     {
-        sum += *((const uint16_t *&)addr)++;
-        if (sum & 0x80000000)
-            sum = (sum & 0xFFFF) + (sum >> 16);
+        // zero-extend the 32 bit words into 64 bit lanes, 64 bytes per iteration
+        const __m128i zero = _mm_setzero_si128();
+        __m128i acc0 = zero, acc1 = zero;
+        while (count >= 64)
+        {
+            __m128i v0 = _mm_loadu_si128((const __m128i *)p);
+            __m128i v1 = _mm_loadu_si128((const __m128i *)(p + 16));
+            __m128i v2 = _mm_loadu_si128((const __m128i *)(p + 32));
+            __m128i v3 = _mm_loadu_si128((const __m128i *)(p + 48));
+            acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v0, zero));
+            acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v0, zero));
+            acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v1, zero));
+            acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v1, zero));
+            acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v2, zero));
+            acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v2, zero));
+            acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v3, zero));
+            acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v3, zero));
+            p += 64;
+            count -= 64;
+        }
+        uint64_t lanes[2];
+        _mm_storeu_si128((__m128i *)lanes, _mm_add_epi64(acc0, acc1));
+        sum = lanes[0] + lanes[1];
+    }
+#endif
+
+    while (count >= 16)
+    {
+        uint32_t w[4];
+        memcpy(w, p, 16);
+        sum += (uint64_t)w[0] + w[1] + w[2] + w[3];
+        p += 16;
+        count -= 16;
+    }
+
+    while (count >= 4)
+    {
+        uint32_t w;
+        memcpy(&w, p, 4);
+        sum += w;
+        p += 4;
+        count -= 4;
+    }
+
+    if (count >= 2)
+    {
+        uint16_t w;
+        memcpy(&w, p, 2);
+        sum += w;
+        p += 2;
         count -= 2;
     }
 
     if (count)
-        sum += *(const uint8_t *)addr;
+    {
+        // the last octet is padded on the right with zero
+        uint16_t w = 0;
+        memcpy(&w, p, 1);
+        sum += w;
+    }
 
+    sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+    sum = (sum & 0xFFFFFFFF) + (sum >> 32);
     while (sum >> 16)
         sum = (sum & 0xFFFF) + (sum >> 16);
 
@@ -25,7 +25,7 @@
 /**
  * Calculates checksum.
  */
-class TCPIPchecksum
+class INET_API TCPIPchecksum
 {
     public:
         TCPIPchecksum() {}
@@ -42,7 +42,39 @@ class TCPIPchecksum
             return ~ _checksum(addr, count);
         }
 
+        /*
+         * Returns the one's complement sum of the 16 bit words (not complemented).
+         * The words are summed in host byte order, so the result can be
+         * stored into the packet as it is.
+         */
         static uint16_t _checksum(const void *addr, unsigned int count);
+
+        /*
+         * Incremental checksum update (RFC 1624, eqn. 3): returns the new checksum
+         * after a 16 bit word of the checksummed data changed from oldWord to newWord.
+         * All values are taken as stored in the packet (network byte order).
+         */
+        static uint16_t updateChecksum(uint16_t checksum, uint16_t oldWord, uint16_t newWord)
+        {
+            uint32_t sum = (uint16_t)~checksum + (uint16_t)~oldWord + (uint32_t)newWord;
+            sum = (sum & 0xFFFF) + (sum >> 16);
+            sum = (sum & 0xFFFF) + (sum >> 16);
+            return (uint16_t)~sum;
+        }
+
+        /*
+         * Same as updateChecksum(), for a 32 bit field (e.g. an IPv4 address)
+         * that starts at an even offset.
+         */
+        static uint16_t updateChecksum32(uint16_t checksum, uint32_t oldValue, uint32_t newValue)
+        {
+            uint32_t sum = (uint16_t)~checksum
+                         + (uint16_t)~(oldValue >> 16) + (uint16_t)~(oldValue & 0xFFFF)
+                         + (newValue >> 16) + (newValue & 0xFFFF);
+            sum = (sum & 0xFFFF) + (sum >> 16);
+            sum = (sum & 0xFFFF) + (sum >> 16);
+            return (uint16_t)~sum;
+        }
 };
 
 #endif
@@ -95,42 +95,51 @@ int IPv4Serializer::serialize(const IPv4Datagram *dgram, unsigned char *buf, uns
 
     cMessage *encapPacket = dgram->getEncapsulatedPacket();
 
-    switch (dgram->getTransportProtocol())
+    // Only the first fragment of a datagram carries the encapsulated packet
+    // (see IPv4::fragmentAndSend()), the others are serialized as header only.
+    if (dgram->getFragmentOffset() != 0 || !encapPacket)
     {
-      case IP_PROT_ICMP:
-        packetLength += ICMPSerializer().serialize(check_and_cast<ICMPMessage *>(encapPacket),
-                                                   buf+IP_HEADER_BYTES, bufsize-IP_HEADER_BYTES);
-        break;
-
-      case IP_PROT_IGMP:
-        packetLength += IGMPSerializer().serialize(check_and_cast<IGMPMessage *>(encapPacket),
-                                                   buf+IP_HEADER_BYTES, bufsize-IP_HEADER_BYTES);
-        break;
+        EV << "Serializing an IPv4 fragment without encapsulated packet, header only.\n";
+    }
+    else
+    {
+        switch (dgram->getTransportProtocol())
+        {
+          case IP_PROT_ICMP:
+            packetLength += ICMPSerializer().serialize(check_and_cast<ICMPMessage *>(encapPacket),
+                                                       buf+IP_HEADER_BYTES, bufsize-IP_HEADER_BYTES);
+            break;
+
+          case IP_PROT_IGMP:
+            packetLength += IGMPSerializer().serialize(check_and_cast<IGMPMessage *>(encapPacket),
+                                                       buf+IP_HEADER_BYTES, bufsize-IP_HEADER_BYTES);
+            break;
 
 #ifdef WITH_UDP
-      case IP_PROT_UDP:
-        packetLength += UDPSerializer().serialize(check_and_cast<UDPPacket *>(encapPacket),
-                                                   buf+IP_HEADER_BYTES, bufsize-IP_HEADER_BYTES);
-        break;
+          case IP_PROT_UDP:
+            packetLength += UDPSerializer().serialize(check_and_cast<UDPPacket *>(encapPacket),
+                                                       buf+IP_HEADER_BYTES, bufsize-IP_HEADER_BYTES);
+            break;
 #endif
 
 #ifdef WITH_SCTP
-      case IP_PROT_SCTP:    //I.R.
-        packetLength += SCTPSerializer().serialize(check_and_cast<SCTPMessage *>(encapPacket),
-                                                   buf+IP_HEADER_BYTES, bufsize-IP_HEADER_BYTES);
-        break;
+          case IP_PROT_SCTP:    //I.R.
+            packetLength += SCTPSerializer().serialize(check_and_cast<SCTPMessage *>(encapPacket),
+                                                       buf+IP_HEADER_BYTES, bufsize-IP_HEADER_BYTES);
+            break;
 #endif
 
 #ifdef WITH_TCP_COMMON
-      case IP_PROT_TCP:        //I.R.
-        packetLength += TCPSerializer().serialize(check_and_cast<TCPSegment *>(encapPacket),
-                                                   buf+IP_HEADER_BYTES, bufsize-IP_HEADER_BYTES,
-                                                   dgram->getSrcAddress(), dgram->getDestAddress());
-        break;
+          case IP_PROT_TCP:        //I.R.
+            packetLength += TCPSerializer().serialize(check_and_cast<TCPSegment *>(encapPacket),
+                                                       buf+IP_HEADER_BYTES, bufsize-IP_HEADER_BYTES,
+                                                       dgram->getSrcAddress(), dgram->getDestAddress());
+            break;
 #endif
 
-      default:
-        throw cRuntimeError(dgram, "IPv4Serializer: cannot serialize protocol %d", dgram->getTransportProtocol());
+          default:
+            throw cRuntimeError(dgram, "IPv4Serializer: cannot serialize protocol %d", dgram->getTransportProtocol());
+        }
     }
 
     ip->ip_len = htons(packetLength);
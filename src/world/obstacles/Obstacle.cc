@@ -17,12 +17,16 @@
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 //
 
-#include <set>
+#include <algorithm>
 #include "world/obstacles/Obstacle.h"
 
 
 typedef std::pair<Coord, double> CoordFrac;
 
+namespace {
+    bool isPointInObstacle(Coord point, const Obstacle& o);
+}
+
 Obstacle::Obstacle(std::string id, double attenuationPerWall, double attenuationPerMeter) :
     visualRepresentation(0),
     id(id),
@@ -40,6 +44,28 @@ void Obstacle::setShape(Coords shape) {
         bboxP2.x = std::max(i->x, bboxP2.x);
         bboxP2.y = std::max(i->y, bboxP2.y);
     }
+
+    // wall k connects corner k and corner k-1 (wrapping around), like the loops in calculateReceivedPower()
+    size_t n = coords.size();
+    wallFromX.resize(n);
+    wallFromY.resize(n);
+    wallVecX.resize(n);
+    wallVecY.resize(n);
+    intersectScratch.resize(n);
+    for (size_t k = 0; k < n; ++k) {
+        const Coord& c1 = coords[k];
+        const Coord& c2 = coords[k == 0 ? n - 1 : k - 1];
+        wallFromX[k] = c1.x;
+        wallFromY[k] = c1.y;
+        wallVecX[k] = c2.x - c1.x;
+        wallVecY[k] = c2.y - c1.y;
+    }
+}
+
+bool Obstacle::isPointInside(const Coord& point) const {
+    // a point outside the bounding box cannot be inside the polygon
+    if (point.x < bboxP1.x || point.x > bboxP2.x || point.y < bboxP1.y || point.y > bboxP2.y) return false;
+    return isPointInObstacle(point, *this);
 }
 
 const Obstacle::Coords& Obstacle::getShape() const {
@@ -74,22 +100,6 @@ namespace {
         return isInside;
     }
 
-    double segmentsIntersectAt(Coord p1From, Coord p1To, Coord p2From, Coord p2To) {
-        Coord p1Vec = p1To - p1From;
-        Coord p2Vec = p2To - p2From;
-        Coord p1p2 = p1From - p2From;
-
-        double D = (p1Vec.x * p2Vec.y - p1Vec.y * p2Vec.x);
-
-        double p1Frac = (p2Vec.x * p1p2.y - p2Vec.y * p1p2.x) / D;
-        if (p1Frac < 0 || p1Frac > 1) return -1;
-
-        double p2Frac = (p1Vec.x * p1p2.y - p1Vec.y * p1p2.x) / D;
-        if (p2Frac < 0 || p2Frac > 1) return -1;
-
-        return p1Frac;
-    }
-
     double segmentsIntersectAt(Coord p1From, Coord p1To, Coord p2From, Coord p2To, Coord &IntersectPoint) {
         Coord p1Vec = p1To - p1From;
         Coord p2Vec = p2To - p2From;
@@ -155,32 +165,39 @@ double Obstacle::calculateReceivedPower(double pSend, double carrierFrequency, c
     // if obstacles has neither walls nor matter: bail.
     if (getShape().size() < 2) return pSend;
 
-    // get a list of points (in [0, 1]) along the line between sender and receiver where the beam intersects with this obstacle
-    std::multiset<double> intersectAt;
-    bool doesIntersect = false;
-    const Obstacle::Coords& shape = getShape();
-    Obstacle::Coords::const_iterator i = shape.begin();
-    Obstacle::Coords::const_iterator j = (shape.rbegin()+1).base();
-    for (; i != shape.end(); j = i++) {
-        Coord c1 = *i;
-        Coord c2 = *j;
-
-        double i = segmentsIntersectAt(senderPos, receiverPos, c1, c2);
-        if (i != -1) {
-            doesIntersect = true;
-            intersectAt.insert(i);
-        }
-
+    // get a list of points (in [0, 1]) along the line between sender and receiver where the beam intersects with this obstacle.
+    // All walls are tested in one branch-free pass over the wall arrays, so that the compiler can vectorize the loop.
+    size_t numWalls = wallFromX.size();
+    double p1VecX = receiverPos.x - senderPos.x;
+    double p1VecY = receiverPos.y - senderPos.y;
+    const double *fromX = &wallFromX[0];
+    const double *fromY = &wallFromY[0];
+    const double *vecX = &wallVecX[0];
+    const double *vecY = &wallVecY[0];
+    double *frac = &intersectScratch[0];
+    for (size_t k = 0; k < numWalls; ++k) {
+        double p1p2X = senderPos.x - fromX[k];
+        double p1p2Y = senderPos.y - fromY[k];
+        double D = (p1VecX * vecY[k] - p1VecY * vecX[k]);
+        double p1Frac = (vecX[k] * p1p2Y - vecY[k] * p1p2X) / D;
+        double p2Frac = (p1VecX * p1p2Y - p1VecY * p1p2X) / D;
+        bool miss = (p1Frac < 0) | (p1Frac > 1) | (p2Frac < 0) | (p2Frac > 1);
+        frac[k] = miss ? -1 : p1Frac;
     }
 
+    std::vector<double> intersectAt;
+    for (size_t k = 0; k < numWalls; ++k)
+        if (frac[k] != -1) intersectAt.push_back(frac[k]);
+    bool doesIntersect = !intersectAt.empty();
+
     // if beam interacts with neither walls nor matter: bail.
-    bool senderInside = isPointInObstacle(senderPos, *this);
-    bool receiverInside = isPointInObstacle(receiverPos, *this);
+    bool senderInside = isPointInside(senderPos);
+    bool receiverInside = isPointInside(receiverPos);
     if (!doesIntersect && !senderInside && !receiverInside) return pSend;
 
     // make sure every other pair of points marks transition through matter and void, respectively.
-    if (senderInside) intersectAt.insert(0);
-    if (receiverInside) intersectAt.insert(1);
+    if (senderInside) intersectAt.push_back(0);
+    if (receiverInside) intersectAt.push_back(1);
     if ((intersectAt.size() % 2) != 0)
     {
         // problems in a corner
@@ -218,24 +235,25 @@ double Obstacle::calculateReceivedPower(double pSend, double carrierFrequency, c
         intersectAt.clear();
         for (unsigned int index = 0 ; index < intersectVector.size(); index++)
         {
-            intersectAt.insert(intersectVector[index].second);
+            intersectAt.push_back(intersectVector[index].second);
         }
-        if (senderInside) intersectAt.insert(0);
-        if (receiverInside) intersectAt.insert(1);
+        if (senderInside) intersectAt.push_back(0);
+        if (receiverInside) intersectAt.push_back(1);
     }
     ASSERT((intersectAt.size() % 2) == 0);
+    std::sort(intersectAt.begin(), intersectAt.end());
 
     // sum up distances in matter.
     double fractionInObstacle = 0;
-    for (std::multiset<double>::const_iterator i = intersectAt.begin(); i != intersectAt.end(); ) {
+    for (std::vector<double>::const_iterator i = intersectAt.begin(); i != intersectAt.end(); ) {
         double p1 = *(i++);
         double p2 = *(i++);
         fractionInObstacle += (p2 - p1);
     }
 
     // calculate attenuation
-    double numWalls = intersectAt.size();
+    double numWallsCrossed = intersectAt.size();
     double totalDistance = senderPos.distance(receiverPos);
-    double attenuation = (attenuationPerWall * numWalls) + (attenuationPerMeter * fractionInObstacle * totalDistance);
+    double attenuation = (attenuationPerWall * numWallsCrossed) + (attenuationPerMeter * fractionInObstacle * totalDistance);
     return pSend * pow(10.0, -attenuation/10.0);
 }
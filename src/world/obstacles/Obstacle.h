@@ -43,6 +43,9 @@ class Obstacle {
 
         AnnotationManager::Annotation* visualRepresentation;
 
+    protected:
+        bool isPointInside(const Coord& point) const;
+
     protected:
         std::string id;
         double attenuationPerWall; /**< in dB. Consumer Wi-Fi vs. an exterior wall will give approx. 50 dB */
@@ -50,6 +53,14 @@ class Obstacle {
         Coords coords;
         Coord bboxP1;
         Coord bboxP2;
+
+        // walls in structure-of-arrays form: wall k runs from (wallFromX[k], wallFromY[k])
+        // by (wallVecX[k], wallVecY[k]); laid out so the intersection loop can be vectorized
+        std::vector<double> wallFromX;
+        std::vector<double> wallFromY;
+        std::vector<double> wallVecX;
+        std::vector<double> wallVecY;
+        mutable std::vector<double> intersectScratch; /**< per wall: intersection fraction along the beam, or -1 */
 };
 
 #endif
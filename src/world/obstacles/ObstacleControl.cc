@@ -36,9 +36,14 @@ void ObstacleControl::initialize(int stage)
     if (stage == 0)
     {
         obstacles.clear();
-        cacheEntries.clear();
+        clearCache();
 
         obstaclesXml = par("obstacles");
+        int size = par("cacheSize");
+        if (size < 0) error("cacheSize must not be negative");
+        cacheSize = size;
+        cachePositionResolution = par("cachePositionResolution");
+        if (cachePositionResolution < 0) error("cachePositionResolution must not be negative");
     }
     else if (stage == 1)
     {
@@ -130,7 +135,7 @@ void ObstacleControl::add(Obstacle obstacle) {
     // visualize using AnnotationManager
     if (annotations) o->visualRepresentation = annotations->drawPolygon(o->getShape(), "red", annotationGroup);
 
-    cacheEntries.clear();
+    clearCache();
 }
 
 void ObstacleControl::erase(const Obstacle* obstacle) {
@@ -150,62 +155,116 @@ void ObstacleControl::erase(const Obstacle* obstacle) {
     if (annotations && obstacle->visualRepresentation) annotations->erase(obstacle->visualRepresentation);
     delete obstacle;
 
+    clearCache();
+}
+
+void ObstacleControl::clearCache() {
     cacheEntries.clear();
+    cacheIndex.clear();
+}
+
+double ObstacleControl::quantize(double value) const {
+    if (cachePositionResolution == 0) return value;
+    return floor(value / cachePositionResolution + 0.5) * cachePositionResolution;
 }
 
 double ObstacleControl::calculateReceivedPower(double pSend, double carrierFrequency, const Coord& senderPos, double senderAngle, const Coord& receiverPos, double receiverAngle) const {
     Enter_Method_Silent();
 
     // return cached result, if available
-    CacheKey cacheKey(pSend, carrierFrequency, senderPos, senderAngle, receiverPos, receiverAngle);
-    CacheEntries::const_iterator cacheEntryIter = cacheEntries.find(cacheKey);
-    if (cacheEntryIter != cacheEntries.end()) return cacheEntryIter->second;
+    CacheKey cacheKey(pSend, carrierFrequency, Coord(quantize(senderPos.x), quantize(senderPos.y)), senderAngle, Coord(quantize(receiverPos.x), quantize(receiverPos.y)), receiverAngle);
+    CacheIndex::iterator cacheIndexIter = cacheIndex.find(cacheKey);
+    if (cacheIndexIter != cacheIndex.end()) {
+        // move entry to the front of the LRU list
+        cacheEntries.splice(cacheEntries.begin(), cacheEntries, cacheIndexIter->second);
+        return cacheIndexIter->second->second;
+    }
 
     // calculate bounding box of transmission
     Coord bboxP1 = Coord(std::min(senderPos.x, receiverPos.x), std::min(senderPos.y, receiverPos.y));
     Coord bboxP2 = Coord(std::max(senderPos.x, receiverPos.x), std::max(senderPos.y, receiverPos.y));
 
-    size_t fromRow = std::max(0, int(bboxP1.x / GRIDCELL_SIZE));
-    size_t toRow = std::max(0, int(bboxP2.x / GRIDCELL_SIZE));
-    size_t fromCol = std::max(0, int(bboxP1.y / GRIDCELL_SIZE));
-    size_t toCol = std::max(0, int(bboxP2.y / GRIDCELL_SIZE));
+    // walk the grid cells crossed by the line of sight (Amanatides & Woo), instead of
+    // every cell of its bounding box. Cell coordinates are clamped at zero, just like in add().
+    // The obstacles are applied in the order of the walk, not column by column, so the
+    // result may differ from a sweep of the bounding box in the last bits, and below the
+    // 1e-30 cutoff of visitGridCell().
+    int x = (int)floor(senderPos.x / GRIDCELL_SIZE);
+    int y = (int)floor(senderPos.y / GRIDCELL_SIZE);
+    int endX = (int)floor(receiverPos.x / GRIDCELL_SIZE);
+    int endY = (int)floor(receiverPos.y / GRIDCELL_SIZE);
+    int stepX = endX > x ? 1 : endX < x ? -1 : 0;
+    int stepY = endY > y ? 1 : endY < y ? -1 : 0;
+    double dx = receiverPos.x - senderPos.x;
+    double dy = receiverPos.y - senderPos.y;
+    double tDeltaX = stepX ? GRIDCELL_SIZE / fabs(dx) : 0;
+    double tDeltaY = stepY ? GRIDCELL_SIZE / fabs(dy) : 0;
+    double tMaxX = stepX ? ((x + (stepX > 0 ? 1 : 0)) * (double)GRIDCELL_SIZE - senderPos.x) / dx : 0;
+    double tMaxY = stepY ? ((y + (stepY > 0 ? 1 : 0)) * (double)GRIDCELL_SIZE - senderPos.y) / dy : 0;
 
     std::set<Obstacle*> processedObstacles;
-    for (size_t col = fromCol; col <= toCol; ++col) {
-        if (col >= obstacles.size()) break;
-        for (size_t row = fromRow; row <= toRow; ++row) {
-            if (row >= obstacles[col].size()) break;
-            const ObstacleGridCell& cell = (obstacles[col])[row];
-            for (ObstacleGridCell::const_iterator k = cell.begin(); k != cell.end(); ++k) {
+    int prevCol = -1, prevRow = -1;
+    for (int steps = abs(endX - x) + abs(endY - y); ; --steps) {
+        int col = std::max(0, y);
+        int row = std::max(0, x);
+        if (col != prevCol || row != prevRow) {
+            visitGridCell(col, row, bboxP1, bboxP2, processedObstacles, pSend, carrierFrequency, senderPos, senderAngle, receiverPos, receiverAngle);
+            prevCol = col;
+            prevRow = row;
+        }
 
-                Obstacle* o = *k;
+        if (steps == 0) break;
 
-                if (processedObstacles.find(o) != processedObstacles.end()) continue;
-                processedObstacles.insert(o);
+        // step along the axis whose next cell border is crossed first
+        if (y == endY || (x != endX && tMaxX < tMaxY)) {
+            x += stepX;
+            tMaxX += tDeltaX;
+        }
+        else {
+            y += stepY;
+            tMaxY += tDeltaY;
+        }
+    }
 
-                // bail if bounding boxes cannot overlap
-                if (o->getBboxP2().x < bboxP1.x) continue;
-                if (o->getBboxP1().x > bboxP2.x) continue;
-                if (o->getBboxP2().y < bboxP1.y) continue;
-                if (o->getBboxP1().y > bboxP2.y) continue;
+    // cache result, evicting the least recently used entry if needed
+    if (cacheSize > 0) {
+        if (cacheEntries.size() >= cacheSize) {
+            cacheIndex.erase(cacheEntries.back().first);
+            cacheEntries.pop_back();
+        }
+        cacheEntries.push_front(std::make_pair(cacheKey, pSend));
+        cacheIndex.insert(std::make_pair(cacheKey, cacheEntries.begin()));
+    }
 
-                double pSendOld = pSend;
+    return pSend;
+}
 
-                pSend = o->calculateReceivedPower(pSend, carrierFrequency, senderPos, senderAngle, receiverPos, receiverAngle);
+void ObstacleControl::visitGridCell(size_t col, size_t row, const Coord& bboxP1, const Coord& bboxP2, std::set<Obstacle*>& processedObstacles,
+        double& pSend, double carrierFrequency, const Coord& senderPos, double senderAngle, const Coord& receiverPos, double receiverAngle) const {
+    if (col >= obstacles.size()) return;
+    if (row >= obstacles[col].size()) return;
+    const ObstacleGridCell& cell = (obstacles[col])[row];
+    for (ObstacleGridCell::const_iterator k = cell.begin(); k != cell.end(); ++k) {
 
-                // draw a "hit!" bubble
-                if (annotations && (pSend < pSendOld)) annotations->drawBubble(o->getBboxP1(), "hit");
+        Obstacle* o = *k;
 
-                // bail if attenuation is already extremely high
-                if (pSend < 1e-30) break;
+        if (!processedObstacles.insert(o).second) continue;
 
-            }
-        }
-    }
+        // bail if bounding boxes cannot overlap
+        if (o->getBboxP2().x < bboxP1.x) continue;
+        if (o->getBboxP1().x > bboxP2.x) continue;
+        if (o->getBboxP2().y < bboxP1.y) continue;
+        if (o->getBboxP1().y > bboxP2.y) continue;
 
-    // cache result
-    if (cacheEntries.size() >= 1000) cacheEntries.clear();
-    cacheEntries[cacheKey] = pSend;
+        double pSendOld = pSend;
 
-    return pSend;
+        pSend = o->calculateReceivedPower(pSend, carrierFrequency, senderPos, senderAngle, receiverPos, receiverAngle);
+
+        // draw a "hit!" bubble
+        if (annotations && (pSend < pSendOld)) annotations->drawBubble(o->getBboxP1(), "hit");
+
+        // bail if attenuation is already extremely high; the next cell still applies its first obstacle
+        if (pSend < 1e-30) break;
+
+    }
 }
@@ -22,6 +22,8 @@
 #define WORLD_OBSTACLE_OBSTACLECONTROL_H
 
 #include <list>
+#include <map>
+#include <set>
 
 #include "INETDefs.h"
 
@@ -36,6 +38,11 @@
  * Each Obstacle is a polygon.
  * Transmissions that cross one of the polygon's lines will have
  * their receive power set to zero.
+ *
+ * Obstacles are looked up in the grid cells that the line of sight crosses,
+ * in the order of the line. Attenuations are multiplied in this order, so
+ * results are not bit-identical to a column-by-column sweep of the bounding
+ * box of the line.
  */
 class INET_API ObstacleControl : public cSimpleModule
 {
@@ -99,14 +106,25 @@ class INET_API ObstacleControl : public cSimpleModule
         typedef std::list<Obstacle*> ObstacleGridCell;
         typedef std::vector<ObstacleGridCell> ObstacleGridRow;
         typedef std::vector<ObstacleGridRow> Obstacles;
-        typedef std::map<CacheKey, double> CacheEntries;
+        typedef std::list<std::pair<CacheKey, double> > CacheEntries; /**< most recently used first */
+        typedef std::map<CacheKey, CacheEntries::iterator> CacheIndex;
 
         cXMLElement* obstaclesXml; /**< obstacles to add at startup */
 
         Obstacles obstacles;
         AnnotationManager* annotations;
         AnnotationManager::Group* annotationGroup;
+
+        size_t cacheSize; /**< maximum number of cached results, 0 disables the cache */
+        double cachePositionResolution; /**< positions are rounded to this grid (in m) to form cache keys, 0 for exact keys */
         mutable CacheEntries cacheEntries;
+        mutable CacheIndex cacheIndex;
+
+    protected:
+        double quantize(double value) const;
+        void clearCache();
+        void visitGridCell(size_t col, size_t row, const Coord& bboxP1, const Coord& bboxP2, std::set<Obstacle*>& processedObstacles,
+                double& pSend, double carrierFrequency, const Coord& senderPos, double senderAngle, const Coord& receiverPos, double receiverAngle) const;
 };
 
 class ObstacleControlAccess
@@ -74,6 +74,15 @@ class INET_API ChannelAccess : public BasicModule, protected cListener
     /** Finds the channelControl module in the network */
     static IChannelControl *getChannelControl();
 
+    /**
+     * Called by ChannelControl for this radio's copy of a frame before it is
+     * sent, if reception prefiltering is enabled there. Returns false if the
+     * frame is negligible for this radio, in which case it is not delivered at
+     * all. Implementations may store per-receiver results in the frame.
+     * The default implementation accepts all frames.
+     */
+    virtual bool prefilterAirFrame(AirFrame *airframe) { return true; }
+
   protected:
     /** Sends a message to all radios in range */
     virtual void sendToChannel(AirFrame *msg);
@@ -16,7 +16,9 @@
 
 
 #include "ChannelControl.h"
+#include "ChannelAccess.h"
 #include "FWMath.h"
+#include <algorithm>
 #include <cassert>
 
 #include "AirFrame_m.h"
@@ -69,6 +71,22 @@ void ChannelControl::initialize()
 
     maxInterferenceDistance = calcInterfDist();
 
+    // the grid needs a finite, positive cell size
+    useNeighborGrid = par("useNeighborGrid").boolValue() && maxInterferenceDistance > 0 && maxInterferenceDistance < INFINITY;
+
+    lazyNeighborUpdate = par("lazyNeighborUpdate").boolValue();
+    maxSpeed = par("maxSpeed").doubleValue();
+    neighborCacheValidity = par("neighborCacheValidity").doubleValue();
+    maxPositionUpdateInterval = par("maxPositionUpdateInterval").doubleValue();
+    neighborCacheEpoch = 0;
+
+    prefilterReceptions = par("prefilterReceptions").boolValue();
+    numPrefiltered = 0;
+    WATCH(numPrefiltered);
+
+    if (lazyNeighborUpdate && (maxSpeed < 0 || neighborCacheValidity < 0 || maxPositionUpdateInterval < 0))
+        error("maxSpeed, neighborCacheValidity and maxPositionUpdateInterval must not be negative");
+
     WATCH(maxInterferenceDistance);
     WATCH_LIST(radios);
     WATCH_VECTOR(transmissions);
@@ -111,9 +129,7 @@ ChannelControl::RadioRef ChannelControl::registerRadio(cModule *radio, cGate *ra
 {
     Enter_Method_Silent();
 
-    RadioRef radioRef = lookupRadio(radio);
-
-    if (radioRef)
+    if (lookupRadio(radio))
         throw cRuntimeError("Radio %s already registered", radio->getFullPath().c_str());
 
     if (!radioInGate)
@@ -121,12 +137,18 @@ ChannelControl::RadioRef ChannelControl::registerRadio(cModule *radio, cGate *ra
 
     RadioEntry re;
     re.radioModule = radio;
+    re.channelAccess = dynamic_cast<ChannelAccess *>(radio);
     re.radioInGate = radioInGate->getPathStartGate();
-    re.isNeighborListValid = false;
     re.channel = 0;  // for now
     re.isActive = true;
+    re.candidatesEpoch = -1;
+    re.posTime = -1;
     radios.push_back(re);
-    return &radios.back(); // last element
+    RadioRef radioRef = &radios.back(); // last element
+    if (useNeighborGrid)
+        addToGrid(radioRef);
+    neighborCacheEpoch++;
+    return radioRef;
 }
 
 void ChannelControl::unregisterRadio(RadioRef r)
@@ -137,16 +159,19 @@ void ChannelControl::unregisterRadio(RadioRef r)
         if (it->radioModule == r->radioModule)
         {
             RadioRef radioToRemove = &*it;
-            // erase radio from all registered radios' neighbor list
-            for (RadioList::iterator i2 = radios.begin(); i2 != radios.end(); ++i2)
-            {
-                RadioRef otherRadio = &*i2;
-                otherRadio->neighbors.erase(radioToRemove);
-                otherRadio->isNeighborListValid = false;
-                radioToRemove->isNeighborListValid = false;
-            }
+            // erase radio from its neighbors' neighbor list (the relation is symmetric,
+            // except in lazy mode, where any radio may still have it as a candidate)
+            if (!lazyNeighborUpdate)
+                while (!radioToRemove->neighbors.empty())
+                    disconnect(radioToRemove, radioToRemove->neighbors.back());
+            else
+                for (RadioList::iterator jt = radios.begin(); jt != radios.end(); jt++)
+                    if (&*jt != radioToRemove)
+                        forgetRadio(&*jt, radioToRemove);
 
             // erase radio from registered radios
+            if (useNeighborGrid)
+                removeFromGrid(radioToRemove);
             radios.erase(it);
             return;
         }
@@ -167,46 +192,201 @@ ChannelControl::RadioRef ChannelControl::lookupRadio(cModule *radio)
 const ChannelControl::RadioRefVector& ChannelControl::getNeighbors(RadioRef h)
 {
     Enter_Method_Silent();
-    if (!h->isNeighborListValid)
+    if (lazyNeighborUpdate)
+        updateNeighborsLazily(h);
+    return h->neighbors;
+}
+
+void ChannelControl::collectRadiosInRange(RadioRef h, double range, std::vector<RadioEntry::Candidate>& result)
+{
+    result.clear();
+    double rangeSquared = range * range;
+    RadioRefVector found;
+    if (!useNeighborGrid)
+    {
+        for (RadioList::iterator it = radios.begin(); it != radios.end(); ++it)
+            if (&(*it) != h && h->pos.sqrdist(it->pos) < rangeSquared)
+                found.push_back(&(*it));
+    }
+    else
+    {
+        int k = (int)ceil(range / maxInterferenceDistance);
+        const RadioEntry::GridCell& center = h->gridCell;
+        RadioEntry::GridCell cell;
+        for (cell.x = center.x - k; cell.x <= center.x + k; cell.x++)
+        {
+            for (cell.y = center.y - k; cell.y <= center.y + k; cell.y++)
+            {
+                for (cell.z = center.z - k; cell.z <= center.z + k; cell.z++)
+                {
+                    RadioGrid::iterator cellIt = grid.find(cell);
+                    if (cellIt == grid.end())
+                        continue;
+                    const RadioRefVector& cellRadios = cellIt->second;
+                    for (RadioRefVector::const_iterator it = cellRadios.begin(); it != cellRadios.end(); ++it)
+                        if (*it != h && h->pos.sqrdist((*it)->pos) < rangeSquared)
+                            found.push_back(*it);
+                }
+            }
+        }
+    }
+
+    std::sort(found.begin(), found.end(), RadioEntry::Compare());
+    result.resize(found.size());
+    for (unsigned int i = 0; i < found.size(); i++)
     {
-        h->neighborList.clear();
-        for (std::set<RadioRef,RadioEntry::Compare>::iterator it = h->neighbors.begin(); it != h->neighbors.end(); it++)
-            h->neighborList.push_back(*it);
-        h->isNeighborListValid = true;
+        result[i].radio = found[i];
+        result[i].distance = h->pos.distance(found[i]->pos);
     }
-    return h->neighborList;
 }
 
-void ChannelControl::updateConnections(RadioRef h)
+void ChannelControl::updateNeighborsLazily(RadioRef h)
 {
-    Coord& hpos = h->pos;
+    simtime_t now = simTime();
+
+    // No radio moves faster than maxSpeed, and a position update reports at most
+    // maxPositionUpdateInterval worth of movement (see setRadioPosition()), so during dt
+    // the distance of two radios changes at most 2*maxSpeed*(dt+maxPositionUpdateInterval).
+    // Radios that were farther than maxInterferenceDistance plus that margin cannot have
+    // come in range within neighborCacheValidity.
+    if (h->candidatesEpoch != neighborCacheEpoch || now - h->candidatesTime > neighborCacheValidity)
+    {
+        double margin = 2 * maxSpeed * (neighborCacheValidity + maxPositionUpdateInterval).dbl();
+        collectRadiosInRange(h, maxInterferenceDistance + margin, h->candidates);
+        h->candidatesTime = now;
+        h->candidatesEpoch = neighborCacheEpoch;
+    }
+
+    // candidates closer than maxInterferenceDistance minus the margin are still in range,
+    // those farther than maxInterferenceDistance plus the margin are still out of range;
+    // only the ones in between need to be checked with the current positions
+    double margin = 2 * maxSpeed * (now - h->candidatesTime + maxPositionUpdateInterval).dbl();
     double maxDistSquared = maxInterferenceDistance * maxInterferenceDistance;
-    for (RadioList::iterator it = radios.begin(); it != radios.end(); ++it)
+    h->neighbors.clear();
+    for (std::vector<RadioEntry::Candidate>::iterator it = h->candidates.begin(); it != h->candidates.end(); ++it)
     {
-        RadioEntry *hi = &(*it);
-        if (hi == h)
-            continue;
+        if (it->distance < maxInterferenceDistance - margin)
+            h->neighbors.push_back(it->radio);
+        else if (it->distance < maxInterferenceDistance + margin && h->pos.sqrdist(it->radio->pos) < maxDistSquared)
+            h->neighbors.push_back(it->radio);
+    }
+}
+
+void ChannelControl::forgetRadio(RadioRef h, RadioRef r)
+{
+    RadioRefVector::iterator it = std::lower_bound(h->neighbors.begin(), h->neighbors.end(), r, RadioEntry::Compare());
+    if (it != h->neighbors.end() && *it == r)
+        h->neighbors.erase(it);
+    for (std::vector<RadioEntry::Candidate>::iterator jt = h->candidates.begin(); jt != h->candidates.end(); ++jt)
+    {
+        if (jt->radio == r)
+        {
+            h->candidates.erase(jt);
+            break;
+        }
+    }
+}
+
+void ChannelControl::connect(RadioRef a, RadioRef b)
+{
+    RadioRefVector::iterator it = std::lower_bound(a->neighbors.begin(), a->neighbors.end(), b, RadioEntry::Compare());
+    if (it != a->neighbors.end() && *it == b)
+        return;
+    a->neighbors.insert(it, b);
+    b->neighbors.insert(std::lower_bound(b->neighbors.begin(), b->neighbors.end(), a, RadioEntry::Compare()), a);
+}
+
+void ChannelControl::disconnect(RadioRef a, RadioRef b)
+{
+    RadioRefVector::iterator it = std::lower_bound(a->neighbors.begin(), a->neighbors.end(), b, RadioEntry::Compare());
+    if (it == a->neighbors.end() || *it != b)
+        return;
+    a->neighbors.erase(it);
+    b->neighbors.erase(std::lower_bound(b->neighbors.begin(), b->neighbors.end(), a, RadioEntry::Compare()));
+}
+
+ChannelControl::RadioEntry::GridCell ChannelControl::getGridCell(const Coord& pos)
+{
+    RadioEntry::GridCell cell;
+    cell.x = (int)floor(pos.x / maxInterferenceDistance);
+    cell.y = (int)floor(pos.y / maxInterferenceDistance);
+    cell.z = (int)floor(pos.z / maxInterferenceDistance);
+    return cell;
+}
 
-        // get the distance between the two radios.
-        // (omitting the square root (calling sqrdist() instead of distance()) saves about 5% CPU)
-        bool inRange = hpos.sqrdist(hi->pos) < maxDistSquared;
+void ChannelControl::addToGrid(RadioRef r)
+{
+    r->gridCell = getGridCell(r->pos);
+    grid[r->gridCell].push_back(r);
+}
+
+void ChannelControl::removeFromGrid(RadioRef r)
+{
+    RadioGrid::iterator cellIt = grid.find(r->gridCell);
+    ASSERT(cellIt != grid.end());
+    RadioRefVector& cellRadios = cellIt->second;
+    RadioRefVector::iterator it = std::find(cellRadios.begin(), cellRadios.end(), r);
+    ASSERT(it != cellRadios.end());
+    *it = cellRadios.back();
+    cellRadios.pop_back();
+    if (cellRadios.empty())
+        grid.erase(cellIt);
+}
+
+void ChannelControl::updateConnections(RadioRef h)
+{
+    Coord& hpos = h->pos;
+    double maxDistSquared = maxInterferenceDistance * maxInterferenceDistance;
 
-        if (inRange)
+    if (!useNeighborGrid)
+    {
+        for (RadioList::iterator it = radios.begin(); it != radios.end(); ++it)
         {
-            // nodes within communication range: connect
-            if (h->neighbors.insert(hi).second == true)
-            {
-                hi->neighbors.insert(h);
-                h->isNeighborListValid = hi->isNeighborListValid = false;
-            }
+            RadioEntry *hi = &(*it);
+            if (hi == h)
+                continue;
+
+            // get the distance between the two radios.
+            // (omitting the square root (calling sqrdist() instead of distance()) saves about 5% CPU)
+            bool inRange = hpos.sqrdist(hi->pos) < maxDistSquared;
+
+            if (inRange)
+                connect(h, hi); // nodes within communication range: connect
+            else
+                disconnect(h, hi); // out of range: disconnect
         }
-        else
+        return;
+    }
+
+    // disconnect the neighbors that moved out of range; iterate backwards
+    // because disconnect() removes the element from h->neighbors
+    for (int i = (int)h->neighbors.size() - 1; i >= 0; i--)
+    {
+        RadioRef hi = h->neighbors[i];
+        if (!(hpos.sqrdist(hi->pos) < maxDistSquared))
+            disconnect(h, hi);
+    }
+
+    // radios in range can only be in the same or in an adjacent grid cell,
+    // because the cell size equals the interference distance
+    const RadioEntry::GridCell& center = h->gridCell;
+    RadioEntry::GridCell cell;
+    for (cell.x = center.x - 1; cell.x <= center.x + 1; cell.x++)
+    {
+        for (cell.y = center.y - 1; cell.y <= center.y + 1; cell.y++)
         {
-            // out of range: disconnect
-            if (h->neighbors.erase(hi))
+            for (cell.z = center.z - 1; cell.z <= center.z + 1; cell.z++)
             {
-                hi->neighbors.erase(h);
-                h->isNeighborListValid = hi->isNeighborListValid = false;
+                RadioGrid::iterator cellIt = grid.find(cell);
+                if (cellIt == grid.end())
+                    continue;
+                const RadioRefVector& cellRadios = cellIt->second;
+                for (RadioRefVector::const_iterator it = cellRadios.begin(); it != cellRadios.end(); ++it)
+                {
+                    RadioRef hi = *it;
+                    if (hi != h && hpos.sqrdist(hi->pos) < maxDistSquared)
+                        connect(h, hi);
+                }
             }
         }
     }
@@ -221,8 +401,23 @@ void ChannelControl::checkChannel(int channel)
 void ChannelControl::setRadioPosition(RadioRef r, const Coord& pos)
 {
     Enter_Method_Silent();
+    if (lazyNeighborUpdate)
+    {
+        // a radio moving faster than maxSpeed or more than maxPositionUpdateInterval allows
+        // (e.g. one that is placed or wraps around) invalidates the candidate lists of all radios
+        simtime_t now = simTime();
+        if (r->posTime < 0 || r->pos.distance(pos) > maxSpeed * std::min(now - r->posTime, maxPositionUpdateInterval).dbl())
+            neighborCacheEpoch++;
+        r->posTime = now;
+    }
     r->pos = pos;
-    updateConnections(r);
+    if (useNeighborGrid && getGridCell(pos) != r->gridCell)
+    {
+        removeFromGrid(r);
+        addToGrid(r);
+    }
+    if (!lazyNeighborUpdate)
+        updateConnections(r);
 }
 
 void ChannelControl::setRadioChannel(RadioRef r, int channel)
@@ -309,7 +504,19 @@ void ChannelControl::sendToChannel(RadioRef srcRadio, AirFrame *airFrame)
             // account for propagation delay, based on distance in meters
             // Over 300m, dt=1us=10 bit times @ 10Mbps
             simtime_t delay = srcRadio->pos.distance(r->pos) / SPEED_OF_LIGHT;
-            check_and_cast<cSimpleModule*>(srcRadio->radioModule)->sendDirect(airFrame->dup(), delay, airFrame->getDuration(), r->radioInGate);
+            // dup() only copies the AirFrame itself: the encapsulated frame is reference
+            // counted and shared by all receivers until one of them decapsulates it (see
+            // Radio::sendUp()); receivers should avoid getEncapsulatedPacket(), which unshares it
+            AirFrame *frameCopy = airFrame->dup();
+            // frames too weak to matter at the receiver would only cost two events there
+            if (prefilterReceptions && r->channelAccess && !r->channelAccess->prefilterAirFrame(frameCopy))
+            {
+                coreEV << "discarding negligible frame\n";
+                numPrefiltered++;
+                delete frameCopy;
+                continue;
+            }
+            check_and_cast<cSimpleModule*>(srcRadio->radioModule)->sendDirect(frameCopy, delay, airFrame->getDuration(), r->radioInGate);
         }
         else
             coreEV << "skipping radio listening on a different channel\n";
@@ -19,7 +19,7 @@
 
 #include <vector>
 #include <list>
-#include <set>
+#include <map>
 
 #include "INETDefs.h"
 #include "Coord.h"
@@ -27,6 +27,7 @@
 
 // Forward declarations
 class AirFrame;
+class ChannelAccess;
 
 #define TRANSMISSION_PURGE_INTERVAL 1.0
 
@@ -37,6 +38,7 @@ class AirFrame;
  */
 struct IChannelControl::RadioEntry {
     cModule *radioModule;  // the module that registered this radio interface
+    ChannelAccess *channelAccess;  // radioModule, if it is a ChannelAccess (used for prefiltering)
     cGate *radioInGate;  // gate on host module used to receive airframes
     int channel;
     Coord pos; // cached radio position
@@ -47,11 +49,33 @@ struct IChannelControl::RadioEntry {
             return lhs->radioModule->getId() < rhs->radioModule->getId();
         }
     };
-    // we cache neighbors set in an std::vector, because std::set iteration is slow;
-    // std::vector is created and updated on demand
-    std::set<RadioRef, Compare> neighbors; // cached neighbor list
-    std::vector<RadioRef> neighborList;
-    bool isNeighborListValid;
+    // neighbors are kept in an std::vector sorted by module id (see Compare),
+    // because std::set iteration is slow and sendToChannel() iterates them on every frame
+    std::vector<RadioRef> neighbors; // cached neighbor list
+
+    // cell of the uniform grid (with cell size maxInterferenceDistance) containing pos
+    struct GridCell {
+        int x, y, z;
+        bool operator<(const GridCell& other) const {
+            return x != other.x ? x < other.x : y != other.y ? y < other.y : z < other.z;
+        }
+        bool operator!=(const GridCell& other) const {
+            return x != other.x || y != other.y || z != other.z;
+        }
+    };
+    GridCell gridCell;
+
+    // lazy neighbor update: radios that were within interference distance plus
+    // a safety margin at candidatesTime, sorted by module id, with their distances then
+    struct Candidate {
+        RadioRef radio;
+        double distance;
+    };
+    std::vector<Candidate> candidates;
+    simtime_t candidatesTime;
+    long candidatesEpoch;  // ChannelControl::neighborCacheEpoch when candidates were collected
+    simtime_t posTime;     // time of the last position update
+
     bool isActive;
 };
 
@@ -91,9 +115,62 @@ class INET_API ChannelControl : public cSimpleModule, public IChannelControl
     /** the number of controlled channels */
     int numChannels;
 
+    /** whether updateConnections() only checks radios in the adjacent grid cells */
+    bool useNeighborGrid;
+
+    /** radios by grid cell; only maintained if useNeighborGrid is set */
+    typedef std::map<RadioEntry::GridCell, RadioRefVector> RadioGrid;
+    RadioGrid grid;
+
+    /** whether neighbor lists are only computed when a radio transmits */
+    bool lazyNeighborUpdate;
+
+    /** upper bound of the speed of any radio, used by the lazy neighbor update */
+    double maxSpeed;
+
+    /** how long the candidate neighbor list of a radio is used before it is collected again */
+    simtime_t neighborCacheValidity;
+
+    /** upper bound of the time between two position updates of a moving radio */
+    simtime_t maxPositionUpdateInterval;
+
+    /** incremented whenever candidate neighbor lists become unreliable (radios registered
+     * or moved faster than maxSpeed); unregistered radios are removed from them instead */
+    long neighborCacheEpoch;
+
+    /** whether receivers are asked to discard negligible frames before they are sent to them */
+    bool prefilterReceptions;
+
+    /** number of frame copies discarded by prefiltering */
+    long numPrefiltered;
+
   protected:
     virtual void updateConnections(RadioRef h);
 
+    /** Makes the two radios each other's neighbors, unless they already are */
+    virtual void connect(RadioRef a, RadioRef b);
+
+    /** Removes the two radios from each other's neighbor list, if they are neighbors */
+    virtual void disconnect(RadioRef a, RadioRef b);
+
+    /** Returns the grid cell containing the given position */
+    virtual RadioEntry::GridCell getGridCell(const Coord& pos);
+
+    /** Inserts the radio into the grid cell of its current position */
+    virtual void addToGrid(RadioRef r);
+
+    /** Removes the radio from the grid cell it was last inserted to */
+    virtual void removeFromGrid(RadioRef r);
+
+    /** Collects the radios closer to h than range, sorted by module id */
+    virtual void collectRadiosInRange(RadioRef h, double range, std::vector<RadioEntry::Candidate>& result);
+
+    /** Recomputes the neighbor list of h from its candidate list, in lazy neighbor update mode */
+    virtual void updateNeighborsLazily(RadioRef h);
+
+    /** Removes r from the neighbor and candidate lists of h, in lazy neighbor update mode */
+    virtual void forgetRadio(RadioRef h, RadioRef r);
+
     /** Calculate interference distance*/
     virtual double calcInterfDist();
 